@@ -1,19 +1,13 @@
 
 /* Include for .. */
 #include <inttypes.h>   /* .. normalized type, like "uint32_t" */
-#include <pthread.h>    /* .. pthread_[create|join]() */
 #include <signal.h>     /* .. signal() */
 #include <stdio.h>
 #include <stdlib.h>     /* .. exit(), atoi(), malloc() */
 #include <string.h>     /* .. memset() */
-#include <unistd.h>     /* .. usleep(), close() */
+#include <unistd.h>     /* .. useconds_t */
 
-#include <asm/byteorder.h>      /* .. __cpu_to_be32p() */
-#include <arpa/inet.h>          /* .. inet_pton() */
-#include <netinet/in.h>         /* .. htons(), struct sockaddr_in */
-#include <sys/socket.h>         /* .. socket(), connect(), recv(), send() */
-
-#include "../protocol_src/protocol_routing_variables.h"
+#include "../protocol_src/ledclient.h"
 
 /* Uncomment to enable debug prints */
 //#define ENA_DBG 1
@@ -23,17 +17,10 @@
         #define DBG(FMT, ...)
 #endif
 
-/* Format is: !C[3-4]N([A-F]|[a-f]|[0-9]){4},(.{4})+$
- *            !       : Transaction's start
- *            C<comp> : Component prefix with <comp> between 3 & 4
- *            N<data> : Number of data prefix with <data> its value in HEXA
- *            ,       : Splitter between "pre-amble" and actual data
- *            <dataX> : Data value in RGB[W] format <=> uint32_t
- *            $       : Transaction's end                                    */
-#define PREAMBLE_LEN    (  9u)
 #define LEDS_LEN        (940u)
-#define EPILOGUE_LEN    (  1u)
-#define BUFFER_LEN      (PREAMBLE_LEN + LEDS_LEN*sizeof(uint32_t) + EPILOGUE_LEN)
+
+/* Connection's timeouts [ms] */
+#define CONNECT_TIMEOUT 5000
 
 #define COLOR_OFF	0xAAAAAAAA
 
@@ -69,14 +56,18 @@ struct branch {
 #define BIT_BR_12       (1 << 11)
 #define BIT_ALL_BR      ( 0x0FFF)
 
-#define BUFF_ACCESS(BUF, OFST) (*(uint32_t *)((BUF) + \
-                                 PREAMBLE_LEN + (OFST)*sizeof(uint32_t)))
-
 struct state {
        uint16_t activeBranches;
        useconds_t duration;
 };
 
+/* What a frame is built from */
+struct star {
+        const struct branch *branches;
+        size_t nBranches;
+        union color on;
+};
+
 /* Running states */
 int running = 1;
 
@@ -90,68 +81,34 @@ void sigint_handler(int sig) {
 }
 
 /** **************************************************************************
- * @brief  Read response from server and detect "Leaving" msg.
- * @return 0xDEADBEEF: Client leaves server,
- *                  0: Server disconnects itself an make client leave
- *               NULL: Allocation has failed
+ * @brief Frame of a state: its active branches lit, the others OFF
+ *        Only called once per distinct state, its frame is then cached
  *************************************************************************** */
-void *receiveServerMsg(void *arg) {
-        int  socketFd = *((int *)arg);
-        char buff[5+1] = {0};
-        int  streamLen;
-        uint32_t dataLenLE;
-        /* Avoid dynamic allocation in threaded function,
-         * by having the return code var. as static */
-        static int exitRc = 0;
-        exitRc = 0xDEADBEEF;
-
-        while (running) {
-                streamLen = recv(socketFd, (void *)buff,
-                                 sizeof(buff)-1, MSG_DONTWAIT);
-
-                dataLenLE = __cpu_to_le32p((uint32_t *)buff);
-                #if defined(ENA_DBG)
-                printf("CLT-DBG: dataLenLE[%d] | Msg[%s]\n",
-                       dataLenLE, buffRecvData);
-                /* Tips: From threaded fn(), flush output to
-                 *       actually print it */
-                fflush(stdout);
-                #endif
-
-                /* Full stream is 4 bytes of stream length +
-                 * 1 for server's shut down routing value
-                 * So compare both value for safety and avoid case like:
-                 * - 4 random bytes before actual data */
-                if (streamLen != 5 && dataLenLE != 1)
-                        continue;
+static void buildFrame(void *user, uint32_t activeBranches, uint32_t *frame) {
+        const struct star *star = user;
+        uint32_t word;
+        int i, iBranch;
 
-                if (buff[4] == LEAVE_SHUTDOWN) {
-                        exitRc  = 0;
-                        running = 0;
-                }
+        for (i = 0; i < star->nBranches; i++) {
+                word = activeBranches & (1 << i) ? star->on.word : C_OFF.word;
+                for (iBranch  = star->branches[i].start;
+                     iBranch <= star->branches[i].end  ; iBranch++)
+                        frame[iBranch] = word;
         }
-
-        return (void *)&exitRc;
 }
 
 /** **************************************************************************
  * @brief Main application function
  *************************************************************************** */
 int main(int argc, char **argv) {
-        /* Socket parameters */
-        int socketFd = 0, port = 0;
-        struct sockaddr_in srv_addr = {};
-        uint8_t connectionSuccessful = 0;
-        /* Exchanging buffer */
-        char buff[BUFFER_LEN+1] = {0};
-        char *buffRecvData = buff+4;    /* buff+4 to skip stream length info. */
-        char *buffSendData = buff+PREAMBLE_LEN;
+        /* Connection to the server & frames' pacing */
+        struct ledclient clt;
+        struct ledclient_sched sched;
+        /* One encoded frame per distinct state */
+        struct ledclient_frames frames;
         /* Data treatment */
-        int streamLen = 0;
-        uint32_t streamLenLE = 0, dataLenLE = 0;
         //union color c = { .rgbw = { .w = 0, .r = 0, .g = 0xBB, .b = 0xFF } };
         union color c = { .rgbw = { .w = 0, .r = 0, .g = 0x88, .b = 0xCC } };
-        int iBranch = 0;
         struct branch branches[12] = {
                 {  0,  90}, { 91, 162}, {163, 236}, {237, 310},
                 {311, 382}, {383, 473}, {474, 547}, {548, 621},
@@ -171,11 +128,9 @@ int main(int argc, char **argv) {
                 {BIT_NO_BR, 1000000 / 4}, {BIT_ALL_BR, 1000000},
                 {BIT_BR_06, 1000000 / 4}, {BIT_ALL_BR, 1000000}
         };
-        /* Thread about detecting server leaving */
-        pthread_t svrLeavingThread;
-        int *threadRc;
+        struct star star = { branches, sizeof(branches)/sizeof(*branches), c };
         /* Others */
-        int rc = 0, i = 0;
+        int i = 0;
 
         if (argc != 3) {
                 fprintf(stderr, "usage: %s <SERVER_IP> <PORT>\n", argv[0]);
@@ -185,154 +140,87 @@ int main(int argc, char **argv) {
                 exit(EXIT_FAILURE);
         }
 
-        /* Parsing server's IP */
-        if (inet_pton(AF_INET, argv[1], &srv_addr.sin_addr) <= 0) {
-                fprintf(stderr, "Converting server's IP failed\n");
+        printf("CLT: Connecting to server at %s:%s...\n", argv[1], argv[2]);
+        if (ledclient_connect(&clt, argv[1], atoi(argv[2]),
+                              CONNECT_TIMEOUT) < 0) {
+                perror("FAILURE");
                 exit(EXIT_FAILURE);
         }
+        DBG("CLT-DBG: Step passed[connect]\n");
 
-        /* Parsing server's port */
-        port = atoi(argv[2]);
-
-        /* Socket's creation */
-        socketFd = socket(AF_INET, SOCK_STREAM, 0);
-        if (socketFd < 0) {
-                fprintf(stderr, "Could not create socket client side\n");
+        /* Works because host machine operates with Little Endian */
+        if (ledclient_frames_init(&frames, 3, LEDS_LEN) < 0) {
+                perror("Frames' allocation failed");
+                ledclient_close(&clt);
                 exit(EXIT_FAILURE);
         }
-        DBG("CLT-DBG: Step passed[socket]\n");
-
-        /* Fill server's infos */
-        srv_addr.sin_family = AF_INET;
-        srv_addr.sin_port = htons(port);
-
-        printf("CLT: Connecting to server at %s:%d...\n", argv[1], port);
-        if (connect(socketFd, (struct sockaddr *) &srv_addr,
-                                sizeof(srv_addr)) < 0) {
-                fprintf(stderr, "FAILURE\n");
-                /* Clean ressource(s) that could be used */
-                close(socketFd);
-                exit(EXIT_FAILURE);
+        /* Built before the 1st one is sent: nothing left to do per frame */
+        for (i = 0; i < sizeof(sequence)/sizeof(*sequence); i++) {
+                if ( ! ledclient_frames_get(&frames,
+                                            sequence[i].activeBranches,
+                                            buildFrame, &star) ) {
+                        perror("Frames' allocation failed");
+                        ledclient_frames_free(&frames);
+                        ledclient_close(&clt);
+                        exit(EXIT_FAILURE);
+                }
         }
-        DBG("CLT-DBG: Step passed[connect]\n");
-
-        /* Fully initiate srv_addr struct to 0 */
-        memset(&srv_addr, 0, sizeof(srv_addr));
+        printf("CLT: %zu distinct frames for %zu states\n", frames.count,
+               sizeof(sequence)/sizeof(*sequence));
 
         /* Connect signal to handler */
         signal(SIGINT, sigint_handler);
 
         printf("~~~ WELCOME TO THE PROGRAM ~~~\n");
         printf("CLT: Wait for connection validation...\n");
-        while ( ! connectionSuccessful && running ) {
-                /* Use MSG_DONTWAIT as MSG_WAITALL wait for buffer
-                 * to be filled with "size" elements (if no error occurs).
-                 * Other flags, like MSG_TRUNC, are in evaluation
-                 * as possibilities. */
-                streamLenLE = recv(socketFd, (void *) buff,
-                                   BUFFER_LEN, MSG_DONTWAIT);
-
-                /* 4 bytes of stream length + 1 for routing value of
-                 * acknowledge value: CLIENT_CONNECTION_ACK_AND_WAITING_NEW_DATA */
-                if (streamLenLE != 5)   continue;
-
-                dataLenLE = __cpu_to_le32p((uint32_t *)buff);
-                DBG("Server's response (length: %d, actual data: %d):\n",
-                    streamLenLE, dataLenLE);
-
-                if (*((uint8_t *)buffRecvData) ==
-                    CLIENT_CONNECTION_ACK_AND_WAITING_DATA) {
-                        connectionSuccessful = 1;
-                }
-        }
-
-        printf("CLT: Launching task to detect if server kills itself...\n");
-        rc = pthread_create(&svrLeavingThread, NULL,
-                            receiveServerMsg, &socketFd);
-        if (rc) {
-                printf("CLT: Thread could not be created. Program aborted!\n");
-                /* 1st 4 bytes are stream length info. in Little Endian */
-                if (send(socketFd, (void *) "\x07\0\0\0Leaving", 11, 0) != 11)
-                        fprintf(stderr, "Sending failed\n");
-                /* Clean ressource(s) that could be used */
-                close(socketFd);
+        if (ledclient_handshake(&clt, -1) < 0) {
+                perror("CLT: Connection not validated");
+                ledclient_close(&clt);
                 exit(EXIT_FAILURE);
         }
 
         printf("CLT: Start communication with server to "
                "drive LEDs display!\n");
-        while (running) {
-                /* Build custom preamble */
-                snprintf(buff, BUFFER_LEN, "!C%dN%04x,", 3, LEDS_LEN);
-                buff[PREAMBLE_LEN] = 0;
-
-                streamLen = strlen(buff) + LEDS_LEN * sizeof(uint32_t) + 1;
-                DBG("CLT-DBG: Built string(len[%d])\n", streamLen);
-
-                /* Fill with color data */
-                for (i = 0; i < sizeof(branches)/sizeof(*branches); i++) {
-                        if (sequence[s].activeBranches & (1 << i)) {
-                                /* Set color */
-                                for (iBranch  = branches[i].start;
-                                     iBranch <= branches[i].end  ; iBranch++) {
-                                     BUFF_ACCESS(buff, iBranch) = c.word;
-                                }
-                        } else {
-                                /* Set OFF color */
-                                for (iBranch  = branches[i].start;
-                                     iBranch <= branches[i].end  ; iBranch++) {
-                                     BUFF_ACCESS(buff, iBranch) = C_OFF.word;
-                                }
-                        }
-                }
-
-                /* Fill with epilogue */
-                buff[BUFFER_LEN-1] = '$';
-
-                streamLenLE = __cpu_to_le32p((uint32_t *)&streamLen);
-                if (send(socketFd, &streamLenLE,
-                         sizeof(streamLenLE), 0) != sizeof(streamLenLE))
-                        printf("CLT: Packet's preamble could not "
-                               "be sent properly\n");
-
-                if (send(socketFd, (void *) buff,
-                         BUFFER_LEN, 0) != BUFFER_LEN)
+        /* Durations given by the sequence */
+        ledclient_sched_start(&sched, 0);
+        while (running && ! clt.serverLeft) {
+                /* Cached frame, sent as it is */
+                if (ledclient_send_cached(&clt, &frames,
+                                          sequence[s].activeBranches,
+                                          buildFrame, &star) < 0)
                         printf("CLT: Data could not "
                                "be sent properly\n");
 
-                /* Works because host machine operates with Little Endian  */
-                /* TODO/IDEA: Only change endianess treatment Qt side
-                 *            Otherwise, a loop would be needed to
-                 *            transform and ensure data's endianess, like: */
-                /*for (uint32_t i = 0; i < 7; i++) {
-                        uint32_t tmp = __cpu_to_le32p(
-                                        &(digits[state].segments+i)->word);
-                        if (send(socketFd, (void *) &tmp, sizeof(tmp), 0)
-                            != sizeof(tmp))
-                                printf("CLT: Data[state=%d] segment[%d] could "
-                                       "not be sent properly\n", state, i);
-                }*/
-
-                usleep(sequence[s].duration);
+                /* Server's messages (acks, leaving) handled meanwhile */
+                if (ledclient_sched_wait(&clt, &sched,
+                                         sequence[s].duration * 1000ULL) < 0 &&
+                    ! clt.serverLeft) {
+                        perror("CLT: Connection lost");
+                        break;
+                }
+                DBG("CLT-DBG: %u/%u frames acknowledged\n",
+                    clt.framesAcked, clt.framesSent);
 
                 if (++s >= sizeof(sequence)/sizeof(*sequence))
                         s = 0;
         }
 
-        pthread_join(svrLeavingThread, (void **) &threadRc);
-        if (threadRc && *threadRc) {
-                /* 1st 4 bytes are stream length info. in Little Endian */
-                if (send(socketFd, (void *) "\x07\0\0\0Leaving", 11, 0) != 11)
-                        fprintf(stderr, "Sending failed\n");
+        printf("CLT: %llu frames, %.1f FPS, %llu deadlines missed, "
+               "worst wake-up %.3f ms late\n",
+               (unsigned long long)sched.frames, ledclient_sched_fps(&sched),
+               (unsigned long long)sched.missed, sched.maxLateNs / 1e6);
 
-                printf("CLT: Leaving server\n");
+        if (clt.serverLeft) {
+                printf("SVR: Forced client to leave\n");
+                ledclient_close(&clt);
 
         } else {
-                printf("SVR: Forced client to leave\n");
-        }
+                if (ledclient_leave(&clt) < 0)
+                        fprintf(stderr, "Sending failed\n");
 
-        /* Resources cleaning */
-        close(socketFd);
+                printf("CLT: Leaving server\n");
+        }
+        ledclient_frames_free(&frames);
 
         return 0;
 }
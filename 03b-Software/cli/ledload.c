@@ -0,0 +1,417 @@
+
+/* Load generator: stream synthetic frames to the GUI's server from several
+ * connections, or from one at a very high rate, & measure how it keeps up.
+ * The GUI serves a single client & refuses the others: loads from several
+ * connections are for ledserver (see gui/headless/ledserver.cpp).
+ *
+ * Every frame's sending time is kept until the server acknowledges it, acks
+ * coming back in order (DATA_RECEIVED_ACK): the difference is the ack's
+ * latency. At most WINDOW frames are left unacknowledged per connection,
+ * further frames are skipped (& counted) rather than queued in the socket. */
+
+#define _GNU_SOURCE     /* .. ppoll() */
+
+/* Include for .. */
+#include <getopt.h>     /* .. getopt() */
+#include <inttypes.h>   /* .. normalized type, like "uint32_t" */
+#include <poll.h>       /* .. ppoll() */
+#include <signal.h>     /* .. signal() */
+#include <stdio.h>
+#include <stdlib.h>     /* .. exit(), atoi(), malloc(), qsort() */
+#include <string.h>     /* .. strcmp() */
+#include <time.h>       /* .. clock_gettime() */
+
+#include "../protocol_src/ledclient.h"
+
+/* Connection's timeouts [ms] */
+#define CONNECT_TIMEOUT         5000
+#define HANDSHAKE_TIMEOUT       5000
+
+/* Defaults */
+#define CLIENTS         1
+#define LEDS            940
+#define FPS             60
+#define DURATION        10
+#define WINDOW          64
+
+/* Connections at most, polled from an array on the stack */
+#define MAX_CLIENTS     1024
+
+#define NS_PER_SEC      1000000000ULL
+
+enum pattern {
+        PATTERN_SOLID,          /* Every LED alike, color changing per frame */
+        PATTERN_GRADIENT,       /* Scrolling gradient                        */
+        PATTERN_CHASE,          /* A single LED lit, moving                  */
+        PATTERN_NOISE,          /* Random, a new color for every LED         */
+};
+
+static const char *const PATTERNS[] = { "solid", "gradient", "chase", "noise" };
+
+/* One connection & its frames waiting for an ack */
+struct loadclient {
+        struct ledclient clt;
+        int       alive;
+        uint64_t  sentNs[WINDOW];       /* Ring, by frames' number */
+        struct loadstats *stats;
+};
+
+struct loadstats {
+        uint64_t  frames;
+        uint64_t  bytes;
+        uint64_t  skipped;              /* Window full: not sent      */
+        uint64_t  acked;
+        uint64_t  disconnects;
+        uint64_t  sendErrors;
+        /* Every ack's latency [ns] */
+        uint64_t *latencies;
+        size_t    nLatencies;
+        size_t    latenciesSize;
+};
+
+/* Running states */
+int running = 1;
+
+/** **************************************************************************
+ * @brief Signal SIGINT handler
+ *        Receive SIGINT to properly end program and close sockets
+ *************************************************************************** */
+void sigint_handler(int sig) {
+        printf(" SIGINT handler w/ code: %d\n", sig);
+        running = 0;
+}
+
+static uint64_t nowNs(void) {
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec * NS_PER_SEC + now.tv_nsec;
+}
+
+/** **************************************************************************
+ * @brief Server's message callback: an ack closes the oldest frame sent
+ *        (framesAcked is already counted when called)
+ *************************************************************************** */
+static void onMessage(void *user, const uint8_t *msg, size_t len) {
+        struct loadclient *lc = user;
+        struct loadstats *stats = lc->stats;
+        uint64_t *latencies;
+        size_t size;
+
+        if ( ! len || msg[0] != DATA_RECEIVED_ACK ||
+             lc->clt.framesAcked > lc->clt.framesSent )
+                return;
+
+        if (stats->nLatencies == stats->latenciesSize) {
+                size = stats->latenciesSize ? 2 * stats->latenciesSize : 4096;
+                latencies = realloc(stats->latencies,
+                                    size * sizeof(*latencies));
+                if ( ! latencies )
+                        return;
+                stats->latencies     = latencies;
+                stats->latenciesSize = size;
+        }
+
+        stats->latencies[stats->nLatencies++] =
+                nowNs() - lc->sentNs[(lc->clt.framesAcked - 1) % WINDOW];
+        stats->acked++;
+}
+
+/** **************************************************************************
+ * @brief Fill frame number f of the pattern
+ *************************************************************************** */
+static void fillFrame(uint32_t *frame, size_t nLeds, enum pattern pattern,
+                      uint64_t f, uint32_t *seed) {
+        uint32_t x;
+        size_t i;
+
+        switch (pattern) {
+        case PATTERN_SOLID:
+                /* <R><G><B><W>, Little Endian host */
+                x = (f & 0xFF) | ((f * 3) & 0xFF) << 8 | ((f * 7) & 0xFF) << 16;
+                for (i = 0; i < nLeds; i++)
+                        frame[i] = x;
+                break;
+        case PATTERN_GRADIENT:
+                for (i = 0; i < nLeds; i++) {
+                        x = (i + f) & 0xFF;
+                        frame[i] = x | (0xFF - x) << 8 | (x >> 1) << 16;
+                }
+                break;
+        case PATTERN_CHASE:
+                for (i = 0; i < nLeds; i++)
+                        frame[i] = 0;
+                frame[f % nLeds] = 0x00FFFFFF;
+                break;
+        case PATTERN_NOISE:
+                /* xorshift32 */
+                for (x = *seed, i = 0; i < nLeds; i++) {
+                        x ^= x << 13;
+                        x ^= x >> 17;
+                        x ^= x << 5;
+                        frame[i] = x;
+                }
+                *seed = x;
+                break;
+        }
+}
+
+/** **************************************************************************
+ * @brief Handle every connection's messages until deadlineNs (0: only those
+ *        already there), counting the connections lost
+ *************************************************************************** */
+static void processAll(struct loadclient *clients, size_t n,
+                       uint64_t deadlineNs, struct loadstats *stats) {
+        struct pollfd fds[n];
+        struct timespec timeout;
+        uint64_t now;
+        size_t i;
+
+        do {
+                for (i = 0; i < n; i++) {
+                        fds[i].fd      = clients[i].alive ? clients[i].clt.fd :
+                                                            -1;
+                        fds[i].events  = POLLIN;
+                        fds[i].revents = 0;
+                }
+
+                now = nowNs();
+                timeout.tv_sec  = 0;
+                timeout.tv_nsec = 0;
+                if (deadlineNs > now) {
+                        timeout.tv_sec  = (deadlineNs - now) / NS_PER_SEC;
+                        timeout.tv_nsec = (deadlineNs - now) % NS_PER_SEC;
+                }
+
+                if (ppoll(fds, n, &timeout, NULL) <= 0)
+                        continue;
+
+                for (i = 0; i < n; i++) {
+                        if ( ! fds[i].revents )
+                                continue;
+                        if (ledclient_process(&clients[i].clt, 0) < 0 ||
+                            clients[i].clt.serverLeft) {
+                                clients[i].alive = 0;
+                                stats->disconnects++;
+                                ledclient_close(&clients[i].clt);
+                        }
+                }
+        } while (running && nowNs() < deadlineNs);
+}
+
+static int compareU64(const void *a, const void *b) {
+        uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+        return (x > y) - (x < y);
+}
+
+/* Latency at percentile p of the sorted latencies [ms] */
+static double percentile(const struct loadstats *stats, double p) {
+        if ( ! stats->nLatencies )
+                return 0.0;
+        return stats->latencies[(size_t)(p / 100.0 *
+                                         (stats->nLatencies - 1) + 0.5)] / 1e6;
+}
+
+static void usage(const char *name) {
+        fprintf(stderr, "usage: %s [options] <SERVER_IP> <PORT>\n", name);
+        fprintf(stderr, "\tSERVER_IP: 10's base for IPv4\n");
+        fprintf(stderr, "\t           16's base for IPv6\n");
+        fprintf(stderr, "\tPORT     : Port's communication\n");
+        fprintf(stderr, "\t-c N     : Connections, up to %d (default: %d)\n",
+                MAX_CLIENTS, CLIENTS);
+        fprintf(stderr, "\t-n LEDS  : LEDs per frame (default: %d)\n", LEDS);
+        fprintf(stderr, "\t-f FPS   : Frames per second and connection,"
+                        " 0 as fast as acks allow (default: %d)\n", FPS);
+        fprintf(stderr, "\t-e ENC   : rgb or rgbw (default: rgb)\n");
+        fprintf(stderr, "\t-p PAT   : solid, gradient, chase or noise"
+                        " (default: gradient)\n");
+        fprintf(stderr, "\t-d SEC   : Duration (default: %d)\n", DURATION);
+        exit(EXIT_FAILURE);
+}
+
+/** **************************************************************************
+ * @brief Main application function
+ *************************************************************************** */
+int main(int argc, char **argv) {
+        /* Load */
+        size_t nClients = CLIENTS, nLeds = LEDS;
+        double fps = FPS, duration = DURATION;
+        int comp = 3;
+        enum pattern pattern = PATTERN_GRADIENT;
+        /* Connections & results */
+        struct loadclient *clients = NULL;
+        struct loadstats stats;
+        uint32_t *frame = NULL;
+        /* Length prefix, "!C<comp>N<hhhh>,", LEDs & '$' */
+        size_t msgLen;
+        uint64_t start, end, next, period, f = 0, lastReport, lastFrames = 0;
+        uint32_t seed = 0x2545F491;
+        int opt, sent;
+        size_t i, p;
+
+        while ((opt = getopt(argc, argv, "c:n:f:e:p:d:")) != -1) {
+                switch (opt) {
+                case 'c': nClients = strtoul(optarg, NULL, 0);  break;
+                case 'n': nLeds    = strtoul(optarg, NULL, 0);  break;
+                case 'f': fps      = atof(optarg);              break;
+                case 'd': duration = atof(optarg);              break;
+                case 'e':
+                        if ( ! strcmp(optarg, "rgb") )
+                                comp = 3;
+                        else if ( ! strcmp(optarg, "rgbw") )
+                                comp = 4;
+                        else
+                                usage(argv[0]);
+                        break;
+                case 'p':
+                        for (p = 0; p < sizeof(PATTERNS)/sizeof(*PATTERNS); p++)
+                                if ( ! strcmp(optarg, PATTERNS[p]) )
+                                        break;
+                        if (p == sizeof(PATTERNS)/sizeof(*PATTERNS))
+                                usage(argv[0]);
+                        pattern = p;
+                        break;
+                default:
+                        usage(argv[0]);
+                }
+        }
+        if (argc - optind != 2 || ! nClients || nClients > MAX_CLIENTS ||
+            ! nLeds || nLeds > LEDCLIENT_MAX_ENTRIES || fps < 0.0 ||
+            duration <= 0.0)
+                usage(argv[0]);
+
+        memset(&stats, 0, sizeof(stats));
+        clients = calloc(nClients, sizeof(*clients));
+        frame   = malloc(nLeds * sizeof(*frame));
+        if ( ! clients || ! frame ) {
+                perror("Allocation failed");
+                exit(EXIT_FAILURE);
+        }
+
+        printf("CLT: %zu connection(s) to %s:%s, %zu LEDs (%s), %s, ",
+               nClients, argv[optind], argv[optind + 1], nLeds,
+               comp == 3 ? "rgb" : "rgbw", PATTERNS[pattern]);
+        if (fps > 0.0)
+                printf("%.1f FPS each\n", fps);
+        else
+                printf("as fast as acks allow\n");
+
+        for (i = 0; i < nClients; i++) {
+                struct loadclient *lc = &clients[i];
+
+                if (ledclient_connect(&lc->clt, argv[optind],
+                                      atoi(argv[optind + 1]),
+                                      CONNECT_TIMEOUT) < 0 ||
+                    ledclient_handshake(&lc->clt, HANDSHAKE_TIMEOUT) < 0) {
+                        fprintf(stderr, "CLT: Connection %zu: ", i);
+                        perror("FAILURE");
+                        ledclient_close(&lc->clt);
+                        continue;
+                }
+
+                lc->clt.onMessage = onMessage;
+                lc->clt.user      = lc;
+                lc->stats         = &stats;
+                lc->alive         = 1;
+        }
+
+        /* Connect signal to handler */
+        signal(SIGINT, sigint_handler);
+
+        msgLen = sizeof(uint32_t) + strlen("!C3N0000,") +
+                 nLeds * sizeof(uint32_t) + 1;
+        period = fps > 0.0 ? NS_PER_SEC / fps : 0;
+        start  = lastReport = next = nowNs();
+        end    = start + duration * NS_PER_SEC;
+        while (running && nowNs() < end) {
+                /* Same frame for every connection, sent from here */
+                fillFrame(frame, nLeds, pattern, f, &seed);
+                sent = 0;
+                for (i = 0; i < nClients; i++) {
+                        struct loadclient *lc = &clients[i];
+
+                        if ( ! lc->alive )
+                                continue;
+                        if (lc->clt.framesSent - lc->clt.framesAcked >=
+                            WINDOW) {
+                                stats.skipped++;
+                                continue;
+                        }
+
+                        lc->sentNs[lc->clt.framesSent % WINDOW] = nowNs();
+                        if (ledclient_send_leds(&lc->clt, comp, frame,
+                                                nLeds) < 0) {
+                                stats.sendErrors++;
+                                stats.disconnects++;
+                                lc->alive = 0;
+                                ledclient_close(&lc->clt);
+                                continue;
+                        }
+                        stats.frames++;
+                        stats.bytes += msgLen;
+                        sent = 1;
+                }
+                f++;
+
+                for (i = 0; i < nClients && ! clients[i].alive; i++)
+                        ;
+                if (i == nClients) {
+                        fprintf(stderr, "CLT: Every connection lost\n");
+                        break;
+                }
+
+                /* Paced, or as soon as a window has room */
+                if (period) {
+                        /* Late: deadlines skipped, not caught up in a burst */
+                        next += period;
+                        if (next + period < nowNs())
+                                next = nowNs();
+                        processAll(clients, nClients, next, &stats);
+                } else {
+                        processAll(clients, nClients,
+                                   sent ? 0 : nowNs() + NS_PER_SEC / 1000,
+                                   &stats);
+                }
+
+                if (nowNs() - lastReport >= NS_PER_SEC) {
+                        printf("CLT: %6.1f s: %8.1f frames/s, %" PRIu64
+                               " acked, %" PRIu64 " skipped\n",
+                               (nowNs() - start) / 1e9,
+                               (stats.frames - lastFrames) * 1e9 /
+                               (nowNs() - lastReport),
+                               stats.acked, stats.skipped);
+                        lastFrames = stats.frames;
+                        lastReport = nowNs();
+                }
+        }
+        end = nowNs();
+
+        /* Late acks */
+        processAll(clients, nClients, nowNs() + NS_PER_SEC / 10, &stats);
+
+        for (i = 0; i < nClients; i++) {
+                if (clients[i].alive)
+                        ledclient_leave(&clients[i].clt);
+        }
+
+        qsort(stats.latencies, stats.nLatencies, sizeof(*stats.latencies),
+              compareU64);
+        printf("CLT: %" PRIu64 " frames in %.2f s: %.1f frames/s, %.2f MB/s\n",
+               stats.frames, (end - start) / 1e9,
+               stats.frames * 1e9 / (end - start),
+               stats.bytes * 1e3 / (end - start));
+        printf("CLT: %" PRIu64 " acked, %" PRIu64 " skipped (window of %d"
+               " full), %" PRIu64 " disconnect(s), %" PRIu64
+               " send error(s)\n", stats.acked, stats.skipped, WINDOW,
+               stats.disconnects, stats.sendErrors);
+        printf("CLT: Ack latency [ms]: p50 %.3f, p90 %.3f, p99 %.3f,"
+               " p99.9 %.3f, max %.3f\n", percentile(&stats, 50),
+               percentile(&stats, 90), percentile(&stats, 99),
+               percentile(&stats, 99.9), percentile(&stats, 100));
+
+        free(stats.latencies);
+        free(clients);
+        free(frame);
+        return stats.disconnects ? EXIT_FAILURE : EXIT_SUCCESS;
+}
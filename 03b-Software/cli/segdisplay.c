@@ -0,0 +1,110 @@
+
+/* Include for .. */
+#include <ctype.h>      /* .. toupper() */
+#include <stdlib.h>     /* .. malloc() */
+#include <string.h>     /* .. memcpy() */
+
+#include "segdisplay.h"
+
+/* A digit's LEDs as bits of a word */
+_Static_assert(DIGIT_LEDS <= 32, "a digit is described by 32 bits at most");
+_Static_assert(SEG_GLYPH_F == 15, "glyphs 0 to F are the digits' values");
+
+/* LEDs of segment s, lit in segments' mask m */
+#define SEG_LEDS_OF(m, s)                                               \
+        ((((m) >> (s)) & 1u) * ((uint32_t)(((1ull << LEDS_PER_SEG) - 1)  \
+                                           << ((s) * LEDS_PER_SEG))))
+#define SEG_GLYPH_LEDS(NAME, CHAR, MASK)                                \
+        SEG_LEDS_OF(MASK, 0) | SEG_LEDS_OF(MASK, 1) | SEG_LEDS_OF(MASK, 2) |   \
+        SEG_LEDS_OF(MASK, 3) | SEG_LEDS_OF(MASK, 4) | SEG_LEDS_OF(MASK, 5) |   \
+        SEG_LEDS_OF(MASK, 6),
+#define SEG_GLYPH_CHAR(NAME, CHAR, MASK)        CHAR,
+
+/* LEDs lit by each glyph, bit i for the digit's i-th LED */
+static const uint32_t glyphLeds[SEG_GLYPHS_COUNT] = {
+        SEG_GLYPHS(SEG_GLYPH_LEDS)
+};
+static const char glyphChars[SEG_GLYPHS_COUNT] = {
+        SEG_GLYPHS(SEG_GLYPH_CHAR)
+};
+
+int segdisplay_init(struct segdisplay *disp, uint32_t *frame, size_t nDigits,
+                    uint32_t on, uint32_t off) {
+        size_t g, i;
+
+        disp->frame   = frame;
+        disp->nDigits = nDigits;
+        disp->changed = 0;
+        disp->shown   = malloc(nDigits ? nDigits : 1);
+        if ( ! disp->shown )
+                return -1;
+
+        for (g = 0; g < SEG_GLYPHS_COUNT; g++)
+                for (i = 0; i < DIGIT_LEDS; i++)
+                        disp->glyphs[g][i] = glyphLeds[g] >> i & 1 ? on : off;
+
+        for (i = 0; i < nDigits; i++) {
+                memcpy(frame + i * DIGIT_LEDS, disp->glyphs[SEG_GLYPH_BLANK],
+                       sizeof(disp->glyphs[0]));
+                disp->shown[i] = SEG_GLYPH_BLANK;
+        }
+        return 0;
+}
+
+void segdisplay_free(struct segdisplay *disp) {
+        free(disp->shown);
+        disp->shown   = NULL;
+        disp->nDigits = 0;
+}
+
+enum seg_glyph segdisplay_glyph(char c) {
+        int g;
+
+        c = toupper((unsigned char)c);
+        for (g = 0; g < SEG_GLYPHS_COUNT; g++)
+                if (toupper((unsigned char)glyphChars[g]) == c)
+                        return g;
+        return SEG_GLYPH_BLANK;
+}
+
+int segdisplay_set(struct segdisplay *disp, size_t digit,
+                   enum seg_glyph glyph) {
+        if (digit >= disp->nDigits || disp->shown[digit] == glyph)
+                return 0;
+
+        memcpy(disp->frame + digit * DIGIT_LEDS, disp->glyphs[glyph],
+               sizeof(disp->glyphs[0]));
+        disp->shown[digit] = glyph;
+        return 1;
+}
+
+size_t segdisplay_print(struct segdisplay *disp, const char *text) {
+        size_t i;
+
+        disp->changed = 0;
+        for (i = 0; i < disp->nDigits; i++) {
+                disp->changed += segdisplay_set(disp, i, *text ?
+                                                segdisplay_glyph(*text) :
+                                                SEG_GLYPH_BLANK);
+                if (*text)
+                        text++;
+        }
+        return disp->changed;
+}
+
+size_t segdisplay_number(struct segdisplay *disp, unsigned long long value,
+                         unsigned base) {
+        size_t i;
+
+        if (base < 2 || base > 16)
+                base = 10;
+
+        /* Glyphs 0 to F are the digits' values: no lookup */
+        disp->changed = 0;
+        for (i = disp->nDigits; i-- > 0; value /= base)
+                disp->changed += segdisplay_set(disp, i,
+                                                value || i == disp->nDigits - 1 ?
+                                                (enum seg_glyph)(value % base) :
+                                                SEG_GLYPH_BLANK);
+        return disp->changed;
+}
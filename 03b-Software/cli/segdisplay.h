@@ -0,0 +1,90 @@
+
+#ifndef __SEGDISPLAY_H__
+#define __SEGDISPLAY_H__
+
+/* 7 segments displays made of LEDs: glyph masks -> LEDs lit -> frames.
+ *
+ * Which LEDs of a digit each glyph lights is computed by the preprocessor from
+ * SEG_GLYPHS below. At init, the glyphs are expanded once into ready-to-copy
+ * colors, so rendering a digit is a copy & only the digits that changed are
+ * rewritten: counters & clocks cost a digit or two per frame.
+ *
+ * A display renders into the caller's frame, from a given LED: several
+ * displays can share one frame. Digits are in frame's order, each being its
+ * segments a to g, LEDS_PER_SEG LEDs per segment. */
+
+#include <stddef.h>     /* .. size_t */
+#include <stdint.h>     /* .. uint32_t */
+
+#ifndef LEDS_PER_SEG
+        #define LEDS_PER_SEG    3
+#endif
+#define SEGMENTS        7
+#define DIGIT_LEDS      (SEGMENTS * LEDS_PER_SEG)
+
+/* Name, character shown, segments lit (bit 0: a ... bit 6: g)
+ *     aaa
+ *    f   b
+ *     ggg
+ *    e   c
+ *     ddd     */
+#define SEG_GLYPHS(X)                   \
+        X(0,     '0', 0b00111111)       \
+        X(1,     '1', 0b00000110)       \
+        X(2,     '2', 0b01011011)       \
+        X(3,     '3', 0b01001111)       \
+        X(4,     '4', 0b01100110)       \
+        X(5,     '5', 0b01101101)       \
+        X(6,     '6', 0b01111101)       \
+        X(7,     '7', 0b00000111)       \
+        X(8,     '8', 0b01111111)       \
+        X(9,     '9', 0b01101111)       \
+        X(A,     'A', 0b01110111)       \
+        X(B,     'b', 0b01111100)       \
+        X(C,     'C', 0b00111001)       \
+        X(D,     'd', 0b01011110)       \
+        X(E,     'E', 0b01111001)       \
+        X(F,     'F', 0b01110001)       \
+        X(MINUS, '-', 0b01000000)       \
+        X(BLANK, ' ', 0b00000000)
+
+#define SEG_GLYPH_ENUM(NAME, CHAR, MASK)        SEG_GLYPH_##NAME,
+enum seg_glyph {
+        SEG_GLYPHS(SEG_GLYPH_ENUM)
+        SEG_GLYPHS_COUNT
+};
+#undef SEG_GLYPH_ENUM
+
+struct segdisplay {
+        uint32_t *frame;        /* Caller's frame, 1st LED of the display */
+        size_t    nDigits;
+        uint8_t  *shown;        /* Glyph of each digit in frame           */
+        size_t    changed;      /* Digits rewritten by the last render    */
+        /* Every glyph in colors, copied as they are into frame */
+        uint32_t  glyphs[SEG_GLYPHS_COUNT][DIGIT_LEDS];
+};
+
+/** **************************************************************************
+ * @brief Display of nDigits in frame[0 .. nDigits * DIGIT_LEDS[, blanked
+ * @return 0, -1 on allocation failure
+ *************************************************************************** */
+int  segdisplay_init(struct segdisplay *disp, uint32_t *frame, size_t nDigits,
+                     uint32_t on, uint32_t off);
+void segdisplay_free(struct segdisplay *disp);
+
+/* Glyph of a character, SEG_GLYPH_BLANK if none (case insensitive) */
+enum seg_glyph segdisplay_glyph(char c);
+
+/* Show glyph on a digit, written only if it changed
+ * @return 1 if written, 0 otherwise */
+int    segdisplay_set(struct segdisplay *disp, size_t digit,
+                      enum seg_glyph glyph);
+/* One character per digit, from the left, blanks after text's end
+ * @return # of digits written */
+size_t segdisplay_print(struct segdisplay *disp, const char *text);
+/* value right aligned, in base 2 to 16, digits above the display's dropped
+ * @return # of digits written */
+size_t segdisplay_number(struct segdisplay *disp, unsigned long long value,
+                         unsigned base);
+
+#endif /* __SEGDISPLAY_H__ */
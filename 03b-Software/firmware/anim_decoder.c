@@ -0,0 +1,139 @@
+
+#include "anim_decoder.h"
+
+#include <string.h>     /* .. memcmp(), memset() */
+
+/* Byte by byte: no alignment requirement on the animation's data */
+static inline uint32_t rd_u32(const uint8_t *p) {
+        return (uint32_t)p[0]         | (uint32_t)p[1] <<  8 |
+               (uint32_t)p[2] << 16   | (uint32_t)p[3] << 24;
+}
+
+static inline uint16_t rd_u16(const uint8_t *p) {
+        return (uint16_t)(p[0] | p[1] << 8);
+}
+
+int anim_open(struct anim_decoder *dec, const uint8_t *data, uint32_t size) {
+        uint32_t paletteLen;
+
+        if (size < ANIM_HEADER_LEN || memcmp(data, ANIM_MAGIC, 4) ||
+            data[4] != ANIM_VERSION)
+                return ANIM_ERR_HEADER;
+
+        paletteLen = rd_u16(data + 6);
+        if (paletteLen > ANIM_PALETTE_MAX ||
+            size < ANIM_HEADER_LEN + paletteLen * 4)
+                return ANIM_ERR_HEADER;
+
+        dec->data       = data;
+        dec->size       = size;
+        dec->palette    = (data[5] & ANIM_FLAG_PALETTE) ?
+                          data + ANIM_HEADER_LEN : NULL;
+        dec->paletteLen = paletteLen;
+        dec->nLeds      = rd_u32(data +  8);
+        dec->nFrames    = rd_u32(data + 12);
+        dec->framesOfst = ANIM_HEADER_LEN + paletteLen * 4;
+        dec->ofst       = dec->framesOfst;
+        dec->frame      = 0;
+
+        return ANIM_OK;
+}
+
+int anim_next_frame(struct anim_decoder *dec, uint32_t *leds,
+                    uint16_t *duration_ms) {
+        const uint8_t *p, *end = dec->data + dec->size;
+        const uint8_t colorLen = dec->palette ? 1 : 4;
+        uint32_t led = 0, n, shift;
+        uint8_t op;
+
+        /* Loop */
+        if (dec->frame >= dec->nFrames) {
+                dec->frame = 0;
+                dec->ofst  = dec->framesOfst;
+        }
+
+        /* The 1st frame is relative to all LEDs off */
+        if (dec->frame == 0)
+                memset(leds, 0, dec->nLeds * sizeof(uint32_t));
+
+        p = dec->data + dec->ofst;
+        if (end - p < 2)
+                return ANIM_ERR_TRUNCATED;
+        if (duration_ms)
+                *duration_ms = rd_u16(p);
+        p += 2;
+
+        for (;;) {
+                if (p >= end)
+                        return ANIM_ERR_TRUNCATED;
+
+                op = *p++;
+                if (ANIM_OP_TYPE(op) == ANIM_OP_END)
+                        break;
+
+                n = ANIM_OP_LEN(op) + 1;
+                if (ANIM_OP_LEN(op) == ANIM_OP_LEN_EXTENDED) {
+                        n = 0;
+                        shift = 0;
+                        do {
+                                if (p >= end || shift > 28)
+                                        return ANIM_ERR_TRUNCATED;
+                                n |= (uint32_t)(*p & 0x7F) << shift;
+                                shift += 7;
+                        } while (*p++ & 0x80);
+                        n += 64;
+                }
+
+                if (n > dec->nLeds - led)
+                        return ANIM_ERR_OVERFLOW;
+
+                switch (ANIM_OP_TYPE(op)) {
+                case ANIM_OP_SKIP:
+                        break;
+
+                case ANIM_OP_RUN: {
+                        uint32_t color, i;
+
+                        if (end - p < colorLen)
+                                return ANIM_ERR_TRUNCATED;
+                        if (dec->palette && *p >= dec->paletteLen)
+                                return ANIM_ERR_OVERFLOW;
+                        color = dec->palette ? rd_u32(dec->palette + 4 * *p) :
+                                               rd_u32(p);
+                        p += colorLen;
+
+                        for (i = 0; i < n; i++)
+                                leds[led + i] = color;
+                        break;
+                }
+
+                case ANIM_OP_LITERAL: {
+                        uint32_t i;
+
+                        if ((uint32_t)(end - p) < n * colorLen)
+                                return ANIM_ERR_TRUNCATED;
+
+                        if (dec->palette) {
+                                for (i = 0; i < n; i++) {
+                                        if (p[i] >= dec->paletteLen)
+                                                return ANIM_ERR_OVERFLOW;
+                                        leds[led + i] = rd_u32(dec->palette +
+                                                               4 * p[i]);
+                                }
+                        } else {
+                                for (i = 0; i < n; i++)
+                                        leds[led + i] = rd_u32(p + 4 * i);
+                        }
+                        p += n * colorLen;
+                        break;
+                }
+                }
+
+                led += n;
+        }
+
+        dec->ofst = p - dec->data;
+        dec->frame++;
+
+        return ANIM_OK;
+}
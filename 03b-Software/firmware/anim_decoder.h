@@ -0,0 +1,88 @@
+
+#ifndef __ANIM_DECODER_H__
+#define __ANIM_DECODER_H__
+
+/* Reference decoder of the animations exported by the GUI (Effects >
+ * Record animation), written for microcontrollers:
+ *  - no allocation, the animation is read in place (flash)
+ *  - one uint32_t per LED as working buffer, updated frame after frame
+ *  - a frame's decoding only touches the LEDs that changed
+ *
+ * Format, all fields in Little Endian:
+ *   Header   : "LEDA" <u8 version> <u8 flags> <u16 palette size>
+ *              <u32 number of LEDs> <u32 number of frames>
+ *   Palette  : <u32 color>[palette size], ANIM_FLAG_PALETTE only
+ *   Frames   : <u16 duration in ms> <op>+ <END>
+ *
+ * An op is a byte <type:2><length:6>, the number of LEDs being length+1.
+ * A length of 63 is followed by a LEB128 varint, the number of LEDs then
+ * being 64 + varint. Colors are a palette's index (1 byte) with
+ * ANIM_FLAG_PALETTE, a <R><G><B><W> word (4 bytes) otherwise.
+ *   ANIM_OP_SKIP    : LEDs unchanged since the previous frame
+ *   ANIM_OP_RUN     : LEDs set to the 1 color following
+ *   ANIM_OP_LITERAL : LEDs set to the colors following, 1 per LED
+ *   ANIM_OP_END     : End of frame, the remaining LEDs are unchanged
+ *
+ * The 1st frame is relative to all LEDs off (0x00000000), which is also
+ * where the decoder restarts from when looping.                           */
+
+#include <stdint.h>
+
+#define ANIM_MAGIC              "LEDA"
+#define ANIM_VERSION            (1u)
+#define ANIM_HEADER_LEN         (16u)
+
+/* Header's flags */
+#define ANIM_FLAG_PALETTE       (1u << 0)
+#define ANIM_PALETTE_MAX        (256u)
+
+/* Op's byte */
+#define ANIM_OP_SKIP            (0u)
+#define ANIM_OP_RUN             (1u)
+#define ANIM_OP_LITERAL         (2u)
+#define ANIM_OP_END             (3u)
+#define ANIM_OP_TYPE(BYTE)      ((BYTE) >> 6)
+#define ANIM_OP_LEN(BYTE)       ((BYTE) & 0x3F)
+#define ANIM_OP_LEN_EXTENDED    (63u)
+
+enum ANIM_STATUS {
+        ANIM_OK                 =  0,
+        /* Not an animation or unsupported version */
+        ANIM_ERR_HEADER         = -1,
+        /* Data ending in the middle of a frame */
+        ANIM_ERR_TRUNCATED      = -2,
+        /* Op going past the last LED or the palette */
+        ANIM_ERR_OVERFLOW       = -3,
+};
+
+struct anim_decoder {
+        const uint8_t *data;
+        uint32_t       size;
+        const uint8_t *palette;         /* NULL without ANIM_FLAG_PALETTE  */
+        uint32_t       paletteLen;
+        uint32_t       nLeds;
+        uint32_t       nFrames;
+        uint32_t       framesOfst;      /* 1st frame's offset in data      */
+        uint32_t       ofst;            /* Next frame's offset in data     */
+        uint32_t       frame;           /* Next frame's index              */
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* @return ANIM_OK or ANIM_ERR_HEADER */
+int anim_open(struct anim_decoder *dec, const uint8_t *data, uint32_t size);
+
+/* Apply the next frame on leds[dec->nLeds], which must be left untouched
+ * between calls. Restarts from all LEDs off after the last frame.
+ * @param duration_ms   Optional, how long to show the frame
+ * @return ANIM_OK or the error encountered, leds being partially updated */
+int anim_next_frame(struct anim_decoder *dec, uint32_t *leds,
+                    uint16_t *duration_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ANIM_DECODER_H__
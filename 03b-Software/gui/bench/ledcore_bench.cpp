@@ -0,0 +1,524 @@
+/* ************************************************************************** *
+ * ***       PARSING, COLOR KERNELS, RENDERING & DESIGN FILES TIMINGS       *** *
+ * ************************************************************************** *
+ * usage: ledcore_bench [-o FILE.json] [-t SEC] [-m LEDS] [-f FILTER] [-D DIR]
+ *
+ * Every case runs on the shipped designs (7Seg_L3, BMTH-LudensStar, read from
+ * -D) & on synthetic grids of 10k, 100k & 1M LEDs (up to -m LEDs):
+ *  - parse  : clients' messages per format (RGB & RGBW frames, groups,
+ *             effects) parsed & decoded, and a stream of frames split
+ *  - kernels: color words' kernels of engine/colorkernels.h
+ *  - render : a frame as the GUI's updateScene shows it (LEDs' colors at the
+ *             display's brightness), offscreen into an image, and through the
+ *             whole server (power budget, chains)
+ *  - file   : .disp (JSON) & .dispb (binary) load & save
+ *
+ * A frame's "N<hhhh>" can't address more than 65535 LEDs: on larger designs,
+ * frames only carry those, each result telling the # of LEDs it handled.
+ *
+ * A case's batch grows until it lasts -t / 5 s (default 0.25 s), then 5
+ * batches are timed: the median & the best ones are kept. Results are printed
+ * as they come, & written as JSON to -o (stdout if "-") to be tracked over
+ * time.                                                                      */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../engine/color.h"
+#include "../engine/colorkernels.h"
+#include "../engine/designgen.h"
+#include "../engine/ledtypes.h"
+#include "../engine/protocol.h"
+#include "../engine/raster.h"
+#include "../engine/server.h"
+#include "../structure/display.h"
+#include "../structure/json.hpp"
+
+#ifndef LEDS_DISPLAYS_DIR
+#define LEDS_DISPLAYS_DIR   "displays"
+#endif
+
+/* Timed batches per case */
+#define REPEATS             5
+/* Offscreen image's width, like ledserver's default */
+#define RENDER_WIDTH        800
+/* "N<hhhh>": most LEDs a frame addresses */
+#define MAX_ANNOUNCED       0xFFFFu
+
+typedef std::chrono::steady_clock Clock;
+
+struct Design {
+    std::string name;
+    struct LEDDisplay display;
+};
+
+struct Result {
+    std::string group;
+    std::string name;
+    std::string design;
+    /* LEDs & bytes handled by 1 operation, 0 if meaningless */
+    size_t   leds;
+    size_t   bytes;
+    uint64_t iterations;        /* Per batch                                */
+    double   nsMedian;          /* Per operation                            */
+    double   nsMin;
+};
+
+struct Bench {
+    double minTime = 0.25;
+    std::string filter;
+    std::vector<struct Result> results;
+};
+
+static void usage(const char *name) {
+    std::fprintf(stderr,
+        "usage: %s [-o FILE.json] [-t SEC] [-m LEDS] [-f FILTER] [-D DIR]\n"
+        "\t-o FILE   : JSON results (default: stdout, \"-\")\n"
+        "\t-t SEC    : Time spent per case (default: 0.25)\n"
+        "\t-m LEDS   : Largest synthetic design (default: 1000000)\n"
+        "\t-f FILTER : Only cases whose \"group/name/design\" contains it\n"
+        "\t-D DIR    : Shipped designs' directory (default: %s)\n",
+        name, LEDS_DISPLAYS_DIR);
+    std::exit(EXIT_FAILURE);
+}
+
+/* Keeps the compiler from dropping work whose result isn't used */
+static volatile uint64_t sink;
+
+/** **************************************************************************
+ * @brief Time op(), 1 call being 1 operation over leds LEDs & bytes bytes
+ *************************************************************************** */
+static void measure(struct Bench &bench, const char *group, const char *name,
+                    const struct Design &design, size_t leds, size_t bytes,
+                    const std::function<void()> &op) {
+    const std::string id = std::string(group) + "/" + name + "/" + design.name;
+    if ( ! bench.filter.empty() && id.find(bench.filter) == std::string::npos )
+        return;
+
+    auto batch = [&op](uint64_t n) {
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < n; i++)
+            op();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    /* Warm up, then grow the batch: slow operations stay at 1 per batch */
+    const double target = bench.minTime / REPEATS;
+    uint64_t n = 1;
+    double t = batch(1);
+    while (t < target) {
+        n = t > 0.0 ? std::min<uint64_t>(n * 10,
+                          std::max<uint64_t>(n + 1, n * target * 1.2 / t))
+                    : n * 10;
+        t = batch(n);
+    }
+
+    std::vector<double> ns(REPEATS);
+    ns[0] = t * 1e9 / n;
+    for (size_t r = 1; r < REPEATS; r++)
+        ns[r] = batch(n) * 1e9 / n;
+    std::sort(ns.begin(), ns.end());
+
+    struct Result res = { group, name, design.name, leds, bytes, n,
+                          ns[REPEATS / 2], ns[0] };
+    bench.results.push_back(res);
+
+    std::fprintf(stderr, "%-8s %-14s %-16s %8zu %14.1f %10.2f", group, name,
+                 design.name.c_str(), res.leds, res.nsMedian,
+                 res.leds ? res.nsMedian / res.leds : 0.0);
+    if (bytes)
+        std::fprintf(stderr, " %9.1f", bytes / res.nsMedian * 1e3);
+    std::fprintf(stderr, "\n");
+}
+
+/* Like dispgen -s grid -n leds */
+static struct DesignSpec grid(size_t leds) {
+    struct DesignSpec spec;
+
+    spec.shape = SHAPE_GRID;
+    spec.leds  = leds;
+    return spec;
+}
+
+/* Pseudo random colors, the same every run */
+static std::vector<uint32_t> makeColors(size_t n, uint32_t seed) {
+    std::vector<uint32_t> colors(n);
+
+    for (auto &c : colors) {
+        seed = seed * 1664525u + 1013904223u;
+        c = seed;
+    }
+    return colors;
+}
+
+static void appendU32(std::vector<uint8_t> &out, uint32_t v) {
+    for (size_t i = 0; i < sizeof(v); i++)
+        out.push_back(v >> (8 * i));
+}
+
+/* "!<cmd>N<hhhh>," + entries + "$", like the clients send it */
+static std::vector<uint8_t> makeMessage(const char *cmd, size_t count,
+                                        const std::vector<uint8_t> &entries) {
+    char preamble[16];
+    std::snprintf(preamble, sizeof(preamble), "!%sN%04x,", cmd,
+                  (unsigned)count);
+
+    std::vector<uint8_t> msg(preamble, preamble + strlen(preamble));
+    msg.insert(msg.end(), entries.begin(), entries.end());
+    msg.push_back('$');
+    return msg;
+}
+
+static std::vector<uint8_t> makeFrame(const std::vector<uint32_t> &colors,
+                                      int comp) {
+    std::vector<uint8_t> entries;
+
+    entries.reserve(colors.size() * sizeof(uint32_t));
+    for (uint32_t c : colors)
+        appendU32(entries, comp == 4 ? c : c & 0x00FFFFFF);
+    return makeMessage(comp == 4 ? "C4" : "C3", colors.size(), entries);
+}
+
+/** **************************************************************************
+ * @brief Clients' messages: parsed & decoded into the design's colors
+ *************************************************************************** */
+static void benchParse(struct Bench &bench, const struct Design &design) {
+    const size_t n = std::min<size_t>(design.display.leds.size(),
+                                      MAX_ANNOUNCED);
+    const auto colors = makeColors(n, 1);
+    std::vector<uint32_t> decoded(n);
+
+    for (int comp : { 3, 4 }) {
+        const auto msg = makeFrame(colors, comp);
+
+        measure(bench, "parse", comp == 4 ? "frame_rgbw" : "frame_rgb", design,
+                n, msg.size(), [&]() {
+            struct ClientRequest req;
+            parseRequest(msg.data(), msg.size(), req);
+            sink += decodeFrame(req, decoded.data(), decoded.size());
+        });
+    }
+
+    /* Every group, its own color */
+    const auto &groups = design.display.groups;
+    if ( ! groups.empty() ) {
+        std::vector<uint8_t> entries;
+        for (size_t i = 0; i < groups.size(); i++) {
+            appendU32(entries, i);
+            appendU32(entries, colors[i % n]);
+        }
+        const auto msg = makeMessage("G", groups.size(), entries);
+
+        measure(bench, "parse", "groups", design, 0, msg.size(), [&]() {
+            struct ClientRequest req;
+            parseRequest(msg.data(), msg.size(), req);
+            for (size_t i = 0; i < req.entries; i++)
+                sink += readU32(req.data + i * GROUP_ENTRY_LEN);
+        });
+    }
+
+    /* A full effects' command, the # of entries not depending on the design */
+    {
+        std::vector<uint8_t> entries;
+        for (size_t i = 0; i < 8; i++)
+            for (size_t w = 0; w < EFFECT_ENTRY_LEN / sizeof(uint32_t); w++)
+                appendU32(entries, i + w);
+        const auto msg = makeMessage("E", 8, entries);
+
+        measure(bench, "parse", "effects", design, 0, msg.size(), [&]() {
+            struct ClientRequest req;
+            parseRequest(msg.data(), msg.size(), req);
+            for (size_t i = 0; i < req.entries; i++)
+                sink += decodeEffect(req, i).slot;
+        });
+    }
+
+    /* 16 length prefixed frames in 1 block, as recv() would return them */
+    const auto frame = makeFrame(colors, 3);
+    if (frame.size() <= MessageReader::MESSAGE_MAX) {
+        std::vector<uint8_t> stream;
+        for (size_t i = 0; i < 16; i++) {
+            appendU32(stream, frame.size());
+            stream.insert(stream.end(), frame.begin(), frame.end());
+        }
+
+        MessageReader reader;
+        measure(bench, "parse", "stream_x16", design, 16 * n, stream.size(),
+                [&]() {
+            const uint8_t *msg;
+            size_t len;
+
+            reader.feed(stream.data(), stream.size());
+            while (reader.next(msg, len)) {
+                struct ClientRequest req;
+                parseRequest(msg, len, req);
+                sink += decodeFrame(req, decoded.data(), decoded.size());
+            }
+        });
+    }
+}
+
+/** **************************************************************************
+ * @brief Color words' kernels, over as many colors as the design's LEDs
+ *************************************************************************** */
+static void benchKernels(struct Bench &bench, const struct Design &design) {
+    const size_t n = design.display.leds.size();
+    const auto a = makeColors(n, 1), b = makeColors(n, 2);
+    const size_t bytes = n * sizeof(uint32_t);
+    std::vector<uint32_t> out(n);
+    std::vector<float> ha(n), sa(n), va(n), wa(n), hb(n), sb(n), vb(n), wb(n);
+
+    measure(bench, "kernels", "lerp", design, n, bytes, [&]() {
+        lerpColors(a.data(), b.data(), out.data(), n, 0.3f);
+    });
+    measure(bench, "kernels", "to_hsv", design, n, bytes, [&]() {
+        colorsToHsv(a.data(), ha.data(), sa.data(), va.data(), wa.data(), n);
+    });
+    colorsToHsv(b.data(), hb.data(), sb.data(), vb.data(), wb.data(), n);
+    measure(bench, "kernels", "from_hsv", design, n, bytes, [&]() {
+        hsvToColors(ha.data(), sa.data(), va.data(), wa.data(), out.data(), n);
+    });
+    measure(bench, "kernels", "lerp_hsv", design, n, bytes, [&]() {
+        lerpHsvColors(ha.data(), sa.data(), va.data(), wa.data(), hb.data(),
+                      sb.data(), vb.data(), wb.data(), out.data(), n, 0.3f);
+    });
+    measure(bench, "kernels", "channel_sums", design, n, bytes, [&]() {
+        uint64_t sums[4] = {};
+        channelSums(a.data(), n, sums);
+        sink += sums[0];
+    });
+    /* Scaled in place: restored from a, not to reach 0 after a few calls */
+    measure(bench, "kernels", "scale", design, n, bytes, [&]() {
+        std::copy(a.begin(), a.end(), out.begin());
+        scaleColors(out.data(), n, 0.7f);
+    });
+}
+
+/** **************************************************************************
+ * @brief A received frame until shown
+ *************************************************************************** */
+static void benchRender(struct Bench &bench, const struct Design &design) {
+    const size_t nLeds = design.display.leds.size();
+    const size_t n = std::min<size_t>(nLeds, MAX_ANNOUNCED);
+    const auto colors = makeColors(nLeds, 3);
+    const auto msg = makeFrame({ colors.begin(), colors.begin() + n }, 3);
+    const float brightness = 0.8f;
+    std::vector<uint32_t> decoded(n);
+
+    /* GUI: decoded into the LEDs (setLedsColor), each drawn at the display's
+     * brightness (updateScene), the scene's items left aside */
+    struct LEDDisplay display = design.display;
+    measure(bench, "render", "scene_colors", design, n, msg.size(), [&]() {
+        struct ClientRequest req;
+        parseRequest(msg.data(), msg.size(), req);
+        size_t count = decodeFrame(req, decoded.data(), decoded.size());
+
+        for (size_t i = 0; i < count; i++) {
+            display.leds[i].color.r = colorR(decoded[i]);
+            display.leds[i].color.g = colorG(decoded[i]);
+            display.leds[i].color.b = colorB(decoded[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            const auto &c = display.leds[i].color;
+            decoded[i] = packColor(c.r * brightness, c.g * brightness,
+                                   c.b * brightness);
+        }
+        sink += decoded[n - 1];
+    });
+
+    Rasterizer raster;
+    raster.setLayout(design.display, RENDER_WIDTH);
+    measure(bench, "render", "offscreen", design, nLeds,
+            raster.getWidth() * raster.getHeight() * sizeof(uint32_t), [&]() {
+        raster.render(colors.data(), brightness);
+        sink += raster.getImage()[0];
+    });
+
+    /* ledserver's path: parsed, power limited, split into chains, acked,
+     * every LED of the design going through the last stages */
+    DisplayServer server;
+    std::vector<uint8_t> answers;
+    double now = 0.0;
+    server.setDisplay(design.display, findLedType("WS2812"));
+    server.setPowerBudget(10000.0);
+    measure(bench, "render", "server_frame", design, nLeds, msg.size(),
+            [&]() {
+        answers.clear();
+        server.handle(msg.data(), msg.size(), now, answers);
+        now += 1.0 / 60.0;
+    });
+}
+
+/** **************************************************************************
+ * @brief Design files, saved then loaded back from the temporary directory:
+ *        JSON (.disp) & binary (.dispb)
+ *************************************************************************** */
+static void benchFiles(struct Bench &bench, const struct Design &design) {
+    const struct {
+        const char *ext, *save, *load;
+    } formats[] = {
+        { ".disp",  "save",     "load"     },
+        { ".dispb", "save_bin", "load_bin" },
+    };
+    const size_t n = design.display.leds.size();
+    std::string error;
+
+    for (const auto &format : formats) {
+        const std::string path = (std::filesystem::temp_directory_path() /
+                                  ("ledcore_bench_" + std::to_string(getpid()) +
+                                   "_" + design.name + format.ext)).string();
+
+        if ( ! saveDisplay(design.display, path, error) ) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            continue;
+        }
+        const size_t bytes = std::filesystem::file_size(path);
+
+        measure(bench, "file", format.save, design, n, bytes, [&]() {
+            if ( ! saveDisplay(design.display, path, error) )
+                std::fprintf(stderr, "%s\n", error.c_str());
+        });
+        measure(bench, "file", format.load, design, n, bytes, [&]() {
+            struct LEDDisplay display;
+            if ( ! loadDisplay(display, path, error) )
+                std::fprintf(stderr, "%s\n", error.c_str());
+            sink += display.leds.size();
+        });
+
+        std::filesystem::remove(path);
+    }
+}
+
+static std::string timestamp() {
+    char text[32];
+    std::time_t now = std::time(nullptr);
+
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return text;
+}
+
+static bool writeJson(const struct Bench &bench, const std::string &path,
+                      const std::vector<struct Design> &designs) {
+    nlohmann::ordered_json doc;
+
+    doc["benchmark"] = "ledcore_bench";
+    doc["timestamp"] = timestamp();
+    doc["host"] = { { "threads", std::thread::hardware_concurrency() },
+#if defined(__VERSION__)
+                    { "compiler", __VERSION__ },
+#endif
+#if defined(__SSE2__)
+                    { "sse2", true },
+#else
+                    { "sse2", false },
+#endif
+#if defined(NDEBUG)
+                    { "optimized", true },
+#else
+                    { "optimized", false },
+#endif
+                  };
+    doc["min_time_s"] = bench.minTime;
+
+    doc["designs"] = nlohmann::ordered_json::array();
+    for (const auto &design : designs)
+        doc["designs"].push_back({ { "name", design.name },
+                                   { "leds", design.display.leds.size() },
+                                   { "groups", design.display.groups.size() } });
+
+    doc["results"] = nlohmann::ordered_json::array();
+    for (const auto &res : bench.results) {
+        nlohmann::ordered_json entry = {
+            { "group", res.group }, { "name", res.name },
+            { "design", res.design }, { "leds", res.leds },
+            { "iterations", res.iterations },
+            { "ns_per_op", res.nsMedian }, { "ns_per_op_min", res.nsMin },
+            { "ns_per_led", res.leds ? res.nsMedian / res.leds : 0.0 },
+        };
+        if (res.bytes) {
+            entry["bytes"] = res.bytes;
+            entry["mb_per_s"] = res.bytes / res.nsMedian * 1e3;
+        }
+        doc["results"].push_back(entry);
+    }
+
+    if (path == "-") {
+        std::printf("%s\n", doc.dump(2).c_str());
+        return true;
+    }
+
+    std::ofstream file(path);
+    file << doc.dump(2) << std::endl;
+    if ( ! file ) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/** **************************************************************************
+ * @brief Main application function
+ *************************************************************************** */
+int main(int argc, char **argv) {
+    const char *shipped[] = { "7Seg_L3", "BMTH-LudensStar" };
+    const size_t sizes[] = { 10000, 100000, 1000000 };
+    std::string output = "-", dir = LEDS_DISPLAYS_DIR;
+    size_t maxLeds = 1000000;
+    struct Bench bench;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:t:m:f:D:")) != -1) {
+        switch (opt) {
+        case 'o': output       = optarg;                         break;
+        case 't': bench.minTime = std::atof(optarg);             break;
+        case 'm': maxLeds      = std::strtoul(optarg, nullptr, 0); break;
+        case 'f': bench.filter = optarg;                         break;
+        case 'D': dir          = optarg;                         break;
+        default:  usage(argv[0]);
+        }
+    }
+    if (optind != argc || bench.minTime <= 0.0)
+        usage(argv[0]);
+
+    std::vector<struct Design> designs;
+    for (const char *name : shipped) {
+        struct Design design = { name, {} };
+        std::string error;
+
+        if ( ! loadDisplay(design.display, dir + "/" + name + ".disp", error) ) {
+            std::fprintf(stderr, "%s, skipped\n", error.c_str());
+            continue;
+        }
+        designs.push_back(std::move(design));
+    }
+    for (size_t n : sizes)
+        if (n <= maxLeds)
+            designs.push_back({ "grid_" + std::to_string(n),
+                                generateDesign(grid(n)) });
+
+    std::fprintf(stderr, "%-8s %-14s %-16s %8s %14s %10s %9s\n", "group",
+                 "case", "design", "LEDs", "ns/op", "ns/LED", "MB/s");
+
+    for (const auto &design : designs) {
+        if (design.display.leds.empty())
+            continue;
+        benchParse(bench, design);
+        benchKernels(bench, design);
+        benchRender(bench, design);
+        benchFiles(bench, design);
+    }
+
+    return writeJson(bench, output, designs) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,85 @@
+/* ************************************************************************** *
+ * ***         SCALING OF THE FRAME PIPELINE FROM 1 TO N THREADS          *** *
+ * ************************************************************************** *
+ * usage: pipeline_bench [max_threads]
+ *
+ * Runs a shader stage followed by a brightness stage over synthetic square
+ * grids of 1k, 100k & 1M LEDs, with pools of 1 to max_threads threads
+ * (default: # of cores).                                                     */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../engine/color.h"
+#include "../engine/designgen.h"
+#include "../engine/geometry.h"
+#include "../engine/pipeline.h"
+#include "../engine/shader.h"
+#include "../engine/threadpool.h"
+
+static const char *SHADER_SRC =
+    "h = fract(angle / (2 * pi) + radius + time * 0.25);\n"
+    "r = clamp(abs(h * 6 - 3) - 1, 0, 1);\n"
+    "g = clamp(2 - abs(h * 6 - 2), 0, 1);\n"
+    "b = clamp(2 - abs(h * 6 - 4), 0, 1);\n";
+
+int main(int argc, char **argv) {
+    const size_t sizes[] = { 1000, 100000, 1000000 };
+    size_t maxThreads = argc > 1 ? std::atoi(argv[1])
+                                 : std::thread::hardware_concurrency();
+    ShaderProgram shader;
+
+    maxThreads = std::max<size_t>(maxThreads, 1);
+    if ( ! shader.compile(SHADER_SRC) ) {
+        std::fprintf(stderr, "Shader: %s\n", shader.getError().c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%10s %8s %12s %10s\n", "LEDs", "threads", "ms/frame", "speedup");
+
+    for (size_t n : sizes) {
+        struct LEDGeometry geometry;
+        ColorBuffer frame(n);
+        double reference = 0.0;
+
+        struct DesignSpec spec;
+        spec.shape = SHAPE_GRID;
+        spec.leds  = n;
+        geometry.build(generateDesign(spec));
+
+        for (size_t threads = 1; threads <= maxThreads; threads++) {
+            ThreadPool pool(threads);
+            FramePipeline pipeline(pool);
+            float time = 0.0f;
+
+            pipeline.addStage([&](uint32_t *out, size_t first, size_t last) {
+                shader.evaluate(geometry, time, out, first, last);
+            });
+            /* Stands for a color correction: 75% brightness */
+            pipeline.addStage([](uint32_t *out, size_t first, size_t last) {
+                for (size_t i = first; i < last; i++)
+                    out[i] = lerpColor(0, out[i], 0.75f);
+            });
+
+            /* Enough frames for ~1e8 LEDs evaluated, at least 10 */
+            const size_t frames = std::max<size_t>(10, 100000000 / n / 10);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t f = 0; f < frames; f++, time += 1.0f / 60.0f)
+                pipeline.run(frame.data(), 0, n);
+            auto stop = std::chrono::steady_clock::now();
+
+            double ms = std::chrono::duration<double, std::milli>(stop - start)
+                            .count() / frames;
+            if (threads == 1)
+                reference = ms;
+
+            std::printf("%10zu %8zu %12.4f %9.2fx\n", n, threads, ms,
+                        reference / ms);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+#include "displaydialog.h"
+
+#include <QFileDialog>
+#include <QCoreApplication>
+
+bool openDisplay(struct LEDDisplay& display, std::string &fname) {
+    QString filename = QFileDialog::getOpenFileName(nullptr, QFileDialog::tr("Open display"),
+                                                    QDir::currentPath()+"/../../displays/",
+                                                    QFileDialog::tr("Display file (*.disp *.display *.dispb)"/*;;All files (*)"*/));
+    if ( filename.isNull() ) {
+        return false;
+    }
+
+    QFileInfo infos(filename);
+    fname = infos.fileName().toStdString();
+
+    /* If one of the supported suffix is present, .compare() will return 0 as success.
+       With the AND op., we simply "overwrite" the other's result. */
+    if (infos.suffix().compare("disp") & infos.suffix().compare("display") &
+        infos.suffix().compare("dispb")) {
+        return false;
+    }
+
+    // Update Window's Title & variables ONLY if file:
+    //  -> Exists
+    //  -> Is completely valid
+    std::string error;
+    return loadDisplay(display, filename.toStdString(), error);
+}
+
+bool saveDisplay(const LEDDisplay& display) {
+    QString filename = QFileDialog::getSaveFileName(nullptr, QFileDialog::tr("Save display"),
+                                                    QDir::currentPath(),
+                                                    QFileDialog::tr("Display file (*.disp);;Binary display file (*.dispb)"));
+    if ( filename.isNull() ) {
+        return false;
+    }
+
+    std::string error;
+    return saveDisplay(display, filename.toStdString(), error);
+}
@@ -0,0 +1,13 @@
+#ifndef __DISPLAYDIALOG_H__
+#define __DISPLAYDIALOG_H__
+
+#include <string>
+
+#include "structure/display.h"
+
+/* Design files chosen with Qt's dialogs, read/written by loadDisplay() &
+ * saveDisplay() */
+bool openDisplay(struct LEDDisplay &display, std::string &fname);
+bool saveDisplay(const LEDDisplay& display);
+
+#endif // __DISPLAYDIALOG_H__
@@ -14,6 +14,8 @@
 #include <QGraphicsTextItem>
 #include <QColor>
 #include <QFont>
+#include <QPainter>
+#include <QTimer>
 
 /* Custom scene & view common libraries: */
 #include <cstddef>  /* size_t */
@@ -22,6 +24,8 @@
 
 #include "structure/led.h"      /* struct LED */
 #include "structure/display.h"  /* struct LEDDisplay */
+#include "engine/color.h"       /* color[R|G|B](), packColor() */
+#include "engine/trace.h"       /* TRACE_*() */
 
 /* ************************************************************************** *
  * ***                     CUSTOMISED DRAWABLE SCENE                      *** *
@@ -104,14 +108,21 @@ void DisplayScene::addLedToDisplay(const QPointF &pos, double radius,
     led.position.y = pos.y() - radius / 2.0;
 
     display.leds.push_back(led);
+    extent.added(display.leds);
+    generation++;
 }
 
 inline void DisplayScene::removeLedAt(int idx) {
+    extent.removing(display.leds, idx);
     display.leds.erase(display.leds.begin()+idx);
+    generation++;
 }
 
 inline void DisplayScene::removeAllLeds() {
     display.leds.erase(display.leds.begin(), display.leds.end());
+    /* Chains are kept, for the LEDs drawn next */
+    extent.build(display);
+    generation++;
 }
 
 size_t DisplayScene::getNumberOfLeds() {
@@ -130,13 +141,54 @@ void DisplayScene::setLedAtIndex(int i, uint8_t r, uint8_t g, uint8_t b) {
     led.color.b = b;
 }
 
+/* Inclusive range, clamped to the design as groups may outlive removed LEDs */
+void DisplayScene::fillLeds(size_t start, size_t end,
+                            uint8_t r, uint8_t g, uint8_t b) {
+    for (size_t i = start; i <= end && i < display.leds.size(); i++) {
+        struct LED& led = display.leds[i];
+
+        led.color.r = r;
+        led.color.g = g;
+        led.color.b = b;
+    }
+}
+
+/* Inclusive range, words are indexed like the LEDs: <R><G><B><W> */
+void DisplayScene::setLeds(size_t start, size_t end, const uint32_t *words) {
+    for (size_t i = start; i <= end && i < display.leds.size(); i++) {
+        struct LED& led = display.leds[i];
+
+        led.color.r = colorR(words[i]);
+        led.color.g = colorG(words[i]);
+        led.color.b = colorB(words[i]);
+    }
+}
+
+/* words must hold getNumberOfLeds() colors */
+void DisplayScene::getLeds(uint32_t *words) {
+    for (size_t i = 0; i < display.leds.size(); i++) {
+        const auto &color = display.leds[i].color;
+        words[i] = packColor(color.r, color.g, color.b);
+    }
+}
+
 void DisplayScene::setDisplay(const struct LEDDisplay& display) {
     this->display = display;
+    extent.build(this->display);
+    generation++;
 }
 
 const struct LEDDisplay& DisplayScene::getDisplay() {
     return display;
 }
+
+const DesignExtent& DisplayScene::getExtent() {
+    return extent;
+}
+
+uint64_t DisplayScene::getGeneration() {
+    return generation;
+}
 /* ************************************************************************** */
 
 /* ************************************************************************** *
@@ -162,8 +214,12 @@ void DynamicDisplay::setSceneRect(qreal x, qreal y, qreal w, qreal h) {
 }
 
 void DynamicDisplay::updateScene() {
+    TRACE_SCOPE("scene", Tracer::NO_ID);
     static int i = 0;
 
+    if ( ! renderStart )
+        renderStart = LatencyStats::clock();
+
     scene->clear();
 
     if (xRay) {
@@ -184,7 +240,9 @@ void DynamicDisplay::updateScene() {
     } else {
         for (i = 0; i < scene->getNumberOfLeds(); i++) {
             auto led = scene->getLedAtIndex(i);
-            auto color = QColor(led.color.r, led.color.g, led.color.b);
+            auto color = QColor(led.color.r * brightness,
+                                led.color.g * brightness,
+                                led.color.b * brightness);
 
             /* LED chip's case */
             QGraphicsRectItem *r = scene->addRect(led.position.x, led.position.y, led.radius, led.radius, QPen(Qt::black), QColor(0xE0, 0xE0, 0xE0));
@@ -212,6 +270,14 @@ const struct LEDDisplay& DynamicDisplay::getDisplay() {
     return scene->getDisplay();
 }
 
+const DesignExtent& DynamicDisplay::getExtent() {
+    return scene->getExtent();
+}
+
+uint64_t DynamicDisplay::getGeneration() {
+    return scene->getGeneration();
+}
+
 size_t DynamicDisplay::getNumberOfLeds() {
     return scene->getNumberOfLeds();
 }
@@ -220,10 +286,106 @@ void DynamicDisplay::setLedColor(int idx, QColor color) {
     scene->setLedAtIndex(idx, color.red(), color.green(), color.blue());
 }
 
+void DynamicDisplay::fillLedsColor(size_t start, size_t end, QColor color) {
+    scene->fillLeds(start, end, color.red(), color.green(), color.blue());
+}
+
+void DynamicDisplay::setLedsColor(size_t start, size_t end,
+                                  const uint32_t *words) {
+    scene->setLeds(start, end, words);
+}
+
+void DynamicDisplay::getLedsColor(uint32_t *words) {
+    scene->getLeds(words);
+}
+
+void DynamicDisplay::setBrightness(float k) {
+    brightness = k;
+}
+
 void DynamicDisplay::toggleXRay() {
     xRay = !xRay;
 }
 
+void DynamicDisplay::setLatency(LatencyStats *latency) {
+    this->latency = latency;
+    renderStart = 0;
+}
+
+void DynamicDisplay::toggleOverlay() {
+    overlay = !overlay;
+
+    if ( ! overlayTimer ) {
+        overlayTimer = new QTimer(this);
+        connect(overlayTimer, &QTimer::timeout,
+                this, [=]() { sampleOverlay(); } );
+    }
+
+    if (overlay) {
+        last = {};
+        overlayText = QString("Measuring...");
+        sampleOverlay();
+        overlayTimer->start(OVERLAY_PERIOD_MS);
+        /* Drawn over the view: scrolling mustn't move it */
+        setViewportUpdateMode(ViewportUpdateMode::FullViewportUpdate);
+    } else {
+        overlayTimer->stop();
+        setViewportUpdateMode(ViewportUpdateMode::MinimalViewportUpdate);
+    }
+    viewport()->update();
+}
+
+void DynamicDisplay::setStreamStats(const struct StreamStats *stats) {
+    stream = stats;
+}
+
+/** **************************************************************************
+ * @brief Rates since the last sample, from the counters' increase
+ *        Counters reset meanwhile (new client, new design) give 0
+ *************************************************************************** */
+void DynamicDisplay::sampleOverlay() {
+    struct OverlaySample now = {};
+
+    now.t          = LatencyStats::clock();
+    now.rendered   = rendered;
+    now.paintTime  = paintTime;
+    if (stream)
+        now.stream = *stream;
+    if (latency) {
+        const LatencyHistogram &parse = latency->getStage(LATENCY_PARSE);
+        now.parsed    = parse.getCount();
+        now.parseTime = parse.getTotal();
+    }
+
+    if (last.t) {
+        const double dt = (now.t - last.t) / 1e9;
+        auto perSecond = [dt](uint64_t from, uint64_t to) {
+            return to > from ? (to - from) / dt : 0.0;
+        };
+        auto mean = [](uint64_t n0, uint64_t n1, uint64_t t0, uint64_t t1) {
+            return n1 > n0 && t1 > t0 ? (double)(t1 - t0) / (n1 - n0) : 0.0;
+        };
+
+        overlayText = QString::asprintf(
+            "Ingest     : %8.1f fps\n"
+            "Render     : %8.1f fps\n"
+            "Dropped    : %8.1f fps (%llu)\n"
+            "Parse time : %8.1f us\n"
+            "Paint time : %8.2f ms\n"
+            "Stream     : %8.1f kB/s",
+            perSecond(last.stream.frames, now.stream.frames),
+            perSecond(last.rendered, now.rendered),
+            perSecond(last.stream.dropped, now.stream.dropped),
+            (unsigned long long)now.stream.dropped,
+            mean(last.parsed, now.parsed, last.parseTime, now.parseTime) / 1e3,
+            mean(last.rendered, now.rendered,
+                 last.paintTime, now.paintTime) / 1e6,
+            perSecond(last.stream.bytes, now.stream.bytes) / 1e3);
+    }
+    last = now;
+    viewport()->update();
+}
+
 /*void DynamicDisplay::mouseMoveEvent(QMouseEvent *event) {
     /* Idea for making a preview * /
     if (mouseEvent->button() == Qt::LeftButton &&
@@ -248,5 +410,46 @@ void DynamicDisplay::mouseReleaseEvent(QMouseEvent *event) {
     }
 }
 
-//void DynamicDisplay::paintEvent(QPaintEvent *pQEvent) {}
+/* Scenes rebuilt are on screen once painted */
+void DynamicDisplay::paintEvent(QPaintEvent *event) {
+    const uint64_t paintStart = LatencyStats::clock();
+    {
+        TRACE_SCOPE("paint", rendered + 1);
+        QGraphicsView::paintEvent(event);
+    }
+
+    if (renderStart) {
+        const uint64_t end = LatencyStats::clock();
+
+        rendered++;
+        /* The paint alone, the wait for the event loop being in latency */
+        paintTime += end - paintStart;
+        if (latency)
+            latency->presented(renderStart, end);
+        renderStart = 0;
+    }
+}
+
+/* Performance overlay: painted over the scene, without any item */
+void DynamicDisplay::drawForeground(QPainter *painter, const QRectF &rect) {
+    if ( ! overlay )
+        return;
+
+    QFont font("Monospace", 9);
+    font.setStyleHint(QFont::TypeWriter);
+
+    painter->save();
+    /* In the view's pixels: neither zoomed nor scrolled */
+    painter->resetTransform();
+    painter->setFont(font);
+
+    QRectF box = painter->boundingRect(QRectF(8, 8, viewport()->width(),
+                                              viewport()->height()),
+                                       Qt::AlignLeft | Qt::AlignTop,
+                                       overlayText);
+    painter->fillRect(box.adjusted(-4, -4, 4, 4), QColor(0, 0, 0, 160));
+    painter->setPen(Qt::white);
+    painter->drawText(box, Qt::AlignLeft | Qt::AlignTop, overlayText);
+    painter->restore();
+}
 /* ************************************************************************** */
@@ -17,6 +17,7 @@
 
 /* Custom modules: */
 #include "structure/display.h"  /* struct LEDDisplay */
+#include "engine/extent.h"      /* DesignExtent */
 
 class DisplayScene : public QGraphicsScene {
 
@@ -41,10 +42,17 @@ public:
     /* */
     struct LED getLedAtIndex(int i);
     void       setLedAtIndex(int i, uint8_t r, uint8_t g, uint8_t b);
+    void       fillLeds(size_t start, size_t end,
+                        uint8_t r, uint8_t g, uint8_t b);
+    void       setLeds(size_t start, size_t end, const uint32_t *words);
+    void       getLeds(uint32_t *words);
 
     /* */
     void setDisplay(const struct LEDDisplay& display);
     const struct LEDDisplay& getDisplay();
+    const DesignExtent& getExtent();
+    /* Bumped on every LED added/removed & design set */
+    uint64_t getGeneration();
 
 protected:
     //void mouseMoveEvent(QGraphicsSceneMouseEvent *mouseEvent)    override;
@@ -54,6 +62,9 @@ protected:
 private:
     /* LED Display structure used for export/import as JSON */
     struct LEDDisplay display;
+    /* Follows every LED added/removed */
+    DesignExtent extent;
+    uint64_t     generation = 0;
 };
 
 #endif // __DISPLAY_SCENE_H__
@@ -69,12 +80,23 @@ private:
 #include <QGraphicsView>
 #include <QColor>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QTimer>
 
 /* C/C++ standard libraries: */
 #include <cstddef>  /* size_t */
+#include <cstdint>  /* uint64_t */
 
 /* Custom modules: */
 #include "structure/display.h"
+#include "engine/latency.h"     /* LatencyStats */
+
+/* Clients' stream, counted by the one receiving it */
+struct StreamStats {
+    uint64_t frames;            /* "!C" received                          */
+    uint64_t dropped;           /* Held back, then replaced by a newer one */
+    uint64_t bytes;             /* Length prefixes included               */
+};
 
 class DynamicDisplay : public QGraphicsView {
 
@@ -91,24 +113,68 @@ public:
     /* Drawable scene accessors */
     void setDisplay(const struct LEDDisplay& display);
     const struct LEDDisplay& getDisplay();
+    const DesignExtent& getExtent();
+    /* Tells layouts taken from the design apart, see DisplayScene's */
+    uint64_t getGeneration();
     size_t getNumberOfLeds();
     void setLedColor(int idx, QColor color);
+    void fillLedsColor(size_t start, size_t end, QColor color);
+    void setLedsColor(size_t start, size_t end, const uint32_t *words);
+    void getLedsColor(uint32_t *words);
+    /* Shown colors scaled by k in [0;1], the LEDs' own colors are kept */
+    void setBrightness(float k);
 
     /* */
     void toggleXRay();
 
+    /* Told when the frames applied are painted, nullptr for none */
+    void setLatency(LatencyStats *latency);
+
+    /* Rates of the stream & of the rendering over the view, refreshed every
+     * OVERLAY_PERIOD_MS. Read from stats & the latency's stages */
+    void toggleOverlay();
+    void setStreamStats(const struct StreamStats *stats);
+
 protected:
     //virtual void mouseMoveEvent(QMouseEvent *mouseEvent) override;
     //virtual void mousePressEvent(QMouseEvent *event)     override;
     virtual void mouseReleaseEvent(QMouseEvent *event)   override;
 
-    //virtual void paintEvent(QPaintEvent *pQEvent) override;
+    virtual void paintEvent(QPaintEvent *event) override;
+    virtual void drawForeground(QPainter *painter,
+                                const QRectF &rect) override;
 
 private:
     DisplayScene  *scene;
 
     /* X-Ray view status */
     bool xRay = false;
+    /* Applied when drawing (power limitation) */
+    float brightness = 1.0f;
+
+    /* Scene rebuilt since last paint, from then [ns] */
+    LatencyStats *latency = nullptr;
+    uint64_t renderStart = 0;
+
+    /* Performance overlay: counters at the last sample & rates since */
+    static constexpr int OVERLAY_PERIOD_MS = 500;
+    struct OverlaySample {
+        uint64_t t;             /* [ns]                                   */
+        struct StreamStats stream;
+        uint64_t rendered;
+        uint64_t paintTime;     /* [ns]                                   */
+        uint64_t parsed;
+        uint64_t parseTime;     /* [ns]                                   */
+    };
+    void sampleOverlay();
+
+    bool overlay = false;
+    QTimer *overlayTimer = nullptr;
+    const struct StreamStats *stream = nullptr;
+    uint64_t rendered   = 0;
+    uint64_t paintTime  = 0;
+    struct OverlaySample last = {};
+    QString overlayText;
 };
 
 #endif // __DYNAMIC_DISPLAY_H__
@@ -0,0 +1,288 @@
+#include "animexport.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "cexport.h"
+#include "../../firmware/anim_decoder.h"
+
+/* Decoding cost model of anim_decoder.c, in cycles of a single-issue 32-bit
+ * MCU without cache (1-2 per load/store, 2-3 per taken branch). Estimates:
+ * the worst case is what matters to size the frame rate, not the exact count */
+static constexpr uint64_t CYCLES_FRAME        = 24;   /* Call, duration, END   */
+static constexpr uint64_t CYCLES_OP           = 16;   /* Header, checks, switch */
+static constexpr uint64_t CYCLES_VARINT_BYTE  =  8;
+static constexpr uint64_t CYCLES_RUN_LED      =  3;   /* Store & loop          */
+static constexpr uint64_t CYCLES_PALETTE_LED  = 14;   /* Index, check, lookup  */
+static constexpr uint64_t CYCLES_RAW_LED      = 12;   /* 4 byte loads & shifts */
+static constexpr uint64_t CYCLES_CLEAR_LED    =  1;   /* 1st frame's memset()  */
+
+/* Unchanged LEDs kept inside a literal rather than splitting it (palette) */
+static constexpr size_t LITERAL_MAX_GAP       =  1;
+
+void AnimationRecorder::start(size_t nLeds) {
+    this->nLeds = nLeds;
+    frames.clear();
+    times.clear();
+    endMs = 0;
+}
+
+void AnimationRecorder::addFrame(uint32_t timeMs, const uint32_t *colors) {
+    if ( ! times.empty() &&
+         std::equal(colors, colors + nLeds, frames.end() - nLeds) )
+        return;
+
+    frames.insert(frames.end(), colors, colors + nLeds);
+    times.push_back(timeMs);
+}
+
+void AnimationRecorder::stop(uint32_t timeMs) {
+    endMs = timeMs;
+}
+
+/* Cost of the frame being encoded */
+struct FrameCost {
+    size_t   ops;
+    size_t   leds;
+    uint64_t cycles;
+};
+
+static void putU16(std::vector<uint8_t> &out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+static void putU32(std::vector<uint8_t> &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(value >> shift);
+}
+
+static void putOp(std::vector<uint8_t> &out, uint8_t type, size_t n,
+                  struct FrameCost &cost) {
+    cost.ops++;
+    cost.cycles += CYCLES_OP;
+
+    if (n - 1 < ANIM_OP_LEN_EXTENDED) {
+        out.push_back(type << 6 | (n - 1));
+        return;
+    }
+
+    /* LEB128 */
+    out.push_back(type << 6 | ANIM_OP_LEN_EXTENDED);
+    n -= 64;
+    do {
+        out.push_back((n & 0x7F) | (n > 0x7F ? 0x80 : 0));
+        cost.cycles += CYCLES_VARINT_BYTE;
+        n >>= 7;
+    } while (n);
+}
+
+void AnimationRecorder::encode(std::vector<uint8_t> &out,
+                               struct AnimationReport &report) const {
+    std::unordered_map<uint32_t, uint8_t> palette;
+    std::vector<uint32_t> paletteColors;
+    bool usePalette = true;
+
+    /* Palette by order of appearance */
+    for (uint32_t color : frames) {
+        if (palette.count(color))
+            continue;
+        if (paletteColors.size() == ANIM_PALETTE_MAX) {
+            usePalette = false;
+            paletteColors.clear();
+            break;
+        }
+        palette[color] = paletteColors.size();
+        paletteColors.push_back(color);
+    }
+
+    const size_t maxGap  = usePalette ? LITERAL_MAX_GAP : 0;
+    /* Length from which a run is cheaper than carrying on the literal */
+    const size_t minRun  = usePalette ? 4 : 2;
+    const uint64_t cyclesLiteral = usePalette ? CYCLES_PALETTE_LED :
+                                                CYCLES_RAW_LED;
+
+    auto putColor = [&](uint32_t color) {
+        if (usePalette)
+            out.push_back(palette[color]);
+        else
+            putU32(out, color);
+    };
+
+    /* Explicit length: inserting from the literal warns at -O2 */
+    out.assign(4, 0);
+    std::memcpy(out.data(), ANIM_MAGIC, 4);
+    out.push_back(ANIM_VERSION);
+    out.push_back(usePalette ? ANIM_FLAG_PALETTE : 0);
+    putU16(out, paletteColors.size());
+    putU32(out, nLeds);
+    putU32(out, 0);     /* Number of frames, once known */
+    for (uint32_t color : paletteColors)
+        putU32(out, color);
+
+    report = {};
+    report.leds        = nLeds;
+    report.paletteSize = paletteColors.size();
+
+    std::vector<uint32_t> prev(nLeds, 0);
+
+    for (size_t f = 0; f < times.size(); f++) {
+        const uint32_t *cur = frames.data() + f * nLeds;
+        uint32_t end = f + 1 < times.size() ? times[f+1] : endMs;
+        uint32_t duration = end > times[f] ? end - times[f] : 0;
+
+        /* Replaced before being shown */
+        if ( ! duration )
+            continue;
+
+        struct FrameCost cost = { 0, 0, CYCLES_FRAME };
+        if ( ! report.frames )
+            cost.cycles += nLeds * CYCLES_CLEAR_LED;
+
+        auto runLength = [&](size_t i) {
+            size_t j = i + 1;
+            while (j < nLeds && cur[j] == cur[i])
+                j++;
+            return j - i;
+        };
+
+        putU16(out, std::min<uint32_t>(duration, UINT16_MAX));
+
+        for (size_t i = 0; i < nLeds; ) {
+            /* Unchanged, the trailing ones are implied by END */
+            if (cur[i] == prev[i]) {
+                size_t j = i + 1;
+                while (j < nLeds && cur[j] == prev[j])
+                    j++;
+                if (j < nLeds)
+                    putOp(out, ANIM_OP_SKIP, j - i, cost);
+                i = j;
+                continue;
+            }
+
+            size_t run = runLength(i);
+            if (run >= 2) {
+                putOp(out, ANIM_OP_RUN, run, cost);
+                putColor(cur[i]);
+                cost.leds   += run;
+                cost.cycles += run * CYCLES_RUN_LED;
+                i += run;
+                continue;
+            }
+
+            /* Literal up to a long enough gap or run */
+            size_t j = i + 1;
+            while (j < nLeds) {
+                if (cur[j] == prev[j]) {
+                    size_t gap = 1;
+                    while (j + gap < nLeds && cur[j+gap] == prev[j+gap] &&
+                           gap <= maxGap)
+                        gap++;
+                    if (gap > maxGap || j + gap == nLeds)
+                        break;
+                    j += gap;
+                    continue;
+                }
+                if (runLength(j) >= minRun)
+                    break;
+                j++;
+            }
+
+            putOp(out, ANIM_OP_LITERAL, j - i, cost);
+            for (size_t k = i; k < j; k++)
+                putColor(cur[k]);
+            cost.leds   += j - i;
+            cost.cycles += (j - i) * cyclesLiteral;
+            i = j;
+        }
+        out.push_back(ANIM_OP_END << 6);
+
+        if (cost.cycles > report.worstCycles) {
+            report.worstFrame  = report.frames;
+            report.worstOps    = cost.ops;
+            report.worstLeds   = cost.leds;
+            report.worstCycles = cost.cycles;
+        }
+        report.frames++;
+
+        /* Longer than a frame's duration can hold: empty frames */
+        for (duration -= std::min<uint32_t>(duration, UINT16_MAX); duration;
+             duration -= std::min<uint32_t>(duration, UINT16_MAX)) {
+            putU16(out, std::min<uint32_t>(duration, UINT16_MAX));
+            out.push_back(ANIM_OP_END << 6);
+            report.frames++;
+        }
+
+        std::copy(cur, cur + nLeds, prev.begin());
+    }
+
+    for (int b = 0; b < 4; b++)
+        out[12 + b] = report.frames >> (8 * b);
+
+    report.rawBytes     = report.frames * nLeds * sizeof(uint32_t);
+    report.encodedBytes = out.size();
+}
+
+bool AnimationRecorder::save(const std::string &path, AnimationFormat format,
+                             struct AnimationReport &report,
+                             std::string &error) const {
+    std::vector<uint8_t> data;
+    encode(data, report);
+
+    std::ofstream file(path, std::ios::binary);
+    if ( ! (file && file.is_open()) ) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    if (format == ANIM_FORMAT_BLOB) {
+        file.write((const char *)data.data(), data.size());
+        return bool(file);
+    }
+
+    std::string name = cIdentifier(path), upper = name;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+
+    /* Report as comment, each line prefixed */
+    std::string summary = describeReport(report);
+    for (size_t pos = 0; (pos = summary.find('\n', pos)) != std::string::npos;
+         pos += 4)
+        summary.replace(pos, 1, "\n * ");
+
+    file << "/* Animation exported by LEDs Display Creator,"
+            " see firmware/anim_decoder.h\n * "
+         << summary << " */\n\n"
+         << "#include <stdint.h>\n\n"
+         << "#define " << upper << "_LEN (" << data.size() << "u)\n\n";
+    writeCArray(file, "uint8_t", name, data.data(), data.size());
+
+    if ( ! file ) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+std::string describeReport(const struct AnimationReport &report) {
+    char text[512];
+    double ratio = report.encodedBytes ?
+                   (double)report.rawBytes / report.encodedBytes : 0.0;
+
+    std::snprintf(text, sizeof(text),
+                  "%zu frames of %zu LEDs, %s\n"
+                  "%zu bytes instead of %zu (ratio %.1f:1)\n"
+                  "Worst case: frame %zu, %zu ops, %zu LEDs written,"
+                  " ~%llu cycles to decode",
+                  report.frames, report.leds,
+                  report.paletteSize ? ("palette of " +
+                                        std::to_string(report.paletteSize) +
+                                        " colors").c_str() :
+                                       "no palette (too many colors)",
+                  report.encodedBytes, report.rawBytes, ratio,
+                  report.worstFrame, report.worstOps, report.worstLeds,
+                  (unsigned long long)report.worstCycles);
+    return text;
+}
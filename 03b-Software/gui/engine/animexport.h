@@ -0,0 +1,64 @@
+#ifndef __ANIM_EXPORT_H__
+#define __ANIM_EXPORT_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+#include <vector>
+
+enum AnimationFormat {
+    /* Raw bytes, to flash as is */
+    ANIM_FORMAT_BLOB    = 0,
+    /* C header with the bytes as a const array */
+    ANIM_FORMAT_C_ARRAY = 1,
+};
+
+struct AnimationReport {
+    size_t   frames;
+    size_t   leds;
+    /* 0 when there are too many colors for a palette */
+    size_t   paletteSize;
+    /* Full frames, 1 word per LED, like the protocol sends them */
+    size_t   rawBytes;
+    size_t   encodedBytes;
+    /* Frame the longest to decode & its estimated cost */
+    size_t   worstFrame;
+    size_t   worstOps;
+    size_t   worstLeds;
+    uint64_t worstCycles;
+};
+
+/* Records the frames shown and encodes them for the firmware, in the format
+ * read by firmware/anim_decoder.c: delta to the previous frame, RLE and a
+ * palette when there are at most ANIM_PALETTE_MAX colors */
+class AnimationRecorder {
+
+public:
+    void start(size_t nLeds);
+    /* colors[getNumberOfLeds()] shown from timeMs [ms] since start
+     * Merged into the previous frame when identical */
+    void addFrame(uint32_t timeMs, const uint32_t *colors);
+    /* End of the last frame */
+    void stop(uint32_t timeMs);
+
+    size_t getNumberOfLeds() const { return nLeds; }
+    size_t getNumberOfFrames() const { return times.size(); }
+
+    void encode(std::vector<uint8_t> &out, struct AnimationReport &report) const;
+    /* @return false on error, with a message in error */
+    bool save(const std::string &path, AnimationFormat format,
+              struct AnimationReport &report, std::string &error) const;
+
+private:
+    size_t nLeds = 0;
+    /* Frames one after the other, nLeds words each */
+    std::vector<uint32_t> frames;
+    /* Frames' start [ms] */
+    std::vector<uint32_t> times;
+    uint32_t endMs = 0;
+};
+
+/* Human readable summary, a few lines */
+std::string describeReport(const struct AnimationReport &report);
+
+#endif // __ANIM_EXPORT_H__
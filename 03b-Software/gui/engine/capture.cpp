@@ -0,0 +1,547 @@
+#include "capture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if ! defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "protocol.h"
+#include "trace.h"
+
+/* File grown by this much at once, so blocks are contiguous on disk */
+static constexpr uint64_t PREALLOCATION = 64u << 20;
+
+static void putU16(uint8_t *p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        p[i] = value >> (8 * i);
+}
+
+static void putU64(uint8_t *p, uint64_t value) {
+    for (int i = 0; i < 8; i++)
+        p[i] = value >> (8 * i);
+}
+
+static size_t padded(size_t len) {
+    return (len + 7) & ~(size_t)7;
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+uint64_t CaptureWriter::clock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CaptureWriter::open(const std::string &path, enum CaptureMode mode,
+                         size_t nLeds, std::string &error, size_t blockSize,
+                         size_t blocks) {
+    close();
+
+    /* Largest message, as 1 record */
+    blockSize = padded(std::max(blockSize, CAPTURE_BLOCK_HEADER_LEN +
+                                           CAPTURE_RECORD_HEADER_LEN +
+                                           MessageReader::MESSAGE_MAX));
+
+    if ( ! (file = std::fopen(path.c_str(), "wb")) ) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    uint8_t header[CAPTURE_HEADER_LEN] = {};
+    memcpy(header, CAPTURE_MAGIC, 4);
+    header[4] = CAPTURE_VERSION;
+    header[5] = mode;
+    putU16(header + 6, CAPTURE_HEADER_LEN);
+    putU32(header + 8, nLeds);
+    putU32(header + 12, blockSize);
+    putU64(header + 16, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now()
+                                .time_since_epoch()).count());
+
+    if (std::fwrite(header, sizeof(header), 1, file) != 1) {
+        std::fclose(file);
+        file  = nullptr;
+        error = "cannot write " + path;
+        return false;
+    }
+
+    this->mode      = mode;
+    this->nLeds     = nLeds;
+    this->blockSize = blockSize;
+    start = clock();
+
+    /* Allocated & touched now, not while receiving */
+    this->blocks.assign(std::max<size_t>(blocks, 2),
+                        std::vector<uint8_t>(blockSize));
+    produced = 0;
+    consumed = 0;
+    filling  = false;
+    stopping = false;
+
+    offset    = CAPTURE_HEADER_LEN;
+    allocated = 0;
+    index.clear();
+    indexedBlocks  = 0;
+    indexedRecords = 0;
+
+    nRecords = nBytes = nDropped = nBlocksWritten = nWriteErrors = 0;
+
+    writer = std::thread(&CaptureWriter::writerLoop, this);
+    return true;
+}
+
+bool CaptureWriter::close() {
+    if ( ! file )
+        return true;
+
+    submit();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    /* Index & trailer, so readers find any block without scanning */
+    uint8_t header[CAPTURE_INDEX_HEADER_LEN], trailer[CAPTURE_TRAILER_LEN] = {};
+    memcpy(header, CAPTURE_INDEX_MAGIC, 4);
+    putU32(header + 4, indexedBlocks);
+    putU64(header + 8, indexedRecords);
+    putU64(trailer, offset);
+    memcpy(trailer + 12, CAPTURE_TRAILER_MAGIC, 4);
+
+    bool ok = std::fwrite(header, sizeof(header), 1, file) == 1 &&
+              (index.empty() ||
+               std::fwrite(index.data(), index.size(), 1, file) == 1) &&
+              std::fwrite(trailer, sizeof(trailer), 1, file) == 1;
+    ok &= ! std::fclose(file);
+    file = nullptr;
+
+    blocks.clear();
+    blocks.shrink_to_fit();
+    index.clear();
+
+    return ok && ! nWriteErrors;
+}
+
+uint8_t* CaptureWriter::reserve(uint64_t t, uint32_t client,
+                                enum CaptureKind kind, size_t len,
+                                uint8_t comp, uint16_t count) {
+    const size_t total = CAPTURE_RECORD_HEADER_LEN + padded(len);
+
+    t = t > start ? t - start : 0;
+
+    if (CAPTURE_BLOCK_HEADER_LEN + total > blockSize) {
+        nDropped++;
+        return nullptr;
+    }
+
+    if (filling && (fill + total > blockSize ||
+                    (t > fillFirst && t - fillFirst >= FLUSH_INTERVAL)))
+        submit();
+
+    if ( ! filling ) {
+        if (produced.load(std::memory_order_relaxed) -
+            consumed.load(std::memory_order_acquire) >= blocks.size()) {
+            nDropped++;
+            return nullptr;
+        }
+        filling     = true;
+        fill        = CAPTURE_BLOCK_HEADER_LEN;
+        fillRecords = 0;
+        fillFirst   = t;
+    }
+
+    uint8_t *block = blocks[produced.load(std::memory_order_relaxed) %
+                            blocks.size()].data();
+    uint8_t *p = block + fill;
+
+    putU64(p, t);
+    putU32(p + 8, client);
+    putU32(p + 12, len);
+    p[16] = kind;
+    p[17] = comp;
+    putU16(p + 18, count);
+    putU32(p + 20, 0);
+    memset(p + CAPTURE_RECORD_HEADER_LEN + len, 0, padded(len) - len);
+
+    fill += total;
+    fillLast = t;
+    fillRecords++;
+    nRecords.fetch_add(1, std::memory_order_relaxed);
+    nBytes.fetch_add(total, std::memory_order_relaxed);
+
+    return p + CAPTURE_RECORD_HEADER_LEN;
+}
+
+void CaptureWriter::message(uint64_t t, uint32_t client, const uint8_t *msg,
+                            size_t len) {
+    if ( ! file )
+        return;
+
+    struct ClientRequest req;
+    if (mode == CAPTURE_DECODED && parseRequest(msg, len, req) &&
+        req.cmd == CMD_FRAME) {
+        const size_t n = std::min<size_t>(std::min<size_t>(req.count,
+                                                           req.entries),
+                                          nLeds ? nLeds : req.entries);
+        uint8_t *p = reserve(t, client, CAPTURE_FRAME, n * sizeof(uint32_t),
+                             req.comp, req.count);
+        if ( ! p )
+            return;
+
+        /* Aligned: records & their payload start on 8 bytes */
+        uint32_t *colors = (uint32_t *)p;
+        decodeFrame(req, colors, n);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        for (size_t i = 0; i < n; i++)
+            putU32(p + i * sizeof(uint32_t), colors[i]);
+#endif
+        return;
+    }
+
+    uint8_t *p = reserve(t, client, CAPTURE_MESSAGE, len);
+    if (p)
+        memcpy(p, msg, len);
+}
+
+void CaptureWriter::connected(uint64_t t, uint32_t client) {
+    if (file)
+        reserve(t, client, CAPTURE_CONNECT, 0);
+}
+
+void CaptureWriter::disconnected(uint64_t t, uint32_t client) {
+    if (file)
+        reserve(t, client, CAPTURE_DISCONNECT, 0);
+}
+
+void CaptureWriter::tick(uint64_t t) {
+    t = t > start ? t - start : 0;
+    if (file && filling && fillRecords && t > fillFirst &&
+        t - fillFirst >= FLUSH_INTERVAL)
+        submit();
+}
+
+/** **************************************************************************
+ * @brief The block being filled goes to the writer
+ *************************************************************************** */
+void CaptureWriter::submit() {
+    if ( ! filling || ! fillRecords )
+        return;
+
+    const uint64_t n = produced.load(std::memory_order_relaxed);
+    uint8_t *block = blocks[n % blocks.size()].data();
+
+    memcpy(block, CAPTURE_BLOCK_MAGIC, 4);
+    putU32(block + 4, fill - CAPTURE_BLOCK_HEADER_LEN);
+    putU32(block + 8, fillRecords);
+    putU32(block + 12, 0);
+    putU64(block + 16, fillFirst);
+    putU64(block + 24, fillLast);
+
+    filling = false;
+    produced.store(n + 1, std::memory_order_release);
+    /* Not under the lock, not to wait for the writer: a missed wake up only
+     * delays the block until the writer's next timeout */
+    wake.notify_one();
+}
+
+void CaptureWriter::writerLoop() {
+    TRACE_THREAD("capture");
+
+    for (;;) {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(50), [this]() {
+                return stopping || consumed.load(std::memory_order_relaxed) !=
+                                   produced.load(std::memory_order_acquire);
+            });
+            stop = stopping;
+        }
+
+        uint64_t n;
+        while ((n = consumed.load(std::memory_order_relaxed)) !=
+               produced.load(std::memory_order_acquire)) {
+            const uint8_t *block = blocks[n % blocks.size()].data();
+            size_t len = CAPTURE_BLOCK_HEADER_LEN +
+                         (block[4] | block[5] << 8 | block[6] << 16 |
+                          (uint32_t)block[7] << 24);
+
+            writeBlock(block, len);
+            consumed.store(n + 1, std::memory_order_release);
+        }
+
+        if (stop)
+            return;
+    }
+}
+
+void CaptureWriter::writeBlock(const uint8_t *block, size_t len) {
+    TRACE_SCOPE("write", indexedBlocks);
+
+#if defined(__linux__)
+    /* Ahead of the writes, the file's size unchanged: nothing to trim when
+     * closing, nor after a crash */
+    if (offset + len > allocated) {
+        allocated = std::max(offset + len, allocated + PREALLOCATION);
+        fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, 0, allocated);
+    }
+#endif
+
+    if (std::fwrite(block, len, 1, file) != 1) {
+        nWriteErrors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const uint32_t records = block[8] | block[9] << 8 | block[10] << 16 |
+                             (uint32_t)block[11] << 24;
+    uint8_t entry[CAPTURE_INDEX_ENTRY_LEN];
+
+    putU64(entry, offset);
+    putU64(entry + 8, indexedRecords);
+    memcpy(entry + 16, block + 16, 2 * sizeof(uint64_t));
+    index.insert(index.end(), entry, entry + sizeof(entry));
+
+    indexedBlocks++;
+    indexedRecords += records;
+    offset += len;
+    nBlocksWritten.fetch_add(1, std::memory_order_relaxed);
+}
+
+struct CaptureStats CaptureWriter::getStats() const {
+    struct CaptureStats stats;
+
+    stats.records       = nRecords.load(std::memory_order_relaxed);
+    stats.bytes         = nBytes.load(std::memory_order_relaxed);
+    stats.dropped       = nDropped.load(std::memory_order_relaxed);
+    stats.blocksWritten = nBlocksWritten.load(std::memory_order_relaxed);
+    stats.writeErrors   = nWriteErrors.load(std::memory_order_relaxed);
+    return stats;
+}
+
+static uint32_t getU32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t getU64(const uint8_t *p) {
+    return getU32(p) | (uint64_t)getU32(p + 4) << 32;
+}
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const std::string &path, std::string &error) {
+    close();
+
+#if defined(_WIN32)
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if ( ! file ) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    content.resize(std::max<long>(0, std::ftell(file)));
+    std::fseek(file, 0, SEEK_SET);
+    bool ok = content.empty() ||
+              std::fread(content.data(), content.size(), 1, file) == 1;
+    std::fclose(file);
+    if ( ! ok ) {
+        error = "cannot read " + path;
+        return false;
+    }
+    base = content.data();
+    size = content.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0)
+            ::close(fd);
+        error = "cannot open " + path;
+        return false;
+    }
+    size = st.st_size;
+
+    void *map = size < CAPTURE_HEADER_LEN ? MAP_FAILED
+                : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    /* The mapping keeps the file */
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        size  = 0;
+        error = path + " is not a capture";
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    base = (const uint8_t *)map;
+#endif
+
+    const size_t headerLen = size >= CAPTURE_HEADER_LEN ? headerLength() : 0;
+    if (size < CAPTURE_HEADER_LEN || memcmp(base, CAPTURE_MAGIC, 4) ||
+        base[4] != CAPTURE_VERSION || headerLen < CAPTURE_HEADER_LEN ||
+        headerLen > size || headerLen % 8) {
+        close();
+        error = path + " is not a capture";
+        return false;
+    }
+
+    mode      = (enum CaptureMode)base[5];
+    nLeds     = getU32(base + 8);
+    startTime = getU64(base + 16);
+    end       = size;
+
+    /* Index: where the trailer says, matching the file's end exactly */
+    if (size >= headerLen + CAPTURE_INDEX_HEADER_LEN + CAPTURE_TRAILER_LEN &&
+        ! memcmp(base + size - 4, CAPTURE_TRAILER_MAGIC, 4)) {
+        const uint64_t at = getU64(base + size - CAPTURE_TRAILER_LEN);
+
+        if (at >= headerLen &&
+            at <= size - CAPTURE_TRAILER_LEN - CAPTURE_INDEX_HEADER_LEN &&
+            ! memcmp(base + at, CAPTURE_INDEX_MAGIC, 4) &&
+            at + CAPTURE_INDEX_HEADER_LEN +
+            (uint64_t)getU32(base + at + 4) * CAPTURE_INDEX_ENTRY_LEN ==
+            size - CAPTURE_TRAILER_LEN) {
+            indexed  = true;
+            end      = at;
+            nBlocks  = getU32(base + at + 4);
+            nRecords = getU64(base + at + 8);
+            index    = base + at + CAPTURE_INDEX_HEADER_LEN;
+            if (nBlocks)
+                duration = getU64(index + (nBlocks - 1) *
+                                          CAPTURE_INDEX_ENTRY_LEN + 24);
+        }
+    }
+
+    rewind();
+    return true;
+}
+
+void CaptureReader::close() {
+#if defined(_WIN32)
+    content.clear();
+    content.shrink_to_fit();
+#else
+    if (base)
+        munmap((void *)base, size);
+#endif
+    base  = nullptr;
+    size  = 0;
+    index = nullptr;
+    indexed  = false;
+    nBlocks  = 0;
+    nRecords = 0;
+    duration = 0;
+    end       = 0;
+    left      = 0;
+    truncated = false;
+}
+
+void CaptureReader::rewind() {
+    if ( ! base )
+        return;
+    nextBlock = headerLength();
+    left      = 0;
+    truncated = false;
+}
+
+const uint8_t* CaptureReader::blockAt(uint64_t offset) {
+    if (truncated || offset >= end)
+        return nullptr;
+
+    const uint8_t *blk = base + offset;
+    if (end - offset < CAPTURE_BLOCK_HEADER_LEN ||
+        memcmp(blk, CAPTURE_BLOCK_MAGIC, 4) ||
+        getU32(blk + 4) > end - offset - CAPTURE_BLOCK_HEADER_LEN) {
+        truncated = true;
+        return nullptr;
+    }
+    return blk;
+}
+
+bool CaptureReader::next(struct CaptureRecord &rec) {
+    while ( ! left ) {
+        const uint8_t *blk = blockAt(nextBlock);
+        if ( ! blk )
+            return false;
+
+        record    = nextBlock + CAPTURE_BLOCK_HEADER_LEN;
+        nextBlock = record + getU32(blk + 4);
+        left      = getU32(blk + 8);
+    }
+
+    const uint8_t *p = base + record;
+    const size_t room = nextBlock - record;
+    if (room < CAPTURE_RECORD_HEADER_LEN ||
+        padded(getU32(p + 12)) > room - CAPTURE_RECORD_HEADER_LEN) {
+        truncated = true;
+        left = 0;
+        return false;
+    }
+
+    rec.t      = getU64(p);
+    rec.client = getU32(p + 8);
+    rec.len    = getU32(p + 12);
+    rec.kind   = (enum CaptureKind)p[16];
+    rec.comp   = p[17];
+    rec.count  = p[18] | p[19] << 8;
+    rec.data   = p + CAPTURE_RECORD_HEADER_LEN;
+
+    record += CAPTURE_RECORD_HEADER_LEN + padded(rec.len);
+    left--;
+    return true;
+}
+
+void CaptureReader::seek(uint64_t t) {
+    rewind();
+    if ( ! base )
+        return;
+
+    /* 1st block ending at t or later: from the index, or block by block */
+    if (indexed) {
+        uint32_t lo = 0, hi = nBlocks;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (getU64(index + mid * CAPTURE_INDEX_ENTRY_LEN + 24) < t)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        nextBlock = lo < nBlocks ? getU64(index + lo * CAPTURE_INDEX_ENTRY_LEN)
+                                 : end;
+    } else {
+        const uint8_t *blk;
+        while ((blk = blockAt(nextBlock)) && getU64(blk + 24) < t)
+            nextBlock += CAPTURE_BLOCK_HEADER_LEN + getU32(blk + 4);
+    }
+
+    /* Then its records before t skipped */
+    for (;;) {
+        const uint64_t r = record, b = nextBlock;
+        const uint32_t l = left;
+        struct CaptureRecord rec;
+
+        if ( ! next(rec) )
+            return;
+        if (rec.t >= t) {
+            record    = r;
+            nextBlock = b;
+            left      = l;
+            return;
+        }
+    }
+}
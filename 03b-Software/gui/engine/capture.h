@@ -0,0 +1,231 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Capture of the clients' streams (.ledc), for a show to be analysed or
+ * replayed later. All fields in Little Endian, every part 8 bytes aligned so
+ * a mapped file is read in place:
+ *   Header : "LEDC" <u8 version> <u8 mode> <u16 header's length (32)>
+ *            <u32 # of LEDs of the design> <u32 block size>
+ *            <u64 start, ns since the Epoch> <u64 reserved>
+ *   Blocks : "CBLK" <u32 records' length> <u32 # of records> <u32 reserved>
+ *            <u64 1st record's time> <u64 last record's time> <record>*
+ *   Record : <u64 time> <u32 client> <u32 payload's length> <u8 kind>
+ *            <u8 frame's components> <u16 frame's # of LEDs> <u32 reserved>
+ *            <payload, padded to 8 bytes>
+ *   Index  : "CIDX" <u32 # of blocks> <u64 # of records>
+ *            (<u64 block's offset> <u64 its 1st record's #>
+ *             <u64 1st record's time> <u64 last record's time>)*
+ *   Trailer: <u64 index's offset> <u32 reserved> "CEND"
+ * Times are ns since the capture started (steady clock). Without trailer
+ * (capture not closed, crash), the blocks can still be read one by one. */
+
+#define CAPTURE_MAGIC           "LEDC"
+#define CAPTURE_BLOCK_MAGIC     "CBLK"
+#define CAPTURE_INDEX_MAGIC     "CIDX"
+#define CAPTURE_TRAILER_MAGIC   "CEND"
+#define CAPTURE_VERSION         (1u)
+#define CAPTURE_HEADER_LEN      (32u)
+#define CAPTURE_BLOCK_HEADER_LEN  (32u)
+#define CAPTURE_RECORD_HEADER_LEN (24u)
+#define CAPTURE_INDEX_HEADER_LEN  (16u)
+#define CAPTURE_INDEX_ENTRY_LEN   (32u)
+#define CAPTURE_TRAILER_LEN     (16u)
+
+enum CaptureMode {
+    /* Every message as received, length prefix removed */
+    CAPTURE_RAW     = 0,
+    /* Frames decoded into color words (1 per LED), other messages raw */
+    CAPTURE_DECODED = 1,
+};
+
+enum CaptureKind {
+    CAPTURE_MESSAGE     = 0,
+    CAPTURE_FRAME       = 1,    /* Decoded, see CAPTURE_DECODED           */
+    CAPTURE_CONNECT     = 2,    /* No payload                             */
+    CAPTURE_DISCONNECT  = 3,    /* No payload                             */
+};
+
+struct CaptureStats {
+    uint64_t records;
+    uint64_t bytes;             /* Records' in the file, headers included */
+    /* Lost: no free block (writer behind) or larger than a block */
+    uint64_t dropped;
+    uint64_t blocksWritten;
+    uint64_t writeErrors;
+};
+
+/* A record, pointing into the mapped file */
+struct CaptureRecord {
+    uint64_t t;                 /* ns since the capture started           */
+    uint32_t client;
+    enum CaptureKind kind;
+    uint8_t  comp;              /* CAPTURE_FRAME: components sent         */
+    uint16_t count;             /* CAPTURE_FRAME: # of LEDs announced     */
+    const uint8_t *data;
+    size_t   len;
+};
+
+/* Appends records to preallocated blocks, handed to a writer thread once
+ * full: the calling thread (the one receiving) never waits for the disk, a
+ * record finding no free block is dropped & counted instead */
+class CaptureWriter {
+
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 4u << 20;
+    static constexpr size_t DEFAULT_BLOCKS     = 8;
+
+    CaptureWriter() = default;
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter& operator=(const CaptureWriter &) = delete;
+
+    /* nLeds: design's, to decode frames (CAPTURE_DECODED)
+     * blockSize: at least MessageReader::MESSAGE_MAX & headers, rounded up
+     * @return false on error, with a message in error */
+    bool open(const std::string &path, enum CaptureMode mode, size_t nLeds,
+              std::string &error, size_t blockSize = DEFAULT_BLOCK_SIZE,
+              size_t blocks = DEFAULT_BLOCKS);
+    bool isOpen() const { return file != nullptr; }
+    /* Everything written, index included
+     * @return false if some writes failed */
+    bool close();
+
+    /* Steady clock [ns], to timestamp the records where data are received */
+    static uint64_t clock();
+
+    /* A client's message (length prefix removed) received at time t */
+    void message(uint64_t t, uint32_t client, const uint8_t *msg, size_t len);
+    void connected(uint64_t t, uint32_t client);
+    void disconnected(uint64_t t, uint32_t client);
+
+    /* Hand the current block to the writer if it holds records older than
+     * FLUSH_INTERVAL: little is lost on a crash, even with a slow stream */
+    void tick(uint64_t t);
+
+    struct CaptureStats getStats() const;
+
+private:
+    static constexpr uint64_t FLUSH_INTERVAL = 1000000000ull;
+
+    /* Room for a record, nullptr if dropped */
+    uint8_t* reserve(uint64_t t, uint32_t client, enum CaptureKind kind,
+                     size_t len, uint8_t comp = 0, uint16_t count = 0);
+    void submit();
+    void writerLoop();
+    void writeBlock(const uint8_t *block, size_t len);
+
+    std::FILE *file = nullptr;
+    enum CaptureMode mode = CAPTURE_RAW;
+    size_t nLeds     = 0;
+    size_t blockSize = 0;
+    uint64_t start   = 0;
+
+    /* Ring of blocks: [consumed; produced[ wait for the writer, the
+     * receiving thread fills block # produced when there is room */
+    std::vector<std::vector<uint8_t>> blocks;
+    std::atomic<uint64_t> produced { 0 };
+    std::atomic<uint64_t> consumed { 0 };
+    bool     filling = false;   /* Block # produced being filled          */
+    size_t   fill    = 0;       /* Its length                             */
+    uint32_t fillRecords = 0;
+    uint64_t fillFirst   = 0;
+    uint64_t fillLast    = 0;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    /* Writer's: where the next block goes, the index */
+    uint64_t offset    = 0;
+    uint64_t allocated = 0;
+    std::vector<uint8_t> index;
+    uint64_t indexedBlocks  = 0;
+    uint64_t indexedRecords = 0;
+
+    std::atomic<uint64_t> nRecords { 0 };
+    std::atomic<uint64_t> nBytes { 0 };
+    std::atomic<uint64_t> nDropped { 0 };
+    std::atomic<uint64_t> nBlocksWritten { 0 };
+    std::atomic<uint64_t> nWriteErrors { 0 };
+};
+
+/* Reads a capture in place, mapped rather than loaded: replaying a session
+ * of several GB starts right away, the pages being read as records are */
+class CaptureReader {
+
+public:
+    CaptureReader() = default;
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader& operator=(const CaptureReader &) = delete;
+
+    /* @return false on error, with a message in error */
+    bool open(const std::string &path, std::string &error);
+    bool isOpen() const { return base != nullptr; }
+    void close();
+
+    enum CaptureMode getMode() const { return mode; }
+    size_t getNumberOfLeds() const { return nLeds; }
+    /* ns since the Epoch */
+    uint64_t getStartTime() const { return startTime; }
+    /* Index & trailer found: the capture was closed properly */
+    bool isIndexed() const { return indexed; }
+    /* Without index: 0, the blocks are only known once read */
+    uint64_t getNumberOfRecords() const { return nRecords; }
+    /* Last record's time, 0 without index */
+    uint64_t getDuration() const { return duration; }
+    size_t getSize() const { return size; }
+
+    /* Next record, from the 1st one or the one seek() found
+     * @return false at the end, or if the rest is corrupted (isTruncated()) */
+    bool next(struct CaptureRecord &rec);
+    /* Next records from the 1st one at time t or later */
+    void seek(uint64_t t);
+    void rewind();
+    bool isTruncated() const { return truncated; }
+
+private:
+    size_t headerLength() const { return base[6] | base[7] << 8; }
+    /* Block at offset, nullptr if there's none (end, corrupted) */
+    const uint8_t* blockAt(uint64_t offset);
+
+    const uint8_t *base = nullptr;
+    size_t size = 0;
+#if defined(_WIN32)
+    std::vector<uint8_t> content;
+#endif
+
+    enum CaptureMode mode = CAPTURE_RAW;
+    size_t   nLeds     = 0;
+    uint64_t startTime = 0;
+    bool     indexed   = false;
+    /* Index's entries, in the file */
+    const uint8_t *index = nullptr;
+    uint32_t nBlocks   = 0;
+    uint64_t nRecords  = 0;
+    uint64_t duration  = 0;
+    /* Blocks end there: index, or end of file */
+    uint64_t end       = 0;
+
+    /* Reading position: next record, records left in its block & where the
+     * next block starts */
+    uint64_t record    = 0;
+    uint32_t left      = 0;
+    uint64_t nextBlock = 0;
+    bool     truncated = false;
+};
+
+#endif // __CAPTURE_H__
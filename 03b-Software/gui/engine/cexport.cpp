@@ -0,0 +1,47 @@
+#include "cexport.h"
+
+#include <cctype>
+#include <cstdio>
+
+std::string cIdentifier(const std::string &name) {
+    size_t slash = name.find_last_of("/\\");
+    std::string id = name.substr(slash == std::string::npos ? 0 : slash + 1);
+    id = id.substr(0, id.find('.'));
+
+    for (char &c : id)
+        if ( ! std::isalnum((unsigned char)c) )
+            c = '_';
+    if (id.empty() || std::isdigit((unsigned char)id[0]))
+        id = "_" + id;
+
+    return id;
+}
+
+/* Values per line, for the lines to stay around 80 columns */
+static size_t perLine(int digits) {
+    return 72 / (digits + 4);
+}
+
+void writeCArray(std::ostream &out, const char *type, const std::string &name,
+                 const uint32_t *data, size_t n, int digits) {
+    char hex[16];
+
+    out << "static const " << type << " " << name << "[" << n << "] = {";
+    for (size_t i = 0; i < n; i++) {
+        std::snprintf(hex, sizeof(hex), "0x%0*x,", digits, data[i]);
+        out << (i % perLine(digits) ? " " : "\n        ") << hex;
+    }
+    out << "\n};\n";
+}
+
+void writeCArray(std::ostream &out, const char *type, const std::string &name,
+                 const uint8_t *data, size_t n) {
+    char hex[8];
+
+    out << "static const " << type << " " << name << "[" << n << "] = {";
+    for (size_t i = 0; i < n; i++) {
+        std::snprintf(hex, sizeof(hex), "0x%02x,", data[i]);
+        out << (i % perLine(2) ? " " : "\n        ") << hex;
+    }
+    out << "\n};\n";
+}
@@ -0,0 +1,20 @@
+#ifndef __C_EXPORT_H__
+#define __C_EXPORT_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <ostream>
+#include <string>
+
+/* Helpers writing C headers for the firmware */
+
+/* Valid C identifier from a name (file's stem when given a path) */
+std::string cIdentifier(const std::string &name);
+
+/* "static const <type> <name>[<n>] = { ... };", values in hexadecimal */
+void writeCArray(std::ostream &out, const char *type, const std::string &name,
+                 const uint8_t *data, size_t n);
+void writeCArray(std::ostream &out, const char *type, const std::string &name,
+                 const uint32_t *data, size_t n, int digits);
+
+#endif // __C_EXPORT_H__
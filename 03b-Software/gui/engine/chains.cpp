@@ -0,0 +1,224 @@
+#include "chains.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "cexport.h"
+
+/* Bit shift of a channel in a color word (see color.h) */
+static uint8_t channelShift(char channel) {
+    switch (channel) {
+    case 'G':   return 8;
+    case 'B':   return 16;
+    case 'W':   return 24;
+    default:    return 0;
+    }
+}
+
+void ChainPartitioner::setLayout(const struct LEDDisplay &display,
+                                 const struct LEDType &defaultType) {
+    std::vector<uint8_t> drivenBy(display.leds.size(), 0);
+
+    nLeds = display.leds.size();
+    chains.clear();
+    order.clear();
+    orderOfst.clear();
+    shifts.clear();
+    bufferOfst.clear();
+
+    /* Whole design, in index order */
+    std::vector<struct LEDChain> layout = display.chains;
+    if (layout.empty() && nLeds)
+        layout.push_back({ "all", 0, "", { { 0, (uint32_t)nLeds - 1 } } });
+
+    size_t bufferLen = 0;
+    for (const auto &chain : layout) {
+        struct ChainInfo info;
+
+        info.name   = chain.name;
+        info.pin    = chain.pin;
+        info.type = chain.type.empty() ? &defaultType :
+                                         &findLedType(chain.type);
+
+        orderOfst.push_back(order.size());
+        for (const auto &range : chain.ranges) {
+            int step = range.start <= range.end ? 1 : -1;
+
+            for (int64_t i = range.start; ; i += step) {
+                /* Out of the design: not wired */
+                if ((size_t)i < nLeds) {
+                    order.push_back(i);
+                    drivenBy[i] = std::min(drivenBy[i] + 1, 2);
+                }
+                if (i == range.end)
+                    break;
+            }
+        }
+
+        const size_t channels = strlen(info.type->channelOrder);
+        for (size_t c = 0; c < 4; c++)
+            shifts.push_back(c < channels ?
+                             channelShift(info.type->channelOrder[c]) : 0);
+
+        info.leds          = order.size() - orderOfst.back();
+        info.bytesPerFrame = info.leds * channels;
+        info.frameTime     = chainFrameTime(*info.type, info.leds);
+
+        bufferOfst.push_back(bufferLen);
+        bufferLen += info.bytesPerFrame;
+        chains.push_back(info);
+    }
+
+    duplicates = 0;
+    unassigned = 0;
+    for (uint8_t n : drivenBy) {
+        unassigned += n == 0;
+        duplicates += n > 1;
+    }
+
+    buffer.assign(bufferLen, 0);
+}
+
+double ChainPartitioner::getFrameTime() const {
+    double frameTime = 0.0;
+
+    for (const auto &chain : chains)
+        frameTime = std::max(frameTime, chain.frameTime);
+    return frameTime;
+}
+
+void ChainPartitioner::split(const uint32_t *frame) {
+    for (size_t c = 0; c < chains.size(); c++) {
+        const uint32_t *idx = order.data() + orderOfst[c];
+        const uint32_t *end = idx + chains[c].leds;
+        const uint8_t  *sh  = shifts.data() + 4 * c;
+        uint8_t        *dst = buffer.data() + bufferOfst[c];
+
+        /* 1 word read per LED, channels' count known out of the loop */
+        if (chains[c].bytesPerFrame == 4 * chains[c].leds) {
+            for (; idx < end; idx++, dst += 4) {
+                uint32_t word = frame[*idx];
+                dst[0] = word >> sh[0];
+                dst[1] = word >> sh[1];
+                dst[2] = word >> sh[2];
+                dst[3] = word >> sh[3];
+            }
+        } else {
+            for (; idx < end; idx++, dst += 3) {
+                uint32_t word = frame[*idx];
+                dst[0] = word >> sh[0];
+                dst[1] = word >> sh[1];
+                dst[2] = word >> sh[2];
+            }
+        }
+    }
+}
+
+size_t maxChainLeds(const struct LEDType &type, double fps) {
+    double budget = 1.0 / fps - type.resetUs * 1e-6;
+
+    if (fps <= 0.0 || budget <= 0.0)
+        return 0;
+    return budget * type.bitRateHz / type.bitsPerLed;
+}
+
+std::string ChainPartitioner::describe(double targetFps) const {
+    std::string text;
+    char line[256];
+    size_t slowest = 0, outputs = 0;
+    bool unreachable = false;
+
+    for (size_t c = 0; c < chains.size(); c++) {
+        const struct ChainInfo &chain = chains[c];
+        size_t maxLeds = maxChainLeds(*chain.type, targetFps);
+
+        std::snprintf(line, sizeof(line),
+                      "Chain \"%s\" on pin %u: %zu %s (%s), %zu bytes,"
+                      " %.2f ms -> %.1f FPS max\n",
+                      chain.name.c_str(), chain.pin, chain.leds,
+                      chain.type->name, chain.type->channelOrder,
+                      chain.bytesPerFrame, chain.frameTime * 1e3,
+                      1.0 / chain.frameTime);
+        text += line;
+
+        if (chain.frameTime > chains[slowest].frameTime)
+            slowest = c;
+        /* Outputs needed for this chain's LEDs to reach the target */
+        if (maxLeds)
+            outputs += (chain.leds + maxLeds - 1) / maxLeds;
+        else
+            unreachable = true;
+    }
+
+    if (chains.empty())
+        return "No LEDs\n";
+
+    std::snprintf(line, sizeof(line), "Display: %zu chain(s), %.1f FPS max"
+                  " (slowest: \"%s\")\n", chains.size(), 1.0 / getFrameTime(),
+                  chains[slowest].name.c_str());
+    text += line;
+
+    if (unassigned || duplicates) {
+        std::snprintf(line, sizeof(line), "Warning: %zu LED(s) in no chain,"
+                      " %zu in several\n", unassigned, duplicates);
+        text += line;
+    }
+
+    if (1.0 / getFrameTime() >= targetFps) {
+        std::snprintf(line, sizeof(line), "Target %.1f FPS: reached\n",
+                      targetFps);
+    } else if (unreachable) {
+        std::snprintf(line, sizeof(line), "Target %.1f FPS: unreachable,"
+                      " even with 1 LED per chain\n", targetFps);
+    } else {
+        std::snprintf(line, sizeof(line), "Target %.1f FPS: %zu outputs needed,"
+                      " at most %zu %s per chain\n", targetFps, outputs,
+                      maxChainLeds(*chains[slowest].type, targetFps),
+                      chains[slowest].type->name);
+    }
+    text += line;
+
+    return text;
+}
+
+bool ChainPartitioner::exportHeader(const std::string &path,
+                                    std::string &error) const {
+    std::ofstream file(path);
+    if ( ! (file && file.is_open()) ) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    const bool wide = nLeds > UINT16_MAX + 1;
+
+    file << "/* Chains exported by LEDs Display Creator: each chain's data pin,"
+            " LEDs' order\n * (design's indexes) & last frame, in the order"
+            " it is sent on the line */\n\n"
+         << "#include <stdint.h>\n\n"
+         << "#define CHAINS_COUNT (" << chains.size() << "u)\n";
+
+    for (size_t c = 0; c < chains.size(); c++) {
+        const struct ChainInfo &chain = chains[c];
+        std::string name  = "chain_" + cIdentifier(chain.name);
+        std::string upper = name;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+
+        file << "\n/* " << chain.type->name << " ("
+             << chain.type->channelOrder << ") */\n"
+             << "#define " << upper << "_PIN  (" << chain.pin  << "u)\n"
+             << "#define " << upper << "_LEDS (" << chain.leds << "u)\n";
+        writeCArray(file, wide ? "uint32_t" : "uint16_t", name + "_map",
+                    order.data() + orderOfst[c], chain.leds, wide ? 8 : 4);
+        writeCArray(file, "uint8_t", name + "_frame",
+                    buffer.data() + bufferOfst[c], chain.bytesPerFrame);
+    }
+
+    if ( ! file ) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
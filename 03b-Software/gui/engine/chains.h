@@ -0,0 +1,75 @@
+#ifndef __CHAINS_H__
+#define __CHAINS_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+#include <vector>
+
+#include "ledtypes.h"
+#include "../structure/display.h"   /* struct LEDDisplay */
+
+/* One data output, as partitioned by ChainPartitioner */
+struct ChainInfo {
+    std::string name;
+    uint32_t    pin;
+    const struct LEDType *type;
+    size_t      leds;
+    /* On the line, channelOrder's bytes per LED */
+    size_t      bytesPerFrame;
+    /* Time to refresh the chain [s] */
+    double      frameTime;
+};
+
+/* Splits frames into the per-chain buffers sent on each data pin, in wiring
+ * & channel order. Chains are refreshed in parallel, so the slowest one
+ * limits the whole display */
+class ChainPartitioner {
+
+public:
+    /* Design's chains, or the whole design as 1 chain when it has none.
+     * Chains without a type use defaultType */
+    void setLayout(const struct LEDDisplay &display,
+                   const struct LEDType &defaultType);
+
+    /* LEDs of the design the layout was set from */
+    size_t getNumberOfLeds() const { return nLeds; }
+    size_t getNumberOfChains() const { return chains.size(); }
+    const struct ChainInfo& getChain(size_t chain) const { return chains[chain]; }
+    /* Slowest chain's frame time [s] */
+    double getFrameTime() const;
+    /* Layout's mistakes: LEDs driven by no chain, or by several */
+    size_t getNumberOfUnassigned() const { return unassigned; }
+    size_t getNumberOfDuplicates() const { return duplicates; }
+
+    /* frame[# of LEDs] into every chain's buffer, in 1 pass */
+    void split(const uint32_t *frame);
+    const uint8_t* getBuffer(size_t chain) const {
+        return buffer.data() + bufferOfst[chain];
+    }
+
+    /* Chains' stats & how to reach targetFps, a few lines */
+    std::string describe(double targetFps) const;
+    /* C header with each chain's pin, LEDs' order & last split frame
+     * @return false on error, with a message in error */
+    bool exportHeader(const std::string &path, std::string &error) const;
+
+private:
+    std::vector<struct ChainInfo> chains;
+    size_t nLeds      = 0;
+    size_t unassigned = 0;
+    size_t duplicates = 0;
+
+    /* Design's LED index of every chain's LEDs, chains one after the other */
+    std::vector<uint32_t> order;
+    /* Per chain, 1st entry in order, and bytes' shift of each channel */
+    std::vector<size_t>   orderOfst;
+    std::vector<uint8_t>  shifts;
+    std::vector<size_t>   bufferOfst;
+    std::vector<uint8_t>  buffer;
+};
+
+/* Longest chain of this type refreshed at fps, 0 if unreachable */
+size_t maxChainLeds(const struct LEDType &type, double fps);
+
+#endif // __CHAINS_H__
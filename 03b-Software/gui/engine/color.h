@@ -0,0 +1,31 @@
+#ifndef __COLOR_H__
+#define __COLOR_H__
+
+#include <cstdint>
+
+/* Color "word" as sent by the clients: bytes <R><G><B><W> in memory order,
+ * read as a Little Endian UINT32 */
+inline uint32_t packColor(uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) {
+    return (uint32_t)r | (uint32_t)g << 8 | (uint32_t)b << 16 | (uint32_t)w << 24;
+}
+
+inline uint8_t colorR(uint32_t word) { return word       & 0xFF; }
+inline uint8_t colorG(uint32_t word) { return word >>  8 & 0xFF; }
+inline uint8_t colorB(uint32_t word) { return word >> 16 & 0xFF; }
+inline uint8_t colorW(uint32_t word) { return word >> 24 & 0xFF; }
+
+/* Pack channels given in [0;1], no clamping: caller guarantees the range */
+inline uint32_t packColorF(float r, float g, float b, float w = 0.0f) {
+    return packColor((uint8_t)(r * 255.0f + 0.5f), (uint8_t)(g * 255.0f + 0.5f),
+                     (uint8_t)(b * 255.0f + 0.5f), (uint8_t)(w * 255.0f + 0.5f));
+}
+
+/* Linear interpolation from a (k = 0) to b (k = 1), k in [0;1] */
+inline uint32_t lerpColor(uint32_t a, uint32_t b, float k) {
+    return packColor((uint8_t)(colorR(a) + (colorR(b) - colorR(a)) * k + 0.5f),
+                     (uint8_t)(colorG(a) + (colorG(b) - colorG(a)) * k + 0.5f),
+                     (uint8_t)(colorB(a) + (colorB(b) - colorB(a)) * k + 0.5f),
+                     (uint8_t)(colorW(a) + (colorW(b) - colorW(a)) * k + 0.5f));
+}
+
+#endif // __COLOR_H__
@@ -0,0 +1,185 @@
+#include "colorkernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "color.h"
+
+void lerpColors(const uint32_t *a, const uint32_t *b, uint32_t *out,
+                size_t n, float k) {
+    /* 8 bits weights: out = (a * (256 - w) + b * w) >> 8 fits in uint16 */
+    const uint16_t w = (uint16_t)(std::clamp(k, 0.0f, 1.0f) * 256.0f + 0.5f);
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wb   = _mm_set1_epi16(w);
+    const __m128i wa   = _mm_set1_epi16(256 - w);
+
+    /* 4 LEDs per iteration, each channel in a 16 bits lane */
+    for ( ; i + 4 <= n; i += 4) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb));
+
+        _mm_storeu_si128((__m128i *)(out + i),
+                         _mm_packus_epi16(_mm_srli_epi16(lo, 8),
+                                          _mm_srli_epi16(hi, 8)));
+    }
+#endif
+
+    /* Remaining LEDs, same rounding as above */
+    for ( ; i < n; i++) {
+        uint32_t ca = a[i], cb = b[i], r = 0;
+
+        for (int shift = 0; shift < 32; shift += 8) {
+            uint32_t ch = (((ca >> shift) & 0xFF) * (256 - w) +
+                           ((cb >> shift) & 0xFF) * w) >> 8;
+            r |= ch << shift;
+        }
+        out[i] = r;
+    }
+}
+
+void channelSums(const uint32_t *colors, size_t n, uint64_t sums[4]) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    /* 2 partial sums per channel, in 64 bits lanes: no overflow */
+    __m128i acc[4] = { zero, zero, zero, zero };
+
+    /* 4 LEDs per iteration: each channel isolated in the low byte of its
+     * 32 bits lane, then summed by _mm_sad_epu8() against 0 */
+    for ( ; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(colors + i));
+
+        acc[0] = _mm_add_epi64(acc[0], _mm_sad_epu8(_mm_and_si128(v, mask), zero));
+        acc[1] = _mm_add_epi64(acc[1], _mm_sad_epu8(_mm_and_si128(
+                                   _mm_srli_epi32(v, 8), mask), zero));
+        acc[2] = _mm_add_epi64(acc[2], _mm_sad_epu8(_mm_and_si128(
+                                   _mm_srli_epi32(v, 16), mask), zero));
+        acc[3] = _mm_add_epi64(acc[3], _mm_sad_epu8(_mm_srli_epi32(v, 24),
+                                                    zero));
+    }
+
+    for (int c = 0; c < 4; c++) {
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, acc[c]);
+        sums[c] += lanes[0] + lanes[1];
+    }
+#endif
+
+    for ( ; i < n; i++) {
+        sums[0] += colorR(colors[i]);
+        sums[1] += colorG(colors[i]);
+        sums[2] += colorB(colors[i]);
+        sums[3] += colorW(colors[i]);
+    }
+}
+
+void scaleColors(uint32_t *colors, size_t n, float k) {
+    /* 8 bits weight, rounded down: (c * w) >> 8 <= c * k */
+    const uint16_t w = (uint16_t)(std::clamp(k, 0.0f, 1.0f) * 256.0f);
+    size_t i = 0;
+
+    if (w >= 256)
+        return;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vw   = _mm_set1_epi16(w);
+
+    for ( ; i + 4 <= n; i += 4) {
+        __m128i v  = _mm_loadu_si128((const __m128i *)(colors + i));
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero),
+                                                    vw), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero),
+                                                    vw), 8);
+
+        _mm_storeu_si128((__m128i *)(colors + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for ( ; i < n; i++) {
+        uint32_t c = colors[i], r = 0;
+
+        for (int shift = 0; shift < 32; shift += 8)
+            r |= (((c >> shift) & 0xFF) * w >> 8) << shift;
+        colors[i] = r;
+    }
+}
+
+void colorsToHsv(const uint32_t *in, float *h, float *s, float *v, float *w,
+                 size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        float r = colorR(in[i]) / 255.0f;
+        float g = colorG(in[i]) / 255.0f;
+        float b = colorB(in[i]) / 255.0f;
+        float max = std::max(r, std::max(g, b));
+        float min = std::min(r, std::min(g, b));
+        float d   = max - min;
+        float hue = 0.0f;
+
+        if (d > 0.0f) {
+            if (max == r)       hue = (g - b) / d;
+            else if (max == g)  hue = (b - r) / d + 2.0f;
+            else                hue = (r - g) / d + 4.0f;
+            hue /= 6.0f;
+            hue -= std::floor(hue);
+        }
+
+        h[i] = hue;
+        s[i] = max > 0.0f ? d / max : 0.0f;
+        v[i] = max;
+        w[i] = colorW(in[i]) / 255.0f;
+    }
+}
+
+void hsvToColors(const float *h, const float *s, const float *v,
+                 const float *w, uint32_t *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        /* Branchless: hue's contribution of each channel, then saturation */
+        float hh = (h[i] - std::floor(h[i])) * 6.0f;
+        float r = std::clamp(std::fabs(hh - 3.0f) - 1.0f, 0.0f, 1.0f);
+        float g = std::clamp(2.0f - std::fabs(hh - 2.0f), 0.0f, 1.0f);
+        float b = std::clamp(2.0f - std::fabs(hh - 4.0f), 0.0f, 1.0f);
+
+        out[i] = packColorF(v[i] * (1.0f + s[i] * (r - 1.0f)),
+                            v[i] * (1.0f + s[i] * (g - 1.0f)),
+                            v[i] * (1.0f + s[i] * (b - 1.0f)), w[i]);
+    }
+}
+
+void lerpHsvColors(const float *ha, const float *sa, const float *va,
+                   const float *wa, const float *hb, const float *sb,
+                   const float *vb, const float *wb, uint32_t *out, size_t n,
+                   float k) {
+    /* Interpolated planes by batches, kept on the stack */
+    const size_t BATCH = 256;
+    float h[BATCH], s[BATCH], v[BATCH], w[BATCH];
+
+    for (size_t first = 0; first < n; first += BATCH) {
+        const size_t m = std::min(BATCH, n - first);
+
+        for (size_t i = 0; i < m; i++) {
+            float dh = hb[first+i] - ha[first+i];
+            dh -= std::nearbyint(dh);
+            h[i] = ha[first+i] + dh * k;
+            s[i] = sa[first+i] + (sb[first+i] - sa[first+i]) * k;
+            v[i] = va[first+i] + (vb[first+i] - va[first+i]) * k;
+            w[i] = wa[first+i] + (wb[first+i] - wa[first+i]) * k;
+        }
+
+        hsvToColors(h, s, v, w, out + first, m);
+    }
+}
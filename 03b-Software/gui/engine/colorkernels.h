@@ -0,0 +1,34 @@
+#ifndef __COLOR_KERNELS_H__
+#define __COLOR_KERNELS_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+
+/* Kernels over contiguous color words (see color.h), SSE2 when available */
+
+/* out[i] = a[i] -> b[i] at k in [0;1], every channel (W included)
+ * out may alias a or b */
+void lerpColors(const uint32_t *a, const uint32_t *b, uint32_t *out,
+                size_t n, float k);
+
+/* RGBW <-> HSV planes & the W one aside, h/s/v/w in [0;1] */
+void colorsToHsv(const uint32_t *in, float *h, float *s, float *v, float *w,
+                 size_t n);
+void hsvToColors(const float *h, const float *s, const float *v,
+                 const float *w, uint32_t *out, size_t n);
+
+/* HSV interpolation of 2 sets of planes, hue by the shortest way around,
+ * W linearly */
+void lerpHsvColors(const float *ha, const float *sa, const float *va,
+                   const float *wa, const float *hb, const float *sb,
+                   const float *vb, const float *wb, uint32_t *out, size_t n,
+                   float k);
+
+/* sums[c] += channel c of every color, c in color word's order R, G, B, W */
+void channelSums(const uint32_t *colors, size_t n, uint64_t sums[4]);
+
+/* Every channel times k in [0;1], rounded down so the result never exceeds
+ * the exact product (power limitation) */
+void scaleColors(uint32_t *colors, size_t n, float k);
+
+#endif // __COLOR_KERNELS_H__
@@ -0,0 +1,221 @@
+#include "designgen.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/* Like the shipped designs */
+static constexpr double LED_RADIUS = 50.0;
+static constexpr float  LED_PITCH  = 2.54f;
+
+static const char *SHAPE_NAMES[] = { "grid", "spiral", "scatter", "star" };
+
+bool parseDesignShape(const std::string &name, enum DesignShape &shape) {
+    for (size_t i = 0; i < sizeof(SHAPE_NAMES) / sizeof(*SHAPE_NAMES); i++) {
+        if (name == SHAPE_NAMES[i]) {
+            shape = (enum DesignShape)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* designShapeName(enum DesignShape shape) {
+    return SHAPE_NAMES[shape];
+}
+
+/* SplitMix64: <random>'s distributions differ between standard libraries,
+ * the designs mustn't */
+struct Random {
+    uint64_t state;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    /* In [0;1[ */
+    double uniform() {
+        return (next() >> 11) * 0x1.0p-53;
+    }
+};
+
+static double degrees(double rad) {
+    return rad * 180.0 / M_PI;
+}
+
+static void addLed(struct LEDDisplay &display, const struct DesignSpec &spec,
+                   double cx, double cy, double angle) {
+    struct LED led;
+
+    /* Positions are the top-left corner */
+    led.position = { cx - LED_RADIUS / 2, cy - LED_RADIUS / 2 };
+    led.radius   = LED_RADIUS;
+    led.angle    = angle;
+    led.pitch    = LED_PITCH;
+    led.type     = spec.type;
+    led.color    = {};
+    display.leds.push_back(led);
+}
+
+/* Group name + LEDs [start; end[ */
+static void addGroup(struct LEDDisplay &display, const char *prefix,
+                     size_t number, size_t start, size_t end) {
+    char name[32];
+
+    if (start >= end)
+        return;
+    std::snprintf(name, sizeof(name), "%s%02zu", prefix, number);
+    display.groups.push_back({ name, { { (uint32_t)start,
+                                         (uint32_t)(end - 1) } } });
+}
+
+static void makeGrid(struct LEDDisplay &display, const struct DesignSpec &spec) {
+    const size_t side = std::max<size_t>(1, std::ceil(std::sqrt((double)spec.leds)));
+
+    for (size_t i = 0; i < spec.leds; i++) {
+        size_t row = i / side, col = i % side;
+
+        /* Zigzag: odd rows wired backwards */
+        if (row % 2)
+            col = side - 1 - col;
+        addLed(display, spec, col * spec.spacing, row * spec.spacing,
+               row % 2 ? 180.0 : 0.0);
+    }
+
+    for (size_t row = 0; row * side < spec.leds; row++)
+        addGroup(display, "row", row + 1, row * side,
+                 std::min(spec.leds, (row + 1) * side));
+}
+
+static void makeSpiral(struct LEDDisplay &display,
+                       const struct DesignSpec &spec) {
+    /* r = b.theta, turns spacing apart; starting 1 turn out of the center */
+    const double b = spec.spacing / (2 * M_PI);
+    double theta = 2 * M_PI;
+    size_t turn = 0, start = 0;
+
+    for (size_t i = 0; i < spec.leds; i++) {
+        const double r = b * theta;
+        const size_t t = theta / (2 * M_PI) - 1;
+
+        if (t != turn) {
+            addGroup(display, "turn", turn + 1, start, i);
+            turn  = t;
+            start = i;
+        }
+        addLed(display, spec, r * std::cos(theta), r * std::sin(theta),
+               degrees(theta + M_PI / 2));
+
+        /* Arc length: ds = sqrt(r^2 + b^2).dtheta */
+        theta += spec.spacing / std::sqrt(r * r + b * b);
+    }
+    addGroup(display, "turn", turn + 1, start, spec.leds);
+}
+
+static void makeScatter(struct LEDDisplay &display,
+                        const struct DesignSpec &spec) {
+    /* As dense as the grid, on average */
+    const double side = spec.spacing * std::sqrt((double)spec.leds);
+    const size_t block = std::max<size_t>(1, std::ceil(std::sqrt((double)spec.leds)));
+    struct Random random = { spec.seed };
+
+    for (size_t i = 0; i < spec.leds; i++) {
+        double x = random.uniform() * side;
+        double y = random.uniform() * side;
+        addLed(display, spec, x, y, random.uniform() * 360.0);
+    }
+
+    for (size_t i = 0; i * block < spec.leds; i++)
+        addGroup(display, "block", i + 1, i * block,
+                 std::min(spec.leds, (i + 1) * block));
+}
+
+static void makeStar(struct LEDDisplay &display, const struct DesignSpec &spec) {
+    const size_t branches = std::clamp<size_t>(spec.branches, 1, spec.leds);
+    const double step = 2 * M_PI / branches;
+    /* Branches' 1st LEDs spacing apart around the center */
+    const double inner = std::max(2.0, branches / (2 * M_PI)) * spec.spacing;
+    struct Random random = { spec.seed };
+
+    /* Lengths from 75% to 125% of the average, LEDs left over to the 1st */
+    std::vector<double> weights(branches);
+    std::vector<size_t> lengths(branches);
+    double total = 0.0;
+    size_t given = 0;
+
+    for (auto &w : weights)
+        total += (w = 0.75 + 0.5 * random.uniform());
+    for (size_t k = 0; k < branches; k++)
+        given += (lengths[k] = std::max<size_t>(1, spec.leds * weights[k] /
+                                                   total));
+    for (size_t k = 0; given != spec.leds; k = (k + 1) % branches) {
+        if (given < spec.leds) {
+            lengths[k]++;
+            given++;
+        } else if (lengths[k] > 1) {
+            lengths[k]--;
+            given--;
+        }
+    }
+
+    size_t start = 0;
+    for (size_t k = 0; k < branches; k++) {
+        /* A bit off the regular star */
+        const double dir = k * step + (random.uniform() - 0.5) * step / 4;
+
+        for (size_t j = 0; j < lengths[k]; j++) {
+            const double r = inner + j * spec.spacing;
+            addLed(display, spec, r * std::cos(dir), r * std::sin(dir),
+                   degrees(dir));
+        }
+        addGroup(display, "branch", k + 1, start, start + lengths[k]);
+        start += lengths[k];
+    }
+}
+
+struct LEDDisplay generateDesign(const struct DesignSpec &spec) {
+    struct LEDDisplay display;
+
+    if ( ! spec.leds )
+        return display;
+
+    display.leds.reserve(spec.leds);
+    switch (spec.shape) {
+    case SHAPE_GRID:    makeGrid(display, spec);    break;
+    case SHAPE_SPIRAL:  makeSpiral(display, spec);  break;
+    case SHAPE_SCATTER: makeScatter(display, spec); break;
+    case SHAPE_STAR:    makeStar(display, spec);    break;
+    }
+
+    /* Moved to start at (0, 0) */
+    double minX = INFINITY, minY = INFINITY;
+    for (const auto &led : display.leds) {
+        minX = std::min(minX, led.position.x);
+        minY = std::min(minY, led.position.y);
+    }
+    for (auto &led : display.leds) {
+        led.position.x -= minX;
+        led.position.y -= minY;
+    }
+
+    if (spec.chainLeds) {
+        for (size_t i = 0; i * spec.chainLeds < spec.leds; i++) {
+            struct LEDChain chain;
+            size_t start = i * spec.chainLeds;
+
+            chain.name = "out" + std::to_string(i + 1);
+            chain.pin  = i;
+            chain.type = spec.type;
+            chain.ranges.push_back({ (uint32_t)start,
+                                     (uint32_t)(std::min(spec.leds,
+                                                         start + spec.chainLeds)
+                                                - 1) });
+            display.chains.push_back(chain);
+        }
+    }
+
+    return display;
+}
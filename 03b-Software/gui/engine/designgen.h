@@ -0,0 +1,47 @@
+#ifndef __DESIGN_GEN_H__
+#define __DESIGN_GEN_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+
+#include "../structure/display.h"   /* struct LEDDisplay */
+
+/* Synthetic designs of any size, for scaling tests & benchmarks: the same
+ * spec (seed included) always gives the same design */
+
+enum DesignShape {
+    /* Rows wired in zigzag, like LED matrices; 1 group per row */
+    SHAPE_GRID,
+    /* Archimedean spiral from the center; 1 group per turn */
+    SHAPE_SPIRAL,
+    /* Uniformly random positions; 1 group per block of consecutive LEDs */
+    SHAPE_SCATTER,
+    /* Branches of random lengths around a center, like BMTH-LudensStar;
+     * 1 group per branch */
+    SHAPE_STAR,
+};
+
+struct DesignSpec {
+    enum DesignShape shape = SHAPE_GRID;
+    size_t   leds     = 1000;
+    uint64_t seed     = 1;
+    /* Between consecutive LEDs, in scene's unit (shipped designs: ~60) */
+    double   spacing  = 60.0;
+    /* SHAPE_STAR only */
+    size_t   branches = 8;
+    /* Consecutive LEDs per chain, 0: no chains (the whole design is 1) */
+    size_t   chainLeds = 0;
+    /* Of every LED & chain */
+    std::string type  = "WS281x";
+};
+
+/* Shapes' names, as in the tools' options
+ * @return false if name isn't one */
+bool parseDesignShape(const std::string &name, enum DesignShape &shape);
+const char* designShapeName(enum DesignShape shape);
+
+/* LEDs' positions start at (0, 0), radius & pitch like the shipped designs */
+struct LEDDisplay generateDesign(const struct DesignSpec &spec);
+
+#endif // __DESIGN_GEN_H__
@@ -0,0 +1,241 @@
+#include "effects.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "color.h"
+
+/* Kernels below are plain loops over contiguous arrays, without calls nor
+ * data dependant branches, so the compiler can vectorize them */
+
+static inline float fract(float x) {
+    return x - std::floor(x);
+}
+
+/* 0 -> 1 -> 0 over [0;1] */
+static inline float triangle(float x) {
+    return 1.0f - std::fabs(2.0f * x - 1.0f);
+}
+
+/* Hash an index into [0;1[, deterministic for a given seed */
+static inline float hash01(uint32_t i, uint32_t seed) {
+    uint32_t h = (i ^ seed) * 0x9E3779B1u;
+    h ^= h >> 15;
+    h *= 0x85EBCA77u;
+    h ^= h >> 13;
+    return (h & 0xFFFFFF) / 16777216.0f;
+}
+
+/* Kernels get the chunk [first;first+n[ of a range of len LEDs,
+ * "offset" being the chunk's position inside the range */
+static void chase(uint32_t *out, size_t offset, size_t n, size_t len,
+                  float phase, uint32_t size, uint32_t on, uint32_t off) {
+    const float flen = len;
+    const float head = phase * flen;
+    const float lit  = std::max(size, 1u);
+
+    for (size_t i = 0; i < n; i++) {
+        float d = (offset + i) - head;
+        d -= flen * std::floor(d / flen);
+        out[i] = d < lit ? on : off;
+    }
+}
+
+static void rainbow(uint32_t *out, size_t offset, size_t n, size_t len,
+                    float phase, uint32_t size) {
+    const float step = 1.0f / (size ? size : len);
+
+    for (size_t i = 0; i < n; i++) {
+        /* HSV -> RGB, full saturation & value, branchless */
+        float h = fract((offset + i) * step + phase) * 6.0f;
+        float r = std::clamp(std::fabs(h - 3.0f) - 1.0f, 0.0f, 1.0f);
+        float g = std::clamp(2.0f - std::fabs(h - 2.0f), 0.0f, 1.0f);
+        float b = std::clamp(2.0f - std::fabs(h - 4.0f), 0.0f, 1.0f);
+        out[i] = packColorF(r, g, b);
+    }
+}
+
+static void twinkle(uint32_t *out, size_t first, size_t n, float phase,
+                    uint32_t density, uint32_t seed,
+                    uint32_t on, uint32_t off) {
+    /* Density in per mille, 0 = every LED */
+    const float ratio = density ? std::min(density, 1000u) / 1000.0f : 1.0f;
+
+    for (size_t i = 0; i < n; i++) {
+        /* Index of the design, so a LED twinkles the same in any group */
+        uint32_t idx = first + i;
+        float selected = hash01(idx, ~seed) < ratio ? 1.0f : 0.0f;
+        float k = triangle(fract(phase + hash01(idx, seed)));
+        out[i] = lerpColor(off, on, k * selected);
+    }
+}
+
+static void gradient(uint32_t *out, const float *u, const float *v, size_t n,
+                     float phase, bool scrolling, uint32_t degrees,
+                     uint32_t from, uint32_t to) {
+    const float rad = degrees * 3.14159265f / 180.0f;
+    const float c = std::cos(rad), s = std::sin(rad);
+    /* u & v are in [0;1]: projection's bounds are known without a scan */
+    const float lo = std::min(c, 0.0f) + std::min(s, 0.0f);
+    const float hi = std::max(c, 0.0f) + std::max(s, 0.0f);
+    const float scale = hi > lo ? 1.0f / (hi - lo) : 0.0f;
+
+    for (size_t i = 0; i < n; i++) {
+        float k = (u[i] * c + v[i] * s - lo) * scale;
+        /* Scroll by going back & forth, so there is no hard edge */
+        if (scrolling)
+            k = triangle(fract(k * 0.5f + phase));
+        out[i] = lerpColor(from, to, k);
+    }
+}
+
+void EffectsEngine::setLayout(const struct LEDDisplay &display) {
+    geometry.build(display);
+    groups = display.groups;
+    frame.assign(display.leds.size(), 0);
+
+    /* Group's indexes may not exist anymore in the new design */
+    for (auto &slot : slots) {
+        if (slot.params.group != EFFECT_ALL_LEDS &&
+            slot.params.group >= groups.size())
+            slot.active = false;
+    }
+}
+
+bool EffectsEngine::apply(const struct protocol_effect &cmd, double now) {
+    if (cmd.slot >= EFFECT_SLOTS || cmd.effect > EFFECT_SHADER ||
+        (cmd.group != EFFECT_ALL_LEDS && cmd.group >= groups.size()))
+        return false;
+
+    struct Slot &slot = slots[cmd.slot];
+
+    if (cmd.effect == EFFECT_SHADER && ! slot.shader.isValid())
+        return false;
+
+    /* Keep the phase when only parameters change */
+    if ( ! slot.active || slot.params.effect != cmd.effect )
+        slot.startTime = now;
+
+    slot.params = cmd;
+    slot.active = cmd.effect != EFFECT_NONE;
+
+    return true;
+}
+
+bool EffectsEngine::loadShader(uint32_t slot, const std::string &source,
+                               std::string &error) {
+    ShaderProgram program;
+
+    if (slot >= EFFECT_SLOTS) {
+        error = "slot out of range";
+        return false;
+    }
+
+    if ( ! program.compile(source) ) {
+        error = program.getError();
+        return false;
+    }
+
+    slots[slot].shader = std::move(program);
+    error.clear();
+    return true;
+}
+
+void EffectsEngine::stopAll() {
+    for (auto &slot : slots)
+        slot.active = false;
+}
+
+bool EffectsEngine::isRunning() const {
+    return std::any_of(std::begin(slots), std::end(slots),
+                       [](const struct Slot &slot) { return slot.active; });
+}
+
+void EffectsEngine::render(double now) {
+    rendered.clear();
+
+    if (frame.empty())
+        return;
+
+    for (const auto &slot : slots) {
+        if ( ! slot.active )
+            continue;
+
+        const auto &params = slot.params;
+        double elapsed = now - slot.startTime;
+        float  phase   = 0.0f;
+
+        /* Wrap shaders' time on the period, keeping float's precision */
+        if (params.periodMs) {
+            phase   = fract(elapsed * 1000.0 / params.periodMs);
+            elapsed = phase * params.periodMs / 1000.0;
+        }
+
+        if (params.group == EFFECT_ALL_LEDS) {
+            renderRange(slot, phase, elapsed, 0, frame.size() - 1);
+            rendered.push_back({ 0, (uint32_t)frame.size() - 1 });
+            continue;
+        }
+
+        /* Groups are not checked against the design when loaded:
+         * skip/clamp ranges outside of it */
+        for (const auto &range : groups[params.group].ranges) {
+            if (range.start > range.end || range.start >= frame.size())
+                continue;
+
+            uint32_t end = std::min<uint32_t>(range.end, frame.size() - 1);
+            renderRange(slot, phase, elapsed, range.start, end);
+            rendered.push_back({ range.start, end });
+        }
+    }
+}
+
+/* Inclusive range, split in chunks across the pipeline's threads */
+void EffectsEngine::renderRange(const struct Slot &slot, float phase,
+                                float elapsed, size_t begin, size_t end) {
+    pipeline.parallelFor(begin, end + 1, [&](size_t first, size_t last) {
+        renderChunk(slot, phase, elapsed, begin, end - begin + 1, first, last);
+    });
+}
+
+/* [first;last[ of the range starting at "begin" & made of "len" LEDs */
+void EffectsEngine::renderChunk(const struct Slot &slot, float phase,
+                                float elapsed, size_t begin, size_t len,
+                                size_t first, size_t last) {
+    const auto &params = slot.params;
+    uint32_t   *out    = frame.data() + first;
+    const size_t n     = last - first;
+    const size_t offset = first - begin;
+
+    switch (params.effect) {
+    case EFFECT_FILL:
+        std::fill(out, out + n, params.colorA);
+        break;
+    case EFFECT_CHASE:
+        chase(out, offset, n, len, phase, params.size,
+              params.colorA, params.colorB);
+        break;
+    case EFFECT_FADE:
+        /* Same color for every LED: compute it once */
+        std::fill(out, out + n,
+                  lerpColor(params.colorB, params.colorA, triangle(phase)));
+        break;
+    case EFFECT_RAINBOW:
+        rainbow(out, offset, n, len, phase, params.size);
+        break;
+    case EFFECT_TWINKLE:
+        twinkle(out, first, n, phase, params.size, params.seed,
+                params.colorA, params.colorB);
+        break;
+    case EFFECT_GRADIENT:
+        gradient(out, geometry.u.data() + first, geometry.v.data() + first, n,
+                 phase, params.periodMs != 0, params.size,
+                 params.colorA, params.colorB);
+        break;
+    case EFFECT_SHADER:
+        slot.shader.evaluate(geometry, elapsed, frame.data(), first, last);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef __EFFECTS_H__
+#define __EFFECTS_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <vector>
+
+#include "geometry.h"
+#include "pipeline.h"
+#include "shader.h"
+#include "../structure/display.h"   /* struct LEDDisplay */
+#include "../structure/group.h"     /* struct LEDRange */
+
+#include "../../protocol_src/protocol_routing_variables.h"
+
+/* Renders the built-in effects (enum PROTOCOL_EFFECT) locally, so clients
+ * only send a few bytes to start/stop/tune them instead of full frames */
+class EffectsEngine {
+
+public:
+    /* Cache design's geometry & groups, to call each time the design changes
+     * Effects targeting a group that no longer exists are stopped */
+    void setLayout(const struct LEDDisplay &display);
+    size_t getNumberOfLeds() const { return frame.size(); }
+
+    /* Start/stop/tune a slot's effect, at time "now" [s]
+     * Re-sending the same effect keeps its phase, so tuning is seamless
+     * @return false if slot, effect or group is out of range */
+    bool apply(const struct protocol_effect &cmd, double now);
+    /* Compile the program run by EFFECT_SHADER in the slot
+     * On error, the slot's previous program is kept
+     * @return false if slot is out of range or compilation failed */
+    bool loadShader(uint32_t slot, const std::string &source,
+                    std::string &error);
+    void stopAll();
+    bool isRunning() const;
+
+    /* Evaluate every running effect at time "now" [s] */
+    void render(double now);
+    const ColorBuffer& getFrame() const { return frame; }
+    /* Ranges of getFrame() written by the last render() */
+    const std::vector<struct LEDRange>& getRenderedRanges() const {
+        return rendered;
+    }
+
+private:
+    struct Slot {
+        struct protocol_effect params;
+        double startTime;
+        bool   active;
+        ShaderProgram shader;
+    };
+
+    void renderRange(const struct Slot &slot, float phase, float elapsed,
+                     size_t begin, size_t end);
+    void renderChunk(const struct Slot &slot, float phase, float elapsed,
+                     size_t begin, size_t len, size_t first, size_t last);
+
+    struct LEDGeometry geometry;
+    std::vector<struct LEDGroup> groups;
+
+    struct Slot slots[EFFECT_SLOTS] = {};
+
+    FramePipeline pipeline;
+    ColorBuffer frame;
+    std::vector<struct LEDRange> rendered;
+};
+
+#endif // __EFFECTS_H__
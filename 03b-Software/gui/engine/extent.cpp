@@ -0,0 +1,211 @@
+#include "extent.h"
+
+#include <algorithm>
+#include <cmath>
+
+/* Signed length from LED a to LED b through the LEDs in between, a & b being
+ * at most a couple of LEDs apart */
+static double span(const std::vector<struct LED> &leds, size_t a, size_t b) {
+    double length = 0.0;
+
+    for (size_t i = std::min(a, b); i < std::max(a, b); i++)
+        length += ledDistance(leds[i], leds[i+1]);
+    return a <= b ? length : -length;
+}
+
+void DesignExtent::insert(Values &values, double value) {
+    values[value]++;
+}
+
+void DesignExtent::erase(Values &values, double value) {
+    auto it = values.find(value);
+
+    if (it != values.end() && ! --it->second)
+        values.erase(it);
+}
+
+void DesignExtent::clear() {
+    nLeds = 0;
+    xs.clear();
+    ys.clear();
+    radii.clear();
+    pitches.clear();
+    stripLength = 0.0;
+    layout.clear();
+    runs.clear();
+    chains.clear();
+}
+
+void DesignExtent::build(const struct LEDDisplay &display) {
+    const std::vector<struct LED> &leds = display.leds;
+
+    clear();
+    for (size_t i = 0; i < leds.size(); i++) {
+        insert(xs, leds[i].position.x);
+        insert(ys, leds[i].position.y);
+        insert(radii, leds[i].radius);
+        insert(pitches, leds[i].pitch);
+        if (i)
+            stripLength += ledDistance(leds[i-1], leds[i]);
+    }
+    nLeds = leds.size();
+
+    layout = display.chains;
+    for (const auto &chain : layout) {
+        runs.emplace_back();
+        for (const auto &range : chain.ranges) {
+            size_t lo = std::min(range.start, range.end);
+            size_t hi = std::min<size_t>(std::max(range.start, range.end),
+                                         nLeds - 1);
+
+            runs.back().push_back(lo < nLeds ? span(leds, lo, hi) : 0.0);
+        }
+    }
+    sumChains(leds, SIZE_MAX);
+}
+
+void DesignExtent::added(const std::vector<struct LED> &leds) {
+    const struct LED &led = leds.back();
+
+    insert(xs, led.position.x);
+    insert(ys, led.position.y);
+    insert(radii, led.radius);
+    insert(pitches, led.pitch);
+    if (leds.size() > 1)
+        stripLength += ledDistance(leds[leds.size() - 2], led);
+    nLeds++;
+
+    /* Ranges reaching it get 1 more LED at their end */
+    const size_t idx = nLeds - 1;
+    for (size_t c = 0; c < layout.size(); c++) {
+        for (size_t r = 0; r < layout[c].ranges.size(); r++) {
+            const auto &range = layout[c].ranges[r];
+            size_t lo = std::min(range.start, range.end);
+            size_t hi = std::max(range.start, range.end);
+
+            if (lo < idx && idx <= hi)
+                runs[c][r] += ledDistance(leds[idx-1], led);
+        }
+    }
+    sumChains(leds, SIZE_MAX);
+}
+
+void DesignExtent::removing(const std::vector<struct LED> &leds, size_t idx) {
+    const struct LED &led = leds[idx];
+    const bool hasPrev = idx > 0, hasNext = idx + 1 < leds.size();
+
+    erase(xs, led.position.x);
+    erase(ys, led.position.y);
+    erase(radii, led.radius);
+    erase(pitches, led.pitch);
+
+    /* Its neighbours get linked together */
+    if (hasPrev)
+        stripLength -= ledDistance(leds[idx-1], led);
+    if (hasNext)
+        stripLength -= ledDistance(led, leds[idx+1]);
+    if (hasPrev && hasNext)
+        stripLength += ledDistance(leds[idx-1], leds[idx+1]);
+    nLeds--;
+
+    /* Rounding errors of the updates */
+    if (nLeds < 2)
+        stripLength = 0.0;
+
+    /* LEDs past idx move down by 1: each range loses idx or its 1st LED and
+     * gains the LED past its end, only its ends' steps change */
+    for (size_t c = 0; c < layout.size(); c++) {
+        for (size_t r = 0; r < layout[c].ranges.size(); r++) {
+            const auto &range = layout[c].ranges[r];
+            size_t lo = std::min(range.start, range.end);
+            size_t hi = std::max(range.start, range.end);
+            double &run = runs[c][r];
+
+            if (lo >= nLeds) {
+                run = 0.0;
+                continue;
+            }
+
+            /* Ends of the range once removed, as indexes of leds */
+            size_t last  = std::min(hi, nLeds - 1);
+            size_t first = lo < idx ? lo : lo + 1;
+            last += last >= idx;
+
+            run += span(leds, std::min(hi, nLeds), last) -
+                   span(leds, lo, first);
+            if (first < idx && idx < last)
+                run += ledDistance(leds[idx-1], leds[idx+1]) -
+                       ledDistance(leds[idx-1], led) -
+                       ledDistance(led, leds[idx+1]);
+            if (first == last)
+                run = 0.0;
+        }
+    }
+    sumChains(leds, idx);
+}
+
+void DesignExtent::sumChains(const std::vector<struct LED> &leds,
+                             size_t skip) {
+    auto at = [&](size_t i) -> const struct LED& {
+        return leds[i < skip ? i : i + 1];
+    };
+
+    chains.clear();
+    if (layout.empty()) {
+        /* ChainPartitioner's whole design, in index order */
+        if (nLeds)
+            chains.push_back({ "all", nLeds, stripLength });
+        return;
+    }
+
+    for (size_t c = 0; c < layout.size(); c++) {
+        struct ChainExtent chain = { layout[c].name, 0, 0.0 };
+        const struct LED *exit = nullptr;
+
+        for (size_t r = 0; r < layout[c].ranges.size(); r++) {
+            const auto &range = layout[c].ranges[r];
+            size_t lo = std::min(range.start, range.end);
+            size_t hi = std::min<size_t>(std::max(range.start, range.end),
+                                         nLeds - 1);
+
+            /* Out of the design: not wired */
+            if (lo >= nLeds)
+                continue;
+
+            const bool forward = range.start <= range.end;
+            if (exit)
+                chain.stripLength += ledDistance(*exit,
+                                                 at(forward ? lo : hi));
+            exit = &at(forward ? hi : lo);
+            chain.leds        += hi - lo + 1;
+            chain.stripLength += runs[c][r];
+        }
+        chains.push_back(chain);
+    }
+}
+
+struct PhysicalSize physicalSize(const DesignExtent &extent,
+                                 double footprintMm) {
+    struct PhysicalSize size = {};
+
+    if ( ! extent.getNumberOfLeds() || extent.getMaxRadius() <= 0.0 )
+        return size;
+
+    size.scale  = footprintMm / extent.getMaxRadius();
+    /* From the 1st package's outer edge to the last's */
+    size.width  = (extent.getMaxX() - extent.getMinX()) * size.scale +
+                  footprintMm + extent.getMaxPitch();
+    size.height = (extent.getMaxY() - extent.getMinY()) * size.scale +
+                  footprintMm + extent.getMaxPitch();
+    size.stripLength = extent.getStripLength() * size.scale;
+    size.density = extent.getNumberOfLeds() / (size.width * size.height * 1e-6);
+    return size;
+}
+
+double ledDistance(const struct LED &a, const struct LED &b) {
+    /* Positions are top-left corners */
+    return std::hypot((b.position.x + b.radius / 2) -
+                      (a.position.x + a.radius / 2),
+                      (b.position.y + b.radius / 2) -
+                      (a.position.y + a.radius / 2));
+}
@@ -0,0 +1,97 @@
+#ifndef __EXTENT_H__
+#define __EXTENT_H__
+
+#include <cstddef>  /* size_t */
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../structure/display.h"   /* struct LEDDisplay */
+
+/* One of the design's chains, or the whole design when it has none */
+struct ChainExtent {
+    std::string name;
+    /* LEDs of the design it drives */
+    size_t      leds;
+    /* From LED to LED in wiring order, ranges' jumps included [scene's unit] */
+    double      stripLength;
+};
+
+/* Design's bounding box & strip lengths in scene's units, kept up to date LED
+ * by LED: querying them on huge designs doesn't rescan the LEDs */
+class DesignExtent {
+
+public:
+    void clear();
+    /* Whole design, O(n log n) */
+    void build(const struct LEDDisplay &display);
+    /* leds' last LED was just added, O(log n + chains' ranges) */
+    void added(const std::vector<struct LED> &leds);
+    /* leds[idx] is about to be removed, O(log n + chains' ranges) */
+    void removing(const std::vector<struct LED> &leds, size_t idx);
+
+    size_t getNumberOfLeds() const { return nLeds; }
+    /* LEDs' top-left corners, every value 0 when empty */
+    double getMinX() const { return lowest(xs); }
+    double getMaxX() const { return highest(xs); }
+    double getMinY() const { return lowest(ys); }
+    double getMaxY() const { return highest(ys); }
+    /* Largest package & pitch around it */
+    double getMaxRadius() const { return highest(radii); }
+    double getMaxPitch() const { return highest(pitches); }
+    /* Distances between consecutive LEDs, in index order */
+    double getStripLength() const { return stripLength; }
+    /* Chains as laid out by ChainPartitioner */
+    size_t getNumberOfChains() const { return chains.size(); }
+    const struct ChainExtent& getChain(size_t chain) const {
+        return chains[chain];
+    }
+
+private:
+    /* Each value & how many LEDs have it: min/max in O(1), removal in
+     * O(log n), and grids or identical LEDs hold only a few entries */
+    typedef std::map<double, size_t> Values;
+
+    static void insert(Values &values, double value);
+    static void erase(Values &values, double value);
+    static double lowest(const Values &values) {
+        return values.empty() ? 0.0 : values.begin()->first;
+    }
+    static double highest(const Values &values) {
+        return values.empty() ? 0.0 : values.rbegin()->first;
+    }
+
+    /* Chains' totals from their ranges' runs, leds[] being indexed past skip
+     * by 1 while it's being removed */
+    void sumChains(const std::vector<struct LED> &leds, size_t skip);
+
+    size_t nLeds = 0;
+    Values xs, ys, radii, pitches;
+    double stripLength = 0.0;
+
+    /* Design's chains, and per range the length of its LEDs in the design */
+    std::vector<struct LEDChain>     layout;
+    std::vector<std::vector<double>> runs;
+    std::vector<struct ChainExtent>  chains;
+};
+
+/* Real-life size of a design, in [mm] */
+struct PhysicalSize {
+    double width;
+    double height;
+    double stripLength;
+    /* Scene's unit to [mm] */
+    double scale;
+    /* LEDs per [m²] of bounding box */
+    double density;
+};
+
+/* A LED's drawn square (radius) is its package, footprintMm wide: this sets
+ * the scale. Each package is surrounded by half its pitch of board */
+struct PhysicalSize physicalSize(const DesignExtent &extent,
+                                 double footprintMm);
+
+/* Distance between the centers of 2 LEDs, in scene's units */
+double ledDistance(const struct LED &a, const struct LED &b);
+
+#endif // __EXTENT_H__
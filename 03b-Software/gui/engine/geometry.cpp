@@ -0,0 +1,60 @@
+#include "geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LEDGeometry::build(const struct LEDDisplay &display) {
+    const size_t n = display.leds.size();
+    float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+
+    x.resize(n);
+    y.resize(n);
+    u.resize(n);
+    v.resize(n);
+    angle.resize(n);
+    radius.resize(n);
+    rotation.resize(n);
+    group.assign(n, -1.0f);
+
+    for (size_t i = 0; i < n; i++) {
+        const struct LED &led = display.leds[i];
+
+        /* Position is the Top-Left corner of the LED */
+        x[i] = led.position.x + led.radius / 2.0;
+        y[i] = led.position.y + led.radius / 2.0;
+        rotation[i] = led.angle;
+    }
+
+    /* Reverse order, so the 1st group containing a LED is the one kept */
+    for (size_t g = display.groups.size(); g; g--) {
+        for (const auto &range : display.groups[g-1].ranges) {
+            for (size_t i = range.start; i <= range.end && i < n; i++)
+                group[i] = g - 1;
+        }
+    }
+
+    if (n) {
+        minX = *std::min_element(x.begin(), x.end());
+        maxX = *std::max_element(x.begin(), x.end());
+        minY = *std::min_element(y.begin(), y.end());
+        maxY = *std::max_element(y.begin(), y.end());
+    }
+
+    /* A single LED (or a line) has no extent: avoid dividing by 0 */
+    const float span  = std::max(maxX - minX, maxY - minY);
+    const float scale = span > 0.0f ? 1.0f / span : 0.0f;
+
+    /* Center in normalized space & farthest corner from it */
+    const float cu = (maxX - minX) * scale / 2.0f;
+    const float cv = (maxY - minY) * scale / 2.0f;
+    const float maxRadius = std::sqrt(cu * cu + cv * cv);
+    const float rScale = maxRadius > 0.0f ? 1.0f / maxRadius : 0.0f;
+
+    for (size_t i = 0; i < n; i++) {
+        u[i] = (x[i] - minX) * scale;
+        v[i] = (y[i] - minY) * scale;
+
+        angle[i]  = std::atan2(v[i] - cv, u[i] - cu);
+        radius[i] = std::hypot(u[i] - cu, v[i] - cv) * rScale;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef __GEOMETRY_H__
+#define __GEOMETRY_H__
+
+#include <cstddef>  /* size_t */
+#include <vector>
+
+#include "../structure/display.h"   /* struct LEDDisplay */
+
+/* LEDs' positions of a design, laid out as Structure of Arrays
+ * so per-LED evaluations run over contiguous memory */
+struct LEDGeometry {
+    /* LED's center, in scene's unit */
+    std::vector<float> x;
+    std::vector<float> y;
+    /* Same, normalized to [0;1] over the design's bounding box
+     * (aspect ratio kept, the longest side spans [0;1]) */
+    std::vector<float> u;
+    std::vector<float> v;
+    /* Polar coordinates around the bounding box's center:
+     * angle in [-pi;pi], radius normalized to [0;1] */
+    std::vector<float> angle;
+    std::vector<float> radius;
+    /* LED's own rotation, as stored in the design [deg] */
+    std::vector<float> rotation;
+    /* Index of the 1st group containing the LED, -1 if none */
+    std::vector<float> group;
+
+    void build(const struct LEDDisplay &display);
+    size_t size() const { return x.size(); }
+};
+
+#endif // __GEOMETRY_H__
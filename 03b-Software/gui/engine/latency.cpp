@@ -0,0 +1,193 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+
+#include "../structure/json.hpp"
+
+static const char *STAGE_NAMES[LATENCY_STAGES] = {
+    "read", "parse", "apply", "queue", "render", "total"
+};
+
+size_t LatencyHistogram::bucketOf(uint64_t ns) {
+    if (ns < (1u << SUB_BITS))
+        return ns;
+    const int e = 63 - __builtin_clzll(ns);
+    return (size_t)(e - SUB_BITS + 1) << SUB_BITS |
+           ((ns >> (e - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+}
+
+uint64_t LatencyHistogram::getBucketLow(size_t i) {
+    if (i < (1u << SUB_BITS))
+        return i;
+    const int e = (i >> SUB_BITS) + SUB_BITS - 1;
+    return (uint64_t)((1u << SUB_BITS) | (i & ((1u << SUB_BITS) - 1)))
+           << (e - SUB_BITS);
+}
+
+uint64_t LatencyHistogram::getBucketHigh(size_t i) {
+    if (i < (1u << SUB_BITS))
+        return i;
+    const int e = (i >> SUB_BITS) + SUB_BITS - 1;
+    return getBucketLow(i) + (1ull << (e - SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while (ns > seen &&
+           ! max.compare_exchange_weak(seen, ns, std::memory_order_relaxed))
+        ;
+}
+
+void LatencyHistogram::reset() {
+    for (auto &bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getMean() const {
+    const uint64_t n = getCount();
+    return n ? (double)getTotal() / n : 0.0;
+}
+
+uint64_t LatencyHistogram::getPercentile(double p) const {
+    /* Buckets counted again: consistent, even while being recorded */
+    uint64_t n = 0, seen = 0;
+    for (const auto &bucket : buckets)
+        n += bucket.load(std::memory_order_relaxed);
+    if ( ! n )
+        return 0;
+
+    const uint64_t rank = std::max<uint64_t>(1, p * n + 0.5);
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if ((seen += getBucketCount(i)) >= rank)
+            return std::min(getMax(), getBucketHigh(i));
+    }
+    return getMax();
+}
+
+uint64_t LatencyStats::clock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* LatencyStats::getStageName(enum LatencyStage stage) {
+    return STAGE_NAMES[stage];
+}
+
+/* Clocks read in order, but never trusted to be */
+static uint64_t elapsed(uint64_t from, uint64_t to) {
+    return to > from ? to - from : 0;
+}
+
+void LatencyStats::frameApplied(const struct FrameTimes &times) {
+    if ( ! times.read )
+        return;
+
+    stages[LATENCY_READ].record(elapsed(times.read, times.complete));
+    stages[LATENCY_PARSE].record(elapsed(times.complete, times.parsed));
+    stages[LATENCY_APPLY].record(elapsed(times.applying, times.applied));
+
+    if ( ! pendingRead ) {
+        pendingRead    = times.read;
+        /* Held back: waited from parsed on */
+        pendingApplied = times.applied - elapsed(times.parsed, times.applying);
+    }
+}
+
+void LatencyStats::presented(uint64_t start, uint64_t end) {
+    if ( ! pendingRead )
+        return;
+
+    stages[LATENCY_QUEUE].record(elapsed(pendingApplied, start));
+    stages[LATENCY_RENDER].record(elapsed(start, end));
+    stages[LATENCY_TOTAL].record(elapsed(pendingRead, end));
+    pendingRead = 0;
+}
+
+void LatencyStats::reset() {
+    for (auto &stage : stages)
+        stage.reset();
+    pendingRead = 0;
+}
+
+std::string LatencyStats::describe() const {
+    std::string text;
+    char line[160];
+
+    for (int s = 0; s < LATENCY_STAGES; s++) {
+        const LatencyHistogram &h = stages[s];
+        if ( ! h.getCount() )
+            continue;
+
+        std::snprintf(line, sizeof(line), "%-7s: p50 %9.1f us, p99 %9.1f us,"
+                      " max %9.1f us (%" PRIu64 " frames)\n", STAGE_NAMES[s],
+                      h.getPercentile(0.50) / 1e3, h.getPercentile(0.99) / 1e3,
+                      h.getMax() / 1e3, h.getCount());
+        text += line;
+    }
+    return text.empty() ? "No frames measured yet\n" : text;
+}
+
+std::string LatencyStats::describeStats() const {
+    std::string text;
+    char field[160];
+
+    for (int s = 0; s < LATENCY_STAGES; s++) {
+        const LatencyHistogram &h = stages[s];
+
+        std::snprintf(field, sizeof(field), "%slatency_%s_p50_us=%.1f"
+                      " latency_%s_p99_us=%.1f latency_%s_max_us=%.1f",
+                      s ? " " : "", STAGE_NAMES[s], h.getPercentile(0.50) / 1e3,
+                      STAGE_NAMES[s], h.getPercentile(0.99) / 1e3,
+                      STAGE_NAMES[s], h.getMax() / 1e3);
+        text += field;
+    }
+    return text;
+}
+
+bool LatencyStats::dump(const std::string &path, std::string &error) const {
+    nlohmann::ordered_json doc;
+
+    doc["stages"] = nlohmann::ordered_json::array();
+    for (int s = 0; s < LATENCY_STAGES; s++) {
+        const LatencyHistogram &h = stages[s];
+
+        /* Buckets used, to merge dumps or get other percentiles */
+        nlohmann::ordered_json buckets = nlohmann::ordered_json::array();
+        for (size_t i = 0; i < LatencyHistogram::BUCKETS; i++) {
+            if (h.getBucketCount(i))
+                buckets.push_back({ LatencyHistogram::getBucketLow(i),
+                                    LatencyHistogram::getBucketHigh(i),
+                                    h.getBucketCount(i) });
+        }
+
+        doc["stages"].push_back({
+            { "name", STAGE_NAMES[s] }, { "count", h.getCount() },
+            { "mean_us", h.getMean() / 1e3 },
+            { "p50_us", h.getPercentile(0.50) / 1e3 },
+            { "p90_us", h.getPercentile(0.90) / 1e3 },
+            { "p99_us", h.getPercentile(0.99) / 1e3 },
+            { "p999_us", h.getPercentile(0.999) / 1e3 },
+            { "max_us", h.getMax() / 1e3 },
+            { "buckets_ns", buckets },
+        });
+    }
+
+    std::ofstream file(path);
+    file << doc.dump(2) << std::endl;
+    if ( ! file ) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <atomic>
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+
+/* Durations [ns] in log-linear buckets (HDR-like): 16 per power of 2, so any
+ * percentile is within ~6% whatever the range, in fixed memory. Lock-free:
+ * recorded by the thread handling the stream, read by any other */
+class LatencyHistogram {
+
+public:
+    static constexpr int    SUB_BITS = 4;
+    static constexpr size_t BUCKETS  = 64 << SUB_BITS;
+
+    void record(uint64_t ns);
+    void reset();
+
+    uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    uint64_t getTotal() const { return total.load(std::memory_order_relaxed); }
+    uint64_t getMax() const { return max.load(std::memory_order_relaxed); }
+    double   getMean() const;
+    /* Upper bound of the bucket holding the p-th value, p in [0;1] */
+    uint64_t getPercentile(double p) const;
+
+    /* Bucket's values: [getBucketLow(i); getBucketHigh(i)] */
+    uint64_t getBucketCount(size_t i) const {
+        return buckets[i].load(std::memory_order_relaxed);
+    }
+    static uint64_t getBucketLow(size_t i);
+    static uint64_t getBucketHigh(size_t i);
+
+private:
+    static size_t bucketOf(uint64_t ns);
+
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+    std::atomic<uint64_t> count { 0 };
+    std::atomic<uint64_t> total { 0 };
+    std::atomic<uint64_t> max { 0 };
+};
+
+/* From a client's send() to the LEDs changing */
+enum LatencyStage {
+    LATENCY_READ,       /* 1st byte read, until the message is complete   */
+    LATENCY_PARSE,      /* Message checked & identified                   */
+    LATENCY_APPLY,      /* Colors set, power budget, chains' split        */
+    /* Waiting: held back by the refresh throttling, until render starts */
+    LATENCY_QUEUE,
+    LATENCY_RENDER,     /* Render started, until presented                */
+    LATENCY_TOTAL,      /* 1st byte read, until presented                 */
+    LATENCY_STAGES
+};
+
+/* Timestamps of a frame [ns, LatencyStats::clock()], up to its colors
+ * applied */
+struct FrameTimes {
+    uint64_t read;              /* 1st byte read, 0: not measured         */
+    uint64_t complete;
+    uint64_t parsed;
+    uint64_t applying;          /* parsed unless held back                */
+    uint64_t applied;
+};
+
+/* Per-stage histograms of the frames going through the server, cheap
+ * enough to be always on: a few clock reads & relaxed atomics per frame */
+class LatencyStats {
+
+public:
+    /* Steady clock [ns], like CaptureWriter::clock() */
+    static uint64_t clock();
+    static const char* getStageName(enum LatencyStage stage);
+
+    /* Stages up to LATENCY_APPLY. The frame is presented by the next
+     * presented(): frames applied meanwhile are counted from the oldest */
+    void frameApplied(const struct FrameTimes &times);
+    bool hasPending() const { return pendingRead != 0; }
+    /* Render of the frames applied, from start to end [ns] */
+    void presented(uint64_t start, uint64_t end);
+
+    const LatencyHistogram& getStage(enum LatencyStage stage) const {
+        return stages[stage];
+    }
+    void reset();
+
+    /* p50/p99/max of every stage measured, a line each */
+    std::string describe() const;
+    /* Same, "key=value" separated by spaces on a single line */
+    std::string describeStats() const;
+    /* Every stage's percentiles & buckets, as JSON
+     * @return false on error, with a message in error */
+    bool dump(const std::string &path, std::string &error) const;
+
+private:
+    LatencyHistogram stages[LATENCY_STAGES];
+
+    /* Oldest frame applied, not presented yet */
+    uint64_t pendingRead    = 0;
+    uint64_t pendingApplied = 0;
+};
+
+#endif // __LATENCY_H__
@@ -0,0 +1,75 @@
+#include "ledtypes.h"
+
+#include <strings.h>    /* strcasecmp() */
+
+/* From the datasheets: 1.25 us per bit, reset being the newest revisions'
+ * (WS2812B V5 needs 280 us, the older 50 us). Currents are the usual
+ * sizing rule of ~20 mA per channel, ~1 mA for the idle controller */
+const struct LEDType LED_TYPES[] = {
+    /* name      bit rate  bits  reset  order   R/G/B/W [mA]          idle */
+    { "WS2812",  800000,   24,   280,   "GRB",  { 20, 20, 20,  0 },   1.0f },
+    /* RGBW */
+    { "SK6812",  800000,   32,    80,   "GRBW", { 20, 20, 20, 20 },   1.0f },
+    { "WS2811",  400000,   24,   280,   "RGB",  { 18.5f, 18.5f, 18.5f, 0 }, 1.0f },
+};
+const size_t LED_TYPES_COUNT = sizeof(LED_TYPES) / sizeof(LED_TYPES[0]);
+
+/* Smoothing of the incoming rate, weight of the newest interval */
+static constexpr double INTERVAL_SMOOTHING = 0.1;
+
+const struct LEDType& findLedType(const std::string &name) {
+    for (size_t i = 0; i < LED_TYPES_COUNT; i++)
+        if ( ! strcasecmp(name.c_str(), LED_TYPES[i].name) )
+            return LED_TYPES[i];
+
+    /* Like designs' generic "WS281x" */
+    return LED_TYPES[0];
+}
+
+double chainFrameTime(const struct LEDType &type, size_t nLeds) {
+    return (double)nLeds * type.bitsPerLed / type.bitRateHz +
+           type.resetUs * 1e-6;
+}
+
+void RefreshModel::configure(const struct LEDType &type, size_t nLeds) {
+    configure(chainFrameTime(type, nLeds), nLeds);
+}
+
+void RefreshModel::configure(double frameTime, size_t nLeds) {
+    this->nLeds     = nLeds;
+    this->frameTime = frameTime;
+}
+
+double RefreshModel::getMaxFps() const {
+    return frameTime > 0.0 ? 1.0 / frameTime : 0.0;
+}
+
+bool RefreshModel::receive(double now) {
+    if (frames) {
+        double interval = now - lastTime;
+        avgInterval = frames == 1 ? interval :
+                      avgInterval + INTERVAL_SMOOTHING * (interval - avgInterval);
+    }
+    lastTime = now;
+    frames++;
+
+    if ( ! isFree(now) ) {
+        tooFast++;
+        return false;
+    }
+    return true;
+}
+
+void RefreshModel::send(double now) {
+    busyUntil = now + frameTime;
+}
+
+double RefreshModel::getIncomingFps() const {
+    return avgInterval > 0.0 ? 1.0 / avgInterval : 0.0;
+}
+
+void RefreshModel::resetStats() {
+    frames      = 0;
+    tooFast     = 0;
+    avgInterval = 0.0;
+}
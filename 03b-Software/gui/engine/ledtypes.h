@@ -0,0 +1,76 @@
+#ifndef __LED_TYPES_H__
+#define __LED_TYPES_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+
+/* Data line of a LED type: every LED of a chain is clocked out one after the
+ * other, then the line is held low so the LEDs latch their color.
+ * Plus its current draw, linear with each channel's value */
+struct LEDType {
+    const char *name;
+    uint32_t    bitRateHz;
+    uint32_t    bitsPerLed;
+    /* Latch/reset time after the last LED [us] */
+    uint32_t    resetUs;
+    /* Channels in the order they are sent, 1 byte each ("GRB", ...) */
+    const char *channelOrder;
+    /* Current of a channel at 255, in color word's order R, G, B, W [mA] */
+    float       channelMa[4];
+    /* Current of a LED off [mA] */
+    float       idleMa;
+};
+
+/* Catalog, 1st entry being the default */
+extern const struct LEDType LED_TYPES[];
+extern const size_t         LED_TYPES_COUNT;
+
+/* Entry named "name" (case insensitive), the default one if unknown */
+const struct LEDType& findLedType(const std::string &name);
+
+/* Time to refresh a chain of nLeds [s] */
+double chainFrameTime(const struct LEDType &type, size_t nLeds);
+
+/* Models the data line of one chain, to tell whether the real hardware could
+ * show the frames at the rate they arrive */
+class RefreshModel {
+
+public:
+    void configure(const struct LEDType &type, size_t nLeds);
+    /* Chains refreshed in parallel: the slowest one's frame time [s] */
+    void configure(double frameTime, size_t nLeds);
+    size_t getNumberOfLeds() const { return nLeds; }
+    /* Time to send one frame [s] & its inverse */
+    double getFrameTime() const { return frameTime; }
+    double getMaxFps() const;
+
+    /* A frame arrived at now [s], counted in the stats
+     * @return true if the line is free to send it */
+    bool receive(double now);
+    bool isFree(double now) const { return now >= busyUntil; }
+    /* The line is busy sending a frame from now [s] */
+    void send(double now);
+    /* When the line is free again [s] */
+    double getNextSlot() const { return busyUntil; }
+
+    /* Frames' rate at the input, smoothed */
+    double getIncomingFps() const;
+    uint64_t getNumberOfFrames() const { return frames; }
+    /* Frames arrived while the line was still busy */
+    uint64_t getNumberOfTooFast() const { return tooFast; }
+    void resetStats();
+
+private:
+    size_t nLeds     = 0;
+    double frameTime = 0.0;
+    double busyUntil = 0.0;
+
+    uint64_t frames   = 0;
+    uint64_t tooFast  = 0;
+    double   lastTime = 0.0;
+    /* Exponential moving average of the time between 2 frames [s] */
+    double   avgInterval = 0.0;
+};
+
+#endif // __LED_TYPES_H__
@@ -0,0 +1,34 @@
+#include "pipeline.h"
+
+#include <algorithm>
+
+static_assert(FramePipeline::CHUNK_LEDS % LEDS_PER_CACHE_LINE == 0,
+              "Chunks must not share cache lines");
+
+void FramePipeline::run(uint32_t *frame, size_t begin, size_t end) const {
+    parallelFor(begin, end, [&](size_t first, size_t last) {
+        for (const auto &stage : stages)
+            stage(frame, first, last);
+    });
+}
+
+void FramePipeline::parallelFor(size_t begin, size_t end,
+                                const std::function<void(size_t, size_t)> &fn) const {
+    if (begin >= end)
+        return;
+
+    if (end - begin <= INLINE_MAX_LEDS || pool.size() == 1) {
+        fn(begin, end);
+        return;
+    }
+
+    /* Chunks' bounds on absolute multiples of CHUNK_LEDS, so they are
+     * cache line aligned whatever "begin" is (only the 1st is partial) */
+    const size_t firstChunk = begin / CHUNK_LEDS;
+    const size_t lastChunk  = (end - 1) / CHUNK_LEDS;
+
+    pool.run(lastChunk - firstChunk + 1, [&](size_t chunk) {
+        size_t first = (firstChunk + chunk) * CHUNK_LEDS;
+        fn(std::max(first, begin), std::min(first + CHUNK_LEDS, end));
+    });
+}
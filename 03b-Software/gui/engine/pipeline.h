@@ -0,0 +1,74 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <functional>
+#include <new>
+#include <vector>
+
+#include "threadpool.h"
+
+#define CACHE_LINE_SIZE         64
+#define LEDS_PER_CACHE_LINE     (CACHE_LINE_SIZE / sizeof(uint32_t))
+
+/* Allocator aligning buffers on a cache line, so chunks starting on a
+ * multiple of LEDS_PER_CACHE_LINE never share a line between threads */
+template <class T>
+struct CacheAlignedAllocator {
+    typedef T value_type;
+
+    CacheAlignedAllocator() = default;
+    template <class U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T *>(::operator new(n * sizeof(T),
+                                               std::align_val_t(CACHE_LINE_SIZE)));
+    }
+    void deallocate(T *p, size_t) {
+        ::operator delete(p, std::align_val_t(CACHE_LINE_SIZE));
+    }
+
+    template <class U>
+    bool operator==(const CacheAlignedAllocator<U> &) const { return true; }
+    template <class U>
+    bool operator!=(const CacheAlignedAllocator<U> &) const { return false; }
+};
+
+/* LEDs' colors, one word per LED (see color.h) */
+typedef std::vector<uint32_t, CacheAlignedAllocator<uint32_t>> ColorBuffer;
+
+/* Runs per-LED stages over a color buffer, chunk by chunk on a ThreadPool.
+ * Every stage runs on a chunk before the next chunk, so the chunk stays in
+ * cache between stages. Small layouts are run inline. */
+class FramePipeline {
+
+public:
+    /* Must only touch frame[begin;end[ */
+    typedef std::function<void(uint32_t *frame, size_t begin, size_t end)> Stage;
+
+    explicit FramePipeline(ThreadPool &pool = ThreadPool::global())
+        : pool(pool) {}
+
+    void addStage(const Stage &stage) { stages.push_back(stage); }
+    void clearStages() { stages.clear(); }
+
+    /* Every stage over frame[begin;end[ */
+    void run(uint32_t *frame, size_t begin, size_t end) const;
+
+    /* One-off function over [begin;end[, split like run() */
+    void parallelFor(size_t begin, size_t end,
+                     const std::function<void(size_t, size_t)> &fn) const;
+
+    /* LEDs per chunk, multiple of LEDS_PER_CACHE_LINE */
+    static constexpr size_t CHUNK_LEDS = 4096;
+    /* Below, the synchronization costs more than it saves */
+    static constexpr size_t INLINE_MAX_LEDS = 4 * CHUNK_LEDS;
+
+private:
+    ThreadPool &pool;
+    std::vector<Stage> stages;
+};
+
+#endif // __PIPELINE_H__
@@ -0,0 +1,60 @@
+#include "power.h"
+
+#include <algorithm>
+
+#include "colorkernels.h"
+
+void PowerModel::configure(const struct LEDType &type) {
+    for (int c = 0; c < 4; c++)
+        unitMa[c] = type.channelMa[c] / 255.0;
+    idleMa = type.idleMa;
+}
+
+float PowerModel::process(uint32_t *colors, size_t n) {
+    uint64_t sums[4] = { 0, 0, 0, 0 };
+    float scale = 1.0f;
+
+    channelSums(colors, n, sums);
+
+    const double idle = idleMa * n;
+    double active = 0.0;
+    for (int c = 0; c < 4; c++)
+        active += sums[c] * unitMa[c];
+
+    requestedMa = idle + active;
+    currentMa   = requestedMa;
+
+    /* Only the channels' part can be scaled */
+    if (budgetMa > 0.0 && requestedMa > budgetMa && active > 0.0) {
+        scale = std::clamp((budgetMa - idle) / active, 0.0, 1.0);
+        scaleColors(colors, n, scale);
+        /* Upper bound: scaleColors() rounds down */
+        currentMa = idle + active * scale;
+    }
+
+    peakMa = std::max(peakMa, currentMa);
+
+    if (history.size() < AVERAGE_FRAMES) {
+        history.push_back(currentMa);
+    } else {
+        historySum -= history[historyPos];
+        history[historyPos] = currentMa;
+        historyPos = (historyPos + 1) % AVERAGE_FRAMES;
+    }
+    historySum += currentMa;
+
+    return scale;
+}
+
+double PowerModel::getAverage() const {
+    return history.empty() ? 0.0 : historySum / history.size();
+}
+
+void PowerModel::resetStats() {
+    requestedMa = 0.0;
+    currentMa   = 0.0;
+    peakMa      = 0.0;
+    history.clear();
+    historyPos  = 0;
+    historySum  = 0.0;
+}
@@ -0,0 +1,50 @@
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <vector>
+
+#include "ledtypes.h"
+
+/* Estimates the current drawn by each frame from its colors, and optionally
+ * scales the frames down to fit a power supply's budget, like a brightness
+ * limiter in the firmware would */
+class PowerModel {
+
+public:
+    void configure(const struct LEDType &type);
+    /* Supply's budget [mA], 0 not to limit */
+    void setBudget(double budgetMa) { this->budgetMa = budgetMa; }
+    double getBudget() const { return budgetMa; }
+
+    /* Estimate colors[n]'s current & scale them down if over budget
+     * @return scale applied, 1 if none */
+    float process(uint32_t *colors, size_t n);
+
+    /* Last frame's current as requested by its colors & once limited [mA] */
+    double getRequested() const { return requestedMa; }
+    double getCurrent() const { return currentMa; }
+    /* Limited current's peak & average over the last AVERAGE_FRAMES frames */
+    double getPeak() const { return peakMa; }
+    double getAverage() const;
+    void resetStats();
+
+    static constexpr size_t AVERAGE_FRAMES = 64;
+
+private:
+    /* Current of a channel's unit [mA] */
+    double unitMa[4] = {};
+    double idleMa    = 0.0;
+    double budgetMa  = 0.0;
+
+    double requestedMa = 0.0;
+    double currentMa   = 0.0;
+    double peakMa      = 0.0;
+    /* Ring of the last frames' currents & their sum */
+    std::vector<double> history;
+    size_t historyPos = 0;
+    double historySum = 0.0;
+};
+
+#endif // __POWER_H__
@@ -0,0 +1,302 @@
+#include "protocol.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "color.h"
+
+/* "N<hhhh>,": 4 hexa digits */
+static constexpr size_t HEXA_DIGITS = 4;
+
+/* @return 4 hexa digits' value, -1 if one isn't */
+static int hexField(const uint8_t *p) {
+    int value = 0;
+
+    for (size_t i = 0; i < HEXA_DIGITS; i++) {
+        uint8_t c = p[i];
+
+        if (c >= '0' && c <= '9')       value = value << 4 | (c - '0');
+        else if (c >= 'a' && c <= 'f')  value = value << 4 | (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')  value = value << 4 | (c - 'A' + 10);
+        else                            return -1;
+    }
+    return value;
+}
+
+static bool startsWith(const uint8_t *msg, size_t len, const char *prefix) {
+    size_t n = strlen(prefix);
+    return len >= n && ! memcmp(msg, prefix, n);
+}
+
+static bool fail(struct ClientRequest &req, const char *error) {
+    req.error = error;
+    return false;
+}
+
+/* "!<cmd>N<hhhh>,(<entry>)+$": the exact # of entries announced */
+static bool parseEntries(const uint8_t *msg, size_t len, size_t entryLen,
+                         struct ClientRequest &req) {
+    /* "!<cmd>N" + # of entries + ',' */
+    const size_t preambleLen = 3 + HEXA_DIGITS + 1;
+    int n;
+
+    if (len < preambleLen + 1 || msg[preambleLen-1] != ',' ||
+        msg[len-1] != '$')
+        return fail(req, "malformed command");
+
+    n = hexField(msg + 3);
+    if (n < 0 || len != preambleLen + n * entryLen + 1)
+        return fail(req, "malformed # of entries");
+
+    req.count   = n;
+    req.data    = msg + preambleLen;
+    req.dataLen = len - preambleLen - 1;
+    req.entries = n;
+    return true;
+}
+
+bool parseRequest(const uint8_t *msg, size_t len, struct ClientRequest &req) {
+    static const char LEAVING[] = "leaving";
+
+    req = {};
+
+    if (len == sizeof(LEAVING) - 1) {
+        size_t i = 0;
+        while (i < len && (msg[i] | 0x20) == LEAVING[i])
+            i++;
+        if (i == len) {
+            req.cmd = CMD_LEAVING;
+            return true;
+        }
+    }
+
+    if (len == 3 && ! memcmp(msg, "?G$", 3)) {
+        req.cmd = CMD_GROUPS_REQUEST;
+        return true;
+    }
+
+    if (startsWith(msg, len, "!GN")) {
+        req.cmd = CMD_GROUPS_COLOR;
+        return parseEntries(msg, len, GROUP_ENTRY_LEN, req);
+    }
+
+    if (startsWith(msg, len, "!EN")) {
+        req.cmd = CMD_EFFECTS;
+        return parseEntries(msg, len, EFFECT_ENTRY_LEN, req);
+    }
+
+    if (startsWith(msg, len, "!S")) {
+        /* "!S" + slot + ',' */
+        const size_t preambleLen = 2 + HEXA_DIGITS + 1;
+        int slot;
+
+        req.cmd = CMD_SHADER;
+        if (len < preambleLen + 1 || msg[preambleLen-1] != ',' ||
+            msg[len-1] != '$')
+            return fail(req, "malformed command");
+        if ((slot = hexField(msg + 2)) < 0)
+            return fail(req, "malformed slot");
+
+        req.count   = slot;
+        req.data    = msg + preambleLen;
+        req.dataLen = len - preambleLen - 1;
+        return true;
+    }
+
+    if (startsWith(msg, len, "!C")) {
+        /* "!C<comp>N" + # of LEDs + ',' */
+        const size_t preambleLen = 4 + HEXA_DIGITS + 1;
+        int n;
+
+        req.cmd = CMD_FRAME;
+        /* At least 1 LED, whole words only */
+        if (len < preambleLen + sizeof(uint32_t) + 1 ||
+            (msg[2] != '3' && msg[2] != '4') || msg[3] != 'N' ||
+            msg[preambleLen-1] != ',' || msg[len-1] != '$' ||
+            (len - preambleLen - 1) % sizeof(uint32_t))
+            return fail(req, "malformed frame");
+        if ((n = hexField(msg + 4)) < 0)
+            return fail(req, "malformed # of LEDs");
+
+        req.comp    = msg[2] - '0';
+        req.count   = n;
+        req.data    = msg + preambleLen;
+        req.dataLen = len - preambleLen - 1;
+        req.entries = req.dataLen / sizeof(uint32_t);
+        return true;
+    }
+
+    req.cmd = CMD_UNKNOWN;
+    return fail(req, "unknown command");
+}
+
+struct protocol_effect decodeEffect(const struct ClientRequest &req,
+                                    size_t i) {
+    const uint8_t *data = req.data + i * EFFECT_ENTRY_LEN;
+    struct protocol_effect cmd;
+
+    cmd.slot     = readU32(data +  0);
+    cmd.effect   = readU32(data +  4);
+    cmd.group    = readU32(data +  8);
+    cmd.colorA   = readU32(data + 12);
+    cmd.colorB   = readU32(data + 16);
+    cmd.periodMs = readU32(data + 20);
+    cmd.size     = readU32(data + 24);
+    cmd.seed     = readU32(data + 28);
+    return cmd;
+}
+
+size_t decodeFrame(const struct ClientRequest &req, uint32_t *colors,
+                   size_t nLeds) {
+    const uint8_t *data = req.data;
+    size_t n = std::min<size_t>(std::min<size_t>(req.count, req.entries),
+                                nLeds);
+
+    if (req.comp == 3) {
+        for (size_t i = 0; i < n; i++, data += sizeof(uint32_t))
+            colors[i] = packColor(data[0], data[1], data[2]);
+    } else {
+        /* Treat 4 components as one WHITE channel
+         * and, for now, set all channels to this value */
+        for (size_t i = 0; i < n; i++, data += sizeof(uint32_t))
+            colors[i] = packColor(data[3], data[3], data[3]);
+    }
+    return n;
+}
+
+enum PROTOCOL_DATA_RECEIVED_INFO frameFilling(const struct ClientRequest &req,
+                                              size_t nLeds) {
+    if (req.count > nLeds)
+        return DATA_TRUNCATED;
+    if (req.count < nLeds)
+        return DATA_NOT_FILLING_DISPLAY;
+    return DATA_FILLING_DISPLAY;
+}
+
+/* Length prefix of a payload about to be appended, patched by endMessage() */
+static size_t beginMessage(std::vector<uint8_t> &out) {
+    out.insert(out.end(), PROTOCOL_LEN_SIZE, 0);
+    return out.size();
+}
+
+static void endMessage(std::vector<uint8_t> &out, size_t start) {
+    uint32_t len = out.size() - start;
+
+    for (size_t b = 0; b < PROTOCOL_LEN_SIZE; b++)
+        out[start - PROTOCOL_LEN_SIZE + b] = len >> (8 * b);
+}
+
+/* Commands' fields, of a fixed width */
+static void appendHexa(std::vector<uint8_t> &out, uint16_t value) {
+    char digits[HEXA_DIGITS + 1];
+
+    snprintf(digits, sizeof(digits), "%04x", value);
+    out.insert(out.end(), digits, digits + HEXA_DIGITS);
+}
+
+/* Groups' description fields, ended by a separator: HEXA_DIGITS, more past
+ * 0xFFFF rather than wrapping on designs of more LEDs */
+static void appendHexaIndex(std::vector<uint8_t> &out, uint32_t value) {
+    char digits[2 * sizeof(value) + 1];
+    int n = snprintf(digits, sizeof(digits), "%04" PRIx32, value);
+
+    out.insert(out.end(), digits, digits + n);
+}
+
+void encodeConnectionAck(std::vector<uint8_t> &out) {
+    size_t start = beginMessage(out);
+    out.push_back(CLIENT_CONNECTION_ACK_AND_WAITING_DATA);
+    endMessage(out, start);
+}
+
+void encodeDataAck(std::vector<uint8_t> &out,
+                   enum PROTOCOL_DATA_RECEIVED_INFO info) {
+    size_t start = beginMessage(out);
+    out.push_back(DATA_RECEIVED_ACK);
+    out.push_back(info);
+    endMessage(out, start);
+}
+
+void encodeGroupsDescription(std::vector<uint8_t> &out,
+                             const std::vector<struct LEDGroup> &groups) {
+    size_t start = beginMessage(out);
+
+    /* N<# of groups>,(<name>=<start>-<end>(+<start>-<end>)*;)* */
+    out.push_back(GROUPS_DESCRIPTION);
+    out.push_back('N');
+    appendHexaIndex(out, groups.size());
+    out.push_back(',');
+    for (const auto &group : groups) {
+        out.insert(out.end(), group.name.begin(), group.name.end());
+        out.push_back('=');
+        for (size_t i = 0; i < group.ranges.size(); i++) {
+            if (i)  out.push_back('+');
+            appendHexaIndex(out, group.ranges[i].start);
+            out.push_back('-');
+            appendHexaIndex(out, group.ranges[i].end);
+        }
+        out.push_back(';');
+    }
+    endMessage(out, start);
+}
+
+void encodeShaderStatus(std::vector<uint8_t> &out, const std::string &error) {
+    size_t start = beginMessage(out);
+    out.push_back(SHADER_STATUS);
+    out.insert(out.end(), error.begin(), error.end());
+    endMessage(out, start);
+}
+
+void encodeLeaveShutdown(std::vector<uint8_t> &out) {
+    size_t start = beginMessage(out);
+    out.push_back(LEAVE_SHUTDOWN);
+    endMessage(out, start);
+}
+
+void encodeFrame(std::vector<uint8_t> &out, const uint8_t *colors, size_t n,
+                 uint16_t count) {
+    size_t start = beginMessage(out);
+    const char preamble[] = "!C3N";
+
+    out.insert(out.end(), preamble, preamble + 4);
+    appendHexa(out, count);
+    out.push_back(',');
+    out.insert(out.end(), colors, colors + n * sizeof(uint32_t));
+    out.push_back('$');
+    endMessage(out, start);
+}
+
+void MessageReader::feed(const uint8_t *data, size_t len) {
+    /* Messages already returned: dropped before growing */
+    if (pos) {
+        buffer.erase(buffer.begin(), buffer.begin() + pos);
+        pos = 0;
+    }
+    buffer.insert(buffer.end(), data, data + len);
+}
+
+bool MessageReader::next(const uint8_t *&msg, size_t &len) {
+    if (broken || buffer.size() - pos < PROTOCOL_LEN_SIZE)
+        return false;
+
+    uint32_t msgLen = readU32(buffer.data() + pos);
+    if (msgLen > MESSAGE_MAX) {
+        broken = true;
+        return false;
+    }
+    if (buffer.size() - pos - PROTOCOL_LEN_SIZE < msgLen)
+        return false;
+
+    msg  = buffer.data() + pos + PROTOCOL_LEN_SIZE;
+    len  = msgLen;
+    pos += PROTOCOL_LEN_SIZE + msgLen;
+    return true;
+}
+
+void MessageReader::clear() {
+    buffer.clear();
+    pos    = 0;
+    broken = false;
+}
@@ -0,0 +1,104 @@
+#ifndef __PROTOCOL_H__
+#define __PROTOCOL_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+#include <vector>
+
+#include "../structure/group.h"     /* struct LEDGroup */
+
+#include "../../protocol_src/protocol_routing_variables.h"
+
+/* Server side of the protocol (see 01-Doc/protocol/protocol.md), without Qt:
+ * clients' commands are parsed in place, and answers are appended to a
+ * buffer with their 4 bytes length prefix (Little Endian), ready to write */
+
+enum ClientCommand {
+    CMD_UNKNOWN,
+    CMD_LEAVING,            /* "Leaving", any case                          */
+    CMD_FRAME,              /* "!C[3-4]N<hhhh>,(<LED>)+$"                   */
+    CMD_GROUPS_REQUEST,     /* "?G$"                                        */
+    CMD_GROUPS_COLOR,       /* "!GN<hhhh>,(<index><color>)+$"               */
+    CMD_EFFECTS,            /* "!EN<hhhh>,(<struct protocol_effect>)+$"     */
+    CMD_SHADER,             /* "!S<hhhh>,<source>$"                         */
+};
+
+/* Command parsed, pointing into the message */
+struct ClientRequest {
+    enum ClientCommand cmd;
+    /* Why the command is malformed, nullptr if it isn't */
+    const char *error;
+    /* CMD_FRAME: 3 (RGB) or 4 (RGBW) */
+    uint8_t  comp;
+    /* # of entries announced, shader's slot */
+    uint16_t count;
+    /* Entries (or shader's source), between ',' & '$' */
+    const uint8_t *data;
+    size_t   dataLen;
+    /* Entries really in data: frames may announce more/less than sent */
+    size_t   entries;
+};
+
+/* Length prefix of every message */
+static constexpr size_t PROTOCOL_LEN_SIZE = sizeof(uint32_t);
+/* Groups' & effects' entries */
+static constexpr size_t GROUP_ENTRY_LEN   = 2 * sizeof(uint32_t);
+static constexpr size_t EFFECT_ENTRY_LEN  = sizeof(struct protocol_effect);
+
+/* Identify & check a client's message (without its length prefix)
+ * @return false if malformed or unknown, req.error telling why */
+bool parseRequest(const uint8_t *msg, size_t len, struct ClientRequest &req);
+
+inline uint32_t readU32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+/* Entry i of a CMD_EFFECTS, the stream isn't aligned */
+struct protocol_effect decodeEffect(const struct ClientRequest &req, size_t i);
+/* Colors of a CMD_FRAME's LEDs, up to nLeds: RGBW frames are shown as white
+ * @return # of colors written */
+size_t decodeFrame(const struct ClientRequest &req, uint32_t *colors,
+                   size_t nLeds);
+/* How the LEDs announced compare to the design's */
+enum PROTOCOL_DATA_RECEIVED_INFO frameFilling(const struct ClientRequest &req,
+                                              size_t nLeds);
+
+/* Answers, appended to out */
+void encodeConnectionAck(std::vector<uint8_t> &out);
+void encodeDataAck(std::vector<uint8_t> &out,
+                   enum PROTOCOL_DATA_RECEIVED_INFO info);
+void encodeGroupsDescription(std::vector<uint8_t> &out,
+                             const std::vector<struct LEDGroup> &groups);
+void encodeShaderStatus(std::vector<uint8_t> &out, const std::string &error);
+void encodeLeaveShutdown(std::vector<uint8_t> &out);
+
+/* Clients' side, for tools sending streams: a RGB frame of n color words
+ * (Little Endian, like decodeFrame's) announcing count LEDs */
+void encodeFrame(std::vector<uint8_t> &out, const uint8_t *colors, size_t n,
+                 uint16_t count);
+
+/* Splits a byte stream into messages, however they were cut or merged */
+class MessageReader {
+
+public:
+    /* Longest message accepted */
+    static constexpr size_t MESSAGE_MAX = 1u << 20;
+
+    void feed(const uint8_t *data, size_t len);
+    /* Next complete message, valid until the next feed()
+     * @return false if none yet, or the stream is broken (see isBroken()) */
+    bool next(const uint8_t *&msg, size_t &len);
+    /* Bytes of a message not complete yet */
+    bool hasPartial() const { return buffer.size() > pos; }
+    /* A length over MESSAGE_MAX was announced: nothing more can be read */
+    bool isBroken() const { return broken; }
+    void clear();
+
+private:
+    std::vector<uint8_t> buffer;
+    /* Start of the 1st message not returned yet */
+    size_t pos    = 0;
+    bool   broken = false;
+};
+
+#endif // __PROTOCOL_H__
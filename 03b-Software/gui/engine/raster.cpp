@@ -0,0 +1,105 @@
+#include "raster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "color.h"
+
+/* Scene's margin around the LEDs, in design's unit */
+static constexpr double MARGIN = 10.0;
+
+void Rasterizer::setLayout(const struct LEDDisplay &display, size_t width) {
+    double minX = 0.0, minY = 0.0, maxX = 1.0, maxY = 1.0;
+
+    if ( ! display.leds.empty() ) {
+        minX = minY =  INFINITY;
+        maxX = maxY = -INFINITY;
+    }
+    /* Positions are the top-left corner, radius the diameter (see scene) */
+    for (const auto &led : display.leds) {
+        minX = std::min(minX, led.position.x);
+        minY = std::min(minY, led.position.y);
+        maxX = std::max(maxX, led.position.x + led.radius);
+        maxY = std::max(maxY, led.position.y + led.radius);
+    }
+    minX -= MARGIN;
+    minY -= MARGIN;
+    maxX += MARGIN;
+    maxY += MARGIN;
+
+    const double scale = width / (maxX - minX);
+
+    this->width  = std::max<size_t>(width, 1);
+    this->height = std::max<size_t>(std::lround((maxY - minY) * scale), 1);
+
+    /* Spans computed once: rendering is only fills */
+    discs.clear();
+    for (const auto &led : display.leds) {
+        const double r  = led.radius * scale / 2;
+        const double cx = (led.position.x - minX) * scale + r;
+        const double cy = (led.position.y - minY) * scale + r;
+        struct Disc disc;
+
+        disc.y0 = std::max(0.0, std::floor(cy - r));
+        disc.y1 = std::min<double>(height, std::ceil(cy + r));
+        for (size_t y = disc.y0; y < disc.y1; y++) {
+            double dy = y + 0.5 - cy;
+            double dx = std::sqrt(std::max(0.0, r * r - dy * dy));
+            uint32_t x0 = std::max(0.0, std::ceil(cx - dx - 0.5));
+            uint32_t x1 = std::min<double>(this->width,
+                                           std::floor(cx + dx - 0.5) + 1);
+            disc.spans.push_back({ x0, std::max(x0, x1) });
+        }
+        discs.push_back(disc);
+    }
+
+    image.assign(this->width * height, 0);
+}
+
+void Rasterizer::render(const uint32_t *colors, float brightness) {
+    std::fill(image.begin(), image.end(), 0);
+
+    for (size_t i = 0; i < discs.size(); i++) {
+        const struct Disc &disc = discs[i];
+        uint32_t word = colors[i];
+
+        if (brightness < 1.0f)
+            word = packColor(colorR(word) * brightness,
+                             colorG(word) * brightness,
+                             colorB(word) * brightness);
+
+        for (size_t y = disc.y0; y < disc.y1; y++) {
+            const auto &span = disc.spans[y - disc.y0];
+            std::fill(image.begin() + y * width + span.first,
+                      image.begin() + y * width + span.second, word);
+        }
+    }
+}
+
+bool Rasterizer::savePpm(const std::string &path, std::string &error) const {
+    std::ofstream file(path, std::ios::binary);
+    if ( ! (file && file.is_open()) ) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    file << "P6\n" << width << ' ' << height << "\n255\n";
+
+    std::vector<uint8_t> row(3 * width);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            uint32_t word = image[y * width + x];
+            row[3 * x + 0] = colorR(word);
+            row[3 * x + 1] = colorG(word);
+            row[3 * x + 2] = colorB(word);
+        }
+        file.write((const char *)row.data(), row.size());
+    }
+
+    if ( ! file ) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef __RASTER_H__
+#define __RASTER_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../structure/display.h"   /* struct LEDDisplay */
+
+/* Offscreen rendering of a design, like the GUI's scene draws it (each LED a
+ * disc on a black background) but into a plain RGB image: servers without a
+ * display can still be checked, or timed, drawing included */
+class Rasterizer {
+
+public:
+    /* Design scaled to width pixels, the height following its aspect */
+    void setLayout(const struct LEDDisplay &display, size_t width);
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+
+    /* Draw colors[# of LEDs] (color words), scaled by brightness */
+    void render(const uint32_t *colors, float brightness = 1.0f);
+    /* Pixels, row by row, as color words */
+    const std::vector<uint32_t>& getImage() const { return image; }
+
+    /* Binary PPM (P6)
+     * @return false on error, with a message in error */
+    bool savePpm(const std::string &path, std::string &error) const;
+
+private:
+    /* Pixels of a LED's disc: rows [y0, y1[, row r spanning spans[r] */
+    struct Disc {
+        size_t y0, y1;
+        std::vector<std::pair<uint32_t, uint32_t>> spans;
+    };
+
+    size_t width  = 0;
+    size_t height = 0;
+    std::vector<struct Disc> discs;
+    std::vector<uint32_t> image;
+};
+
+#endif // __RASTER_H__
@@ -0,0 +1,253 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "trace.h"
+
+void DisplayServer::setDisplay(const struct LEDDisplay &display,
+                               const struct LEDType &defaultType) {
+    this->display = display;
+    frame.assign(display.leds.size(), 0);
+    outputFrame.assign(display.leds.size(), 0);
+
+    effects.setLayout(display);
+    chains.setLayout(display, defaultType);
+    refresh.configure(chains.getFrameTime(), display.leds.size());
+    power.configure(defaultType);
+
+    refresh.resetStats();
+    power.resetStats();
+    present();
+}
+
+void DisplayServer::setPowerBudget(double budgetMa) {
+    power.setBudget(budgetMa);
+    power.resetStats();
+    present();
+}
+
+void DisplayServer::setRefreshPolicy(enum RefreshPolicy policy, double now) {
+    this->policy = policy;
+    flushPendingFrame(now);
+}
+
+void DisplayServer::setColors(const uint32_t *colors, size_t n) {
+    std::copy(colors, colors + std::min(n, frame.size()), frame.begin());
+    present();
+}
+
+void DisplayServer::resetStats() {
+    stats = {};
+    refresh.resetStats();
+    power.resetStats();
+    latency.reset();
+}
+
+void DisplayServer::greet(std::vector<uint8_t> &answers) const {
+    encodeConnectionAck(answers);
+}
+
+bool DisplayServer::handle(const uint8_t *msg, size_t len, double now,
+                           std::vector<uint8_t> &answers, uint64_t read) {
+    struct FrameTimes times = {};
+    struct ClientRequest req;
+
+    if (read) {
+        times.read     = read;
+        times.complete = LatencyStats::clock();
+    }
+    TRACE_BEGIN("parse", stats.messages + 1);
+    bool ok = parseRequest(msg, len, req);
+    TRACE_END("parse", stats.messages + 1);
+    if (read)
+        times.parsed = LatencyStats::clock();
+
+    stats.messages++;
+    stats.bytes += PROTOCOL_LEN_SIZE + len;
+    lastError.clear();
+
+    if (req.cmd == CMD_LEAVING)
+        return false;
+
+    /* Answered even if malformed: the client waits for the status */
+    if (req.cmd == CMD_SHADER) {
+        std::string error;
+
+        stats.shaders++;
+        if (req.error)
+            error = req.error;
+        else
+            effects.loadShader(req.count, std::string((const char *)req.data,
+                                                      req.dataLen), error);
+        encodeShaderStatus(answers, error);
+        lastError = error;
+        return true;
+    }
+
+    if ( ! ok ) {
+        lastError = req.error ? req.error : "";
+        if (req.cmd == CMD_UNKNOWN)
+            stats.unknown++;
+        else
+            stats.malformed++;
+        return true;
+    }
+
+    switch (req.cmd) {
+    case CMD_FRAME:
+        stats.frames++;
+        stats.ledsReceived += req.entries;
+        encodeDataAck(answers, frameFilling(req, frame.size()));
+
+        /* Would the hardware's data line be free to send it? */
+        if (refresh.receive(now)) {
+            refresh.send(now);
+            /* Newer than the one held back */
+            if ( ! pendingFrame.empty() )
+                stats.dropped++;
+            pendingFrame.clear();
+        } else if (policy == REFRESH_THROTTLE) {
+            /* Only the latest is shown once the line is free */
+            if ( ! pendingFrame.empty() )
+                stats.dropped++;
+            pendingFrame.assign(msg, msg + len);
+            pendingTimes = times;
+            break;
+        }
+        applyFrame(req, times);
+        break;
+    case CMD_GROUPS_REQUEST:
+        stats.groupsRequests++;
+        encodeGroupsDescription(answers, display.groups);
+        break;
+    case CMD_GROUPS_COLOR: {
+        const uint8_t *data = req.data;
+
+        stats.groupsCommands++;
+        for (size_t i = 0; i < req.entries; i++, data += GROUP_ENTRY_LEN) {
+            uint32_t idx   = readU32(data);
+            uint32_t color = readU32(data + sizeof(uint32_t)) & 0x00FFFFFF;
+
+            /* Unknown group: skip it, but keep applying the others */
+            if (idx >= display.groups.size())
+                continue;
+
+            /* Designs built in memory aren't checked like the loaded ones */
+            for (const auto &range : display.groups[idx].ranges) {
+                if (range.start > range.end || range.start >= frame.size())
+                    continue;
+                std::fill(frame.begin() + range.start,
+                          frame.begin() + std::min<size_t>(range.end + 1,
+                                                           frame.size()),
+                          color);
+            }
+        }
+        present();
+        break;
+    }
+    case CMD_EFFECTS:
+        stats.effectsCommands++;
+        for (size_t i = 0; i < req.entries; i++) {
+            /* The valid entries are still applied */
+            if ( ! effects.apply(decodeEffect(req, i), now) )
+                lastError = "Invalid effects' entries";
+        }
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+bool DisplayServer::flushPendingFrame(double now) {
+    struct ClientRequest req;
+
+    if (pendingFrame.empty())
+        return false;
+    /* Timers' precision: may be called a bit early */
+    if (policy == REFRESH_THROTTLE && ! refresh.isFree(now))
+        return false;
+
+    refresh.send(now);
+    if (parseRequest(pendingFrame.data(), pendingFrame.size(), req))
+        applyFrame(req, pendingTimes);
+    pendingFrame.clear();
+    return true;
+}
+
+/** **************************************************************************
+ * @brief Show a frame already checked, timed from its 1st byte read when
+ *        times.read is set
+ *************************************************************************** */
+void DisplayServer::applyFrame(const struct ClientRequest &req,
+                               struct FrameTimes &times) {
+    TRACE_SCOPE("frame", stats.frames);
+    if (times.read)
+        times.applying = LatencyStats::clock();
+
+    /* Extra data beyond the design's LEDs are dropped */
+    if (decodeFrame(req, frame.data(), frame.size()))
+        present();
+
+    if (times.read) {
+        times.applied = LatencyStats::clock();
+        latency.frameApplied(times);
+    }
+}
+
+bool DisplayServer::renderEffects(double now) {
+    if ( ! effects.isRunning() )
+        return false;
+
+    TRACE_SCOPE("effects", stats.effectsRendered + 1);
+    effects.render(now);
+
+    const ColorBuffer &rendered = effects.getFrame();
+    for (const auto &range : effects.getRenderedRanges())
+        std::copy(rendered.begin() + range.start,
+                  rendered.begin() + range.end + 1,
+                  frame.begin() + range.start);
+
+    stats.effectsRendered++;
+    present();
+    return true;
+}
+
+/** **************************************************************************
+ * @brief Frame as the hardware would show it: scaled down to the supply's
+ *        budget, then split into each chain's bytes
+ *************************************************************************** */
+void DisplayServer::present() {
+    TRACE_SCOPE("present", stats.presented + 1);
+    std::copy(frame.begin(), frame.end(), outputFrame.begin());
+    brightness = power.process(outputFrame.data(), outputFrame.size());
+    chains.split(outputFrame.data());
+    stats.presented++;
+}
+
+std::string DisplayServer::describeStats() const {
+    char line[768];
+
+    std::snprintf(line, sizeof(line),
+                  "messages=%" PRIu64 " bytes=%" PRIu64 " frames=%" PRIu64
+                  " leds=%" PRIu64 " dropped=%" PRIu64
+                  " groups_requests=%" PRIu64
+                  " groups_commands=%" PRIu64 " effects_commands=%" PRIu64
+                  " shaders=%" PRIu64 " malformed=%" PRIu64
+                  " unknown=%" PRIu64 " effects_rendered=%" PRIu64
+                  " presented=%" PRIu64
+                  " in_fps=%.1f max_fps=%.1f too_fast=%" PRIu64
+                  " current_ma=%.0f requested_ma=%.0f peak_ma=%.0f"
+                  " average_ma=%.0f",
+                  stats.messages, stats.bytes, stats.frames,
+                  stats.ledsReceived, stats.dropped, stats.groupsRequests,
+                  stats.groupsCommands, stats.effectsCommands, stats.shaders,
+                  stats.malformed, stats.unknown, stats.effectsRendered,
+                  stats.presented,
+                  refresh.getIncomingFps(), refresh.getMaxFps(),
+                  refresh.getNumberOfTooFast(), power.getCurrent(),
+                  power.getRequested(), power.getPeak(), power.getAverage());
+    return line;
+}
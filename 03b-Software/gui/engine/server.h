@@ -0,0 +1,137 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+#include <vector>
+
+#include "chains.h"
+#include "effects.h"
+#include "latency.h"
+#include "ledtypes.h"
+#include "pipeline.h"
+#include "power.h"
+#include "protocol.h"
+#include "../structure/display.h"   /* struct LEDDisplay */
+
+/* What to do with frames arriving faster than the hardware can show them */
+enum RefreshPolicy {
+    REFRESH_NO_LIMIT = 0,
+    /* Shown, but reported */
+    REFRESH_FLAG     = 1,
+    /* Only the latest is shown, once the data line is free */
+    REFRESH_THROTTLE = 2,
+};
+
+/* Counters of everything the clients sent, & of the frames presented */
+struct ServerStats {
+    uint64_t messages;
+    uint64_t bytes;             /* Length prefixes included               */
+    uint64_t frames;            /* "!C"                                   */
+    uint64_t ledsReceived;      /* LEDs' data in the frames               */
+    uint64_t dropped;           /* Held back, replaced by a newer one     */
+    uint64_t groupsRequests;    /* "?G"                                   */
+    uint64_t groupsCommands;    /* "!G"                                   */
+    uint64_t effectsCommands;   /* "!E"                                   */
+    uint64_t shaders;           /* "!S", compiled or not                  */
+    uint64_t malformed;         /* Known command, wrong framing           */
+    uint64_t unknown;
+    uint64_t effectsRendered;   /* Frames rendered by the local effects   */
+    uint64_t presented;         /* Power limited & split, any source      */
+};
+
+/* The clients' commands applied to a design, for the GUI, ledserver &
+ * ledreplay: the design's colors, the effects, & the frames as the hardware
+ * would send them (power limited, split into chains). Sockets & widgets are
+ * up to the caller, every message being handled at a given time with its
+ * answers appended to a buffer */
+class DisplayServer {
+
+public:
+    /* Chains without a type are of defaultType, colors are cleared & the
+     * refresh's & power's stats reset. Running effects are kept, unless their
+     * group is gone */
+    void setDisplay(const struct LEDDisplay &display,
+                    const struct LEDType &defaultType);
+    const struct LEDDisplay& getDisplay() const { return display; }
+    size_t getNumberOfLeds() const { return frame.size(); }
+    /* Supply's budget [mA], 0 not to limit, power's stats are reset */
+    void setPowerBudget(double budgetMa);
+
+    /* REFRESH_NO_LIMIT by default. Not throttling anymore: the frame held
+     * back is shown at once */
+    void setRefreshPolicy(enum RefreshPolicy policy, double now);
+    enum RefreshPolicy getRefreshPolicy() const { return policy; }
+
+    /* A client's message (length prefix removed) at time "now" [s], its 1st
+     * byte read at "read" [ns, LatencyStats::clock()], 0 not to measure it
+     * @return false once the client leaves */
+    bool handle(const uint8_t *msg, size_t len, double now,
+                std::vector<uint8_t> &answers, uint64_t read = 0);
+    /* A client arrived: its connection's ack */
+    void greet(std::vector<uint8_t> &answers) const;
+    /* Why the last message handled was refused or partly applied (malformed,
+     * shader not compiled, invalid effects' entries), empty if it wasn't */
+    const std::string& getLastError() const { return lastError; }
+
+    /* Latest frame held back while throttling, due at
+     * getRefresh().getNextSlot()
+     * @return false if none or the data line is still busy at now [s] */
+    bool hasPendingFrame() const { return ! pendingFrame.empty(); }
+    bool flushPendingFrame(double now);
+
+    /* Colors set locally (e.g. a timeline) from the 1st LED, extra ones
+     * dropped */
+    void setColors(const uint32_t *colors, size_t n);
+
+    /* Render the running effects at time "now" [s]
+     * @return false if none is running */
+    bool renderEffects(double now);
+    bool effectsRunning() const { return effects.isRunning(); }
+    /* Local shaders & commands, besides the clients' */
+    EffectsEngine& getEffects() { return effects; }
+
+    /* Colors as set by the clients & effects */
+    const ColorBuffer& getFrame() const { return frame; }
+    /* Same, scaled down to the power budget: what the LEDs show */
+    const ColorBuffer& getOutputFrame() const { return outputFrame; }
+    float getBrightness() const { return brightness; }
+
+    const struct ServerStats& getStats() const { return stats; }
+    const RefreshModel& getRefresh() const { return refresh; }
+    const PowerModel& getPower() const { return power; }
+    const ChainPartitioner& getChains() const { return chains; }
+    /* Frames' stages up to applied, the caller telling when presented */
+    LatencyStats& getLatency() { return latency; }
+    const LatencyStats& getLatency() const { return latency; }
+    void resetStats();
+
+    /* Every counter, "key=value" separated by spaces on a single line */
+    std::string describeStats() const;
+
+private:
+    void applyFrame(const struct ClientRequest &req, struct FrameTimes &times);
+    void present();
+
+    struct LEDDisplay display;
+    ColorBuffer frame;
+    ColorBuffer outputFrame;
+    float brightness = 1.0f;
+
+    EffectsEngine    effects;
+    ChainPartitioner chains;
+    RefreshModel     refresh;
+    PowerModel       power;
+    LatencyStats     latency;
+
+    /* pendingFrame: message of the latest frame held back */
+    enum RefreshPolicy   policy = REFRESH_NO_LIMIT;
+    std::vector<uint8_t> pendingFrame;
+    struct FrameTimes    pendingTimes = {};
+
+    std::string        lastError;
+    struct ServerStats stats = {};
+};
+
+#endif // __SERVER_H__
@@ -0,0 +1,555 @@
+#include "shader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#include "color.h"
+
+/* Registers' layout: inputs first, then constants & temporaries mixed */
+enum ShaderInput : uint16_t {
+    /* Read in place from LEDGeometry */
+    IN_X, IN_Y, IN_U, IN_V, IN_ANGLE, IN_RADIUS, IN_ROTATION, IN_GROUP,
+    /* Computed/broadcast in the scratch buffer */
+    IN_INDEX, IN_TIME,
+    INPUTS,
+};
+#define GEOMETRY_INPUTS IN_INDEX
+
+/* Bounds the scratch buffer: 1024 x BATCH floats = 1MiB per thread */
+#define MAX_REGISTERS   1024
+
+static inline float hashToUnit(float a) {
+    /* NaN & infinities have no integer part. Others are reduced modulo 2^32
+     * first, the cast being undefined out of range (same hash in range) */
+    if ( ! std::isfinite(a) )
+        return 0.0f;
+    double n = std::fmod(std::floor((double)a), 4294967296.0);
+    if (n < 0.0)
+        n += 4294967296.0;
+
+    uint32_t h = (uint32_t)n * 0x9E3779B1u;
+    h ^= h >> 15;
+    h *= 0x85EBCA77u;
+    h ^= h >> 13;
+    return (h & 0xFFFFFF) / 16777216.0f;
+}
+
+static inline float smoothstep(float e0, float e1, float x) {
+    float t = std::clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+/* Single definition of each operation, shared by the constant folding
+ * and the batch loops: X(OP, expression of a[, b[, c]]) */
+#define SHADER_UNARY_OPS(X)                                                   \
+    X(NEG,   -a)                                                              \
+    X(NOT,   a == 0.0f ? 1.0f : 0.0f)                                         \
+    X(SIN,   std::sin(a))                                                     \
+    X(COS,   std::cos(a))                                                     \
+    X(TAN,   std::tan(a))                                                     \
+    X(ABS,   std::fabs(a))                                                    \
+    X(FLOOR, std::floor(a))                                                   \
+    X(FRACT, a - std::floor(a))                                               \
+    X(SQRT,  std::sqrt(a))                                                    \
+    X(EXP,   std::exp(a))                                                     \
+    X(LOG,   std::log(a))                                                     \
+    X(HASH,  hashToUnit(a))
+
+#define SHADER_BINARY_OPS(X)                                                  \
+    X(ADD,   a + b)                                                           \
+    X(SUB,   a - b)                                                           \
+    X(MUL,   a * b)                                                           \
+    X(DIV,   a / b)                                                           \
+    X(MOD,   a - b * std::floor(a / b))                                       \
+    X(LT,    a <  b ? 1.0f : 0.0f)                                            \
+    X(LE,    a <= b ? 1.0f : 0.0f)                                            \
+    X(GT,    a >  b ? 1.0f : 0.0f)                                            \
+    X(GE,    a >= b ? 1.0f : 0.0f)                                            \
+    X(EQ,    a == b ? 1.0f : 0.0f)                                            \
+    X(NE,    a != b ? 1.0f : 0.0f)                                            \
+    X(AND,   a != 0.0f && b != 0.0f ? 1.0f : 0.0f)                            \
+    X(OR,    a != 0.0f || b != 0.0f ? 1.0f : 0.0f)                            \
+    X(ATAN2, std::atan2(a, b))                                                \
+    X(POW,   std::pow(a, b))                                                  \
+    X(MIN,   std::min(a, b))                                                  \
+    X(MAX,   std::max(a, b))                                                  \
+    X(STEP,  b < a ? 0.0f : 1.0f)
+
+#define SHADER_TERNARY_OPS(X)                                                 \
+    X(SELECT,     a != 0.0f ? b : c)                                          \
+    X(CLAMP,      std::fmin(std::fmax(a, b), c))                              \
+    X(MIX,        a + (b - a) * c)                                            \
+    X(SMOOTHSTEP, smoothstep(a, b, c))
+
+/* ************************************************************************** *
+ * ***                               COMPILER                             *** *
+ * ************************************************************************** */
+class ShaderCompiler {
+
+public:
+    ShaderCompiler(ShaderProgram &program, const std::string &source)
+        : prg(program), src(source) {}
+
+    bool run();
+
+private:
+    struct Token {
+        enum { NUMBER, IDENT, SYMBOL, END } kind;
+        std::string text;
+        float value;
+        int line, col;
+    };
+
+    bool tokenize();
+    bool fail(const Token &at, const std::string &msg);
+    bool accept(const char *symbol);
+    bool expect(const char *symbol);
+
+    /* Each parse function returns the register holding the result, -1 on error */
+    int expression();
+    int logicalOr();
+    int logicalAnd();
+    int comparison();
+    int additive();
+    int multiplicative();
+    int unary();
+    int primary();
+
+    int constant(float value);
+    int emit(ShaderProgram::Op op, int a, int b = -1, int c = -1);
+
+    ShaderProgram &prg;
+    const std::string &src;
+
+    std::vector<Token> tokens;
+    size_t pos = 0;
+
+    std::map<std::string, int> variables;
+    /* Register -> value, for constant folding */
+    std::map<int, float> constValues;
+};
+
+bool ShaderCompiler::fail(const Token &at, const std::string &msg) {
+    if (prg.error.empty())
+        prg.error = std::to_string(at.line) + ":" + std::to_string(at.col) +
+                    ": " + msg;
+    return false;
+}
+
+bool ShaderCompiler::tokenize() {
+    static const char *doubles[] = { "&&", "||", "<=", ">=", "==", "!=" };
+    int line = 1, col = 1;
+    size_t i = 0;
+
+    while (i < src.size()) {
+        char ch = src[i];
+        Token tok = { Token::END, "", 0.0f, line, col };
+        size_t len = 1;
+
+        if (ch == '\n') {
+            line++;
+            col = 1;
+            i++;
+            continue;
+        } else if (std::isspace((unsigned char)ch)) {
+            len = 1;
+            tok.kind = Token::END;  /* Skipped */
+        } else if (ch == '#' || src.compare(i, 2, "//") == 0) {
+            len = src.find('\n', i);
+            len = (len == std::string::npos ? src.size() : len) - i;
+        } else if (std::isdigit((unsigned char)ch) || ch == '.') {
+            /* Not strtof(): "1.5" must not depend on the locale */
+            const char *start = src.c_str() + i;
+            const auto res = std::from_chars(start, src.c_str() + src.size(),
+                                             tok.value);
+            tok.kind = Token::NUMBER;
+            len = res.ptr - start;
+            if (res.ec != std::errc() || ! len)
+                return fail(tok, "invalid number");
+        } else if (std::isalpha((unsigned char)ch) || ch == '_') {
+            tok.kind = Token::IDENT;
+            while (i + len < src.size() &&
+                   (std::isalnum((unsigned char)src[i+len]) || src[i+len] == '_'))
+                len++;
+        } else {
+            tok.kind = Token::SYMBOL;
+            for (const char *d : doubles)
+                if (src.compare(i, 2, d) == 0)
+                    len = 2;
+            if (len == 1 && (ch == '\0' || ! std::strchr("+-*/%!<>?:(),;=", ch)))
+                return fail(tok, std::string("unexpected character '") + ch + "'");
+        }
+
+        if (tok.kind != Token::END) {
+            tok.text = src.substr(i, len);
+            tokens.push_back(tok);
+        }
+        i   += len;
+        col += len;
+    }
+
+    tokens.push_back({ Token::END, "end of source", 0.0f, line, col });
+    return true;
+}
+
+bool ShaderCompiler::accept(const char *symbol) {
+    if (tokens[pos].kind == Token::SYMBOL && tokens[pos].text == symbol) {
+        pos++;
+        return true;
+    }
+    return false;
+}
+
+bool ShaderCompiler::expect(const char *symbol) {
+    if (accept(symbol))
+        return true;
+    return fail(tokens[pos], std::string("expected '") + symbol +
+                             "' before '" + tokens[pos].text + "'");
+}
+
+int ShaderCompiler::constant(float value) {
+    /* Share registers between identical constants */
+    for (const auto &c : prg.constants)
+        if (c.value == value || (std::isnan(c.value) && std::isnan(value)))
+            return c.reg;
+
+    if (prg.registers >= MAX_REGISTERS)
+        return fail(tokens[pos], "program too large"), -1;
+
+    int reg = prg.registers++;
+    prg.constants.push_back({ (uint16_t)reg, value });
+    constValues[reg] = value;
+    return reg;
+}
+
+int ShaderCompiler::emit(ShaderProgram::Op op, int a, int b, int c) {
+    if (a < 0 || (op >= ShaderProgram::ADD && b < 0) ||
+        (op >= ShaderProgram::SELECT && c < 0))
+        return -1;
+
+    /* Constant folding: every operand known at compile time */
+    auto known = [this](int reg) { return reg < 0 || constValues.count(reg); };
+    if (known(a) && known(b) && known(c)) {
+        float va = constValues[a];
+        float vb = b < 0 ? 0.0f : constValues[b];
+        float vc = c < 0 ? 0.0f : constValues[c];
+        float r  = 0.0f;
+        (void)vb; (void)vc;
+
+        switch (op) {
+        #define FOLD1(OP, EXPR) case ShaderProgram::OP: { float a = va; r = EXPR; } break;
+        #define FOLD2(OP, EXPR) case ShaderProgram::OP: { float a = va, b = vb; r = EXPR; } break;
+        #define FOLD3(OP, EXPR) case ShaderProgram::OP: { float a = va, b = vb, c = vc; r = EXPR; } break;
+        SHADER_UNARY_OPS(FOLD1)
+        SHADER_BINARY_OPS(FOLD2)
+        SHADER_TERNARY_OPS(FOLD3)
+        #undef FOLD1
+        #undef FOLD2
+        #undef FOLD3
+        }
+        return constant(r);
+    }
+
+    if (prg.registers >= MAX_REGISTERS)
+        return fail(tokens[pos], "program too large"), -1;
+
+    int dst = prg.registers++;
+    prg.code.push_back({ op, (uint16_t)dst, (uint16_t)a,
+                         (uint16_t)std::max(b, 0), (uint16_t)std::max(c, 0) });
+    return dst;
+}
+
+bool ShaderCompiler::run() {
+    static const char *names[] = { "r", "g", "b" };
+
+    prg.registers = INPUTS;
+
+    if ( ! tokenize() )
+        return false;
+
+    while (tokens[pos].kind != Token::END) {
+        const Token &name = tokens[pos];
+
+        if (name.kind != Token::IDENT)
+            return fail(name, "expected a variable's name, got '" +
+                              name.text + "'");
+        pos++;
+
+        if ( ! expect("=") )
+            return false;
+
+        int reg = expression();
+        if (reg < 0)
+            return false;
+
+        /* Last ';' is optional */
+        if (tokens[pos].kind != Token::END && ! expect(";"))
+            return false;
+
+        variables[name.text] = reg;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        auto it = variables.find(names[i]);
+        int reg = it == variables.end() ? constant(0.0f) : it->second;
+        if (reg < 0)
+            return false;
+        prg.outputs[i] = reg;
+    }
+
+    return true;
+}
+
+int ShaderCompiler::expression() {
+    int cond = logicalOr();
+
+    if (cond < 0 || ! accept("?"))
+        return cond;
+
+    int a = expression();
+    if (a < 0 || ! expect(":"))
+        return -1;
+    int b = expression();
+
+    return emit(ShaderProgram::SELECT, cond, a, b);
+}
+
+int ShaderCompiler::logicalOr() {
+    int a = logicalAnd();
+
+    while (a >= 0 && accept("||"))
+        a = emit(ShaderProgram::OR, a, logicalAnd());
+    return a;
+}
+
+int ShaderCompiler::logicalAnd() {
+    int a = comparison();
+
+    while (a >= 0 && accept("&&"))
+        a = emit(ShaderProgram::AND, a, comparison());
+    return a;
+}
+
+int ShaderCompiler::comparison() {
+    static const struct { const char *sym; ShaderProgram::Op op; } ops[] = {
+        { "<=", ShaderProgram::LE }, { ">=", ShaderProgram::GE },
+        { "==", ShaderProgram::EQ }, { "!=", ShaderProgram::NE },
+        { "<",  ShaderProgram::LT }, { ">",  ShaderProgram::GT },
+    };
+    int a = additive();
+
+    for (bool found = true; a >= 0 && found; ) {
+        found = false;
+        for (const auto &o : ops) {
+            if (accept(o.sym)) {
+                a = emit(o.op, a, additive());
+                found = true;
+                break;
+            }
+        }
+    }
+    return a;
+}
+
+int ShaderCompiler::additive() {
+    int a = multiplicative();
+
+    while (a >= 0) {
+        if (accept("+"))
+            a = emit(ShaderProgram::ADD, a, multiplicative());
+        else if (accept("-"))
+            a = emit(ShaderProgram::SUB, a, multiplicative());
+        else
+            break;
+    }
+    return a;
+}
+
+int ShaderCompiler::multiplicative() {
+    int a = unary();
+
+    while (a >= 0) {
+        if (accept("*"))
+            a = emit(ShaderProgram::MUL, a, unary());
+        else if (accept("/"))
+            a = emit(ShaderProgram::DIV, a, unary());
+        else if (accept("%"))
+            a = emit(ShaderProgram::MOD, a, unary());
+        else
+            break;
+    }
+    return a;
+}
+
+int ShaderCompiler::unary() {
+    if (accept("-"))
+        return emit(ShaderProgram::NEG, unary());
+    if (accept("!"))
+        return emit(ShaderProgram::NOT, unary());
+    return primary();
+}
+
+int ShaderCompiler::primary() {
+    static const std::map<std::string, int> inputs = {
+        { "x", IN_X }, { "y", IN_Y }, { "u", IN_U }, { "v", IN_V },
+        { "angle", IN_ANGLE },
+        { "radius", IN_RADIUS }, { "rotation", IN_ROTATION },
+        { "group", IN_GROUP }, { "index", IN_INDEX }, { "time", IN_TIME },
+    };
+    static const std::map<std::string, std::pair<ShaderProgram::Op, int>> funcs = {
+        { "sin",   { ShaderProgram::SIN,   1 } }, { "cos",  { ShaderProgram::COS,  1 } },
+        { "tan",   { ShaderProgram::TAN,   1 } }, { "abs",  { ShaderProgram::ABS,  1 } },
+        { "floor", { ShaderProgram::FLOOR, 1 } }, { "fract",{ ShaderProgram::FRACT,1 } },
+        { "sqrt",  { ShaderProgram::SQRT,  1 } }, { "exp",  { ShaderProgram::EXP,  1 } },
+        { "log",   { ShaderProgram::LOG,   1 } }, { "hash", { ShaderProgram::HASH, 1 } },
+        { "atan2", { ShaderProgram::ATAN2, 2 } }, { "pow",  { ShaderProgram::POW,  2 } },
+        { "min",   { ShaderProgram::MIN,   2 } }, { "max",  { ShaderProgram::MAX,  2 } },
+        { "mod",   { ShaderProgram::MOD,   2 } }, { "step", { ShaderProgram::STEP, 2 } },
+        { "clamp", { ShaderProgram::CLAMP, 3 } }, { "mix",  { ShaderProgram::MIX,  3 } },
+        { "smoothstep", { ShaderProgram::SMOOTHSTEP, 3 } },
+    };
+    const Token &tok = tokens[pos];
+
+    if (tok.kind == Token::NUMBER) {
+        pos++;
+        return constant(tok.value);
+    }
+
+    if (accept("(")) {
+        int reg = expression();
+        if (reg < 0 || ! expect(")"))
+            return -1;
+        return reg;
+    }
+
+    if (tok.kind != Token::IDENT)
+        return fail(tok, "unexpected '" + tok.text + "'"), -1;
+    pos++;
+
+    if (accept("(")) {
+        auto fn = funcs.find(tok.text);
+        int args[3] = { -1, -1, -1 };
+
+        if (fn == funcs.end())
+            return fail(tok, "unknown function '" + tok.text + "'"), -1;
+
+        for (int i = 0; i < fn->second.second; i++) {
+            if ((i && ! expect(",")) || (args[i] = expression()) < 0)
+                return -1;
+        }
+        if ( ! expect(")") )
+            return -1;
+
+        return emit(fn->second.first, args[0], args[1], args[2]);
+    }
+
+    /* Variables shadow inputs, so a program can "patch" them */
+    auto var = variables.find(tok.text);
+    if (var != variables.end())
+        return var->second;
+
+    auto in = inputs.find(tok.text);
+    if (in != inputs.end())
+        return in->second;
+
+    if (tok.text == "pi")
+        return constant(3.14159265f);
+
+    return fail(tok, "unknown variable '" + tok.text + "'"), -1;
+}
+
+/* ************************************************************************** *
+ * ***                                PROGRAM                             *** *
+ * ************************************************************************** */
+bool ShaderProgram::compile(const std::string &source) {
+    code.clear();
+    constants.clear();
+    registers = 0;
+    valid     = false;
+    error.clear();
+
+    valid = ShaderCompiler(*this, source).run();
+    if ( ! valid )
+        code.clear();
+
+    return valid;
+}
+
+void ShaderProgram::evaluate(const struct LEDGeometry &geometry, float time,
+                             uint32_t *out, size_t begin, size_t end) const {
+    if ( ! valid ) {
+        std::fill(out + begin, out + end, 0);
+        return;
+    }
+
+    /* Registers from GEOMETRY_INPUTS, reused across frames by each thread */
+    thread_local std::vector<float> scratch;
+    scratch.resize((registers - GEOMETRY_INPUTS) * BATCH);
+
+    const float *geometryInputs[GEOMETRY_INPUTS] = {
+        geometry.x.data(), geometry.y.data(), geometry.u.data(),
+        geometry.v.data(), geometry.angle.data(), geometry.radius.data(),
+        geometry.rotation.data(), geometry.group.data()
+    };
+    std::vector<const float *> reg(registers);
+    auto writable = [&](uint16_t r) {
+        return scratch.data() + (r - GEOMETRY_INPUTS) * BATCH;
+    };
+
+    for (uint16_t r = GEOMETRY_INPUTS; r < registers; r++)
+        reg[r] = writable(r);
+
+    /* Broadcast once, never overwritten */
+    std::fill_n(writable(IN_TIME), BATCH, time);
+    for (const auto &c : constants)
+        std::fill_n(writable(c.reg), BATCH, c.value);
+
+    for (size_t first = begin; first < end; first += BATCH) {
+        const size_t m = std::min(BATCH, end - first);
+        float *index = writable(IN_INDEX);
+
+        for (int r = 0; r < GEOMETRY_INPUTS; r++)
+            reg[r] = geometryInputs[r] + first;
+        for (size_t i = 0; i < m; i++)
+            index[i] = first + i;
+
+        for (const auto &in : code) {
+            float *d = writable(in.dst);
+            const float *pa = reg[in.a], *pb = reg[in.b], *pc = reg[in.c];
+            (void)pb; (void)pc;
+
+            switch (in.op) {
+            #define LOOP1(OP, EXPR) case OP:                                   \
+                for (size_t i = 0; i < m; i++) { float a = pa[i]; d[i] = EXPR; } \
+                break;
+            #define LOOP2(OP, EXPR) case OP:                                   \
+                for (size_t i = 0; i < m; i++) {                               \
+                    float a = pa[i], b = pb[i]; d[i] = EXPR; }                 \
+                break;
+            #define LOOP3(OP, EXPR) case OP:                                   \
+                for (size_t i = 0; i < m; i++) {                               \
+                    float a = pa[i], b = pb[i], c = pc[i]; d[i] = EXPR; }      \
+                break;
+            SHADER_UNARY_OPS(LOOP1)
+            SHADER_BINARY_OPS(LOOP2)
+            SHADER_TERNARY_OPS(LOOP3)
+            #undef LOOP1
+            #undef LOOP2
+            #undef LOOP3
+            }
+        }
+
+        const float *r = reg[outputs[0]], *g = reg[outputs[1]],
+                    *b = reg[outputs[2]];
+        /* fmin/fmax rather than clamp, so NaN ends up as 0 */
+        for (size_t i = 0; i < m; i++)
+            out[first + i] = packColorF(std::fmin(std::fmax(r[i], 0.0f), 1.0f),
+                                        std::fmin(std::fmax(g[i], 0.0f), 1.0f),
+                                        std::fmin(std::fmax(b[i], 0.0f), 1.0f));
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef __SHADER_H__
+#define __SHADER_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+
+/* Per-LED color function, like a pixel shader. Source is a list of
+ * assignments, the outputs being "r", "g" & "b" in [0;1] (clamped):
+ *
+ *     # Rainbow turning around the design's center
+ *     h = fract(angle / (2 * pi) + time * 0.25);
+ *     r = clamp(abs(h * 6 - 3) - 1, 0, 1);
+ *     g = clamp(2 - abs(h * 6 - 2), 0, 1);
+ *     b = clamp(2 - abs(h * 6 - 4), 0, 1);
+ *
+ * Inputs : index, x, y, u, v, angle, radius, rotation, group, time [s] &
+ *          the constant pi. x & y are in the scene's unit, u & v the same
+ *          normalized to [0;1] over the design, angle in [-pi;pi] & radius
+ *          in [0;1] around its center (see LEDGeometry)
+ * Ops    : + - * / % ! < <= > >= == != && || ?: (false is 0, true is 1)
+ * Funcs  : sin cos tan abs floor fract sqrt exp log hash,
+ *          atan2 pow min max mod step, clamp mix smoothstep
+ *
+ * Compiled once into a register based bytecode where each instruction runs
+ * over a batch of LEDs (Structure of Arrays), amortizing the dispatch */
+class ShaderProgram {
+
+public:
+    /* @return false on error, see getError() ("line:column: message") */
+    bool compile(const std::string &source);
+    bool isValid() const { return valid; }
+    const std::string& getError() const { return error; }
+
+    /* Evaluate LEDs [begin;end[ into out[begin;end[, time in [s]
+     * Thread safe: concurrent calls on distinct ranges are allowed */
+    void evaluate(const struct LEDGeometry &geometry, float time,
+                  uint32_t *out, size_t begin, size_t end) const;
+
+    /* LEDs evaluated at once by each instruction */
+    static constexpr size_t BATCH = 256;
+
+private:
+    enum Op : uint8_t {
+        /* Unary */
+        NEG, NOT, SIN, COS, TAN, ABS, FLOOR, FRACT, SQRT, EXP, LOG, HASH,
+        /* Binary */
+        ADD, SUB, MUL, DIV, MOD, LT, LE, GT, GE, EQ, NE, AND, OR,
+        ATAN2, POW, MIN, MAX, STEP,
+        /* Ternary */
+        SELECT, CLAMP, MIX, SMOOTHSTEP,
+    };
+
+    struct Instr {
+        Op       op;
+        uint16_t dst;
+        uint16_t a, b, c;
+    };
+
+    friend class ShaderCompiler;
+
+    struct Constant {
+        uint16_t reg;
+        float    value;
+    };
+
+    std::vector<Instr> code;
+    /* Broadcast once per evaluation, instructions never write them */
+    std::vector<struct Constant> constants;
+    uint16_t registers = 0;
+    uint16_t outputs[3] = {};
+    bool        valid = false;
+    std::string error;
+};
+
+#endif // __SHADER_H__
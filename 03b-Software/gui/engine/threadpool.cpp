@@ -0,0 +1,160 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <string>
+
+#include "trace.h"
+
+static inline uint64_t packRange(uint32_t lo, uint32_t hi) {
+    return (uint64_t)lo | (uint64_t)hi << 32;
+}
+
+static inline uint32_t rangeLo(uint64_t range) { return range & 0xFFFFFFFF; }
+static inline uint32_t rangeHi(uint64_t range) { return range >> 32; }
+
+ThreadPool::ThreadPool(size_t threads)
+    : nQueues(std::max<size_t>(threads, 1)),
+      queues(new Queue[nQueues]) {
+    /* Queue 0 belongs to the calling thread */
+    for (size_t id = 1; id < nQueues; id++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, id);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::run(size_t chunks, const std::function<void(size_t)> &fn) {
+    if ( ! chunks )
+        return;
+
+    /* Nothing to share: skip the synchronization */
+    if (nQueues == 1 || chunks == 1) {
+        for (size_t chunk = 0; chunk < chunks; chunk++)
+            fn(chunk);
+        return;
+    }
+
+    std::lock_guard<std::mutex> jobLock(jobMutex);
+
+    {
+        /* Workers still stealing from the previous job would overwrite
+         * the new ranges with the ones they took: set up once all are
+         * parked, none joining before the lock is released */
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return active == 0; });
+
+        job.store(&fn, std::memory_order_relaxed);
+        remaining.store(chunks, std::memory_order_relaxed);
+
+        /* Even split, stealing balances the rest */
+        for (size_t id = 0; id < nQueues; id++)
+            queues[id].range.store(packRange(chunks * id / nQueues,
+                                             chunks * (id + 1) / nQueues),
+                                   std::memory_order_release);
+        generation++;
+    }
+    wake.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] {
+        return remaining.load(std::memory_order_acquire) == 0;
+    });
+}
+
+void ThreadPool::workerLoop(size_t id) {
+    uint64_t seen = 0;
+
+    TRACE_THREAD("pool " + std::to_string(id));
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            active++;
+        }
+
+        execute(id);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if ( ! --active )
+            idle.notify_all();
+    }
+}
+
+void ThreadPool::execute(size_t id) {
+    uint32_t chunk;
+
+    for (;;) {
+        while (pop(id, chunk)) {
+            {
+                TRACE_SCOPE("chunk", chunk);
+                /* Read after the pop: a late thread may join the next job */
+                (*job.load(std::memory_order_acquire))(chunk);
+            }
+
+            if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                /* Lock so the notification can't slip between
+                 * the caller's check & its wait */
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+
+        if ( ! steal(id) )
+            return;
+    }
+}
+
+bool ThreadPool::pop(size_t id, uint32_t &chunk) {
+    auto &range = queues[id].range;
+    uint64_t cur = range.load(std::memory_order_acquire);
+
+    while (rangeLo(cur) < rangeHi(cur)) {
+        if (range.compare_exchange_weak(cur, packRange(rangeLo(cur) + 1,
+                                                       rangeHi(cur)),
+                                        std::memory_order_acq_rel)) {
+            chunk = rangeLo(cur);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::steal(size_t id) {
+    for (size_t i = 1; i < nQueues; i++) {
+        auto &victim = queues[(id + i) % nQueues].range;
+        uint64_t cur = victim.load(std::memory_order_acquire);
+
+        while (rangeLo(cur) < rangeHi(cur)) {
+            uint32_t lo  = rangeLo(cur), hi = rangeHi(cur);
+            /* Upper half, at least 1 chunk */
+            uint32_t mid = lo + (hi - lo) / 2;
+
+            if (victim.compare_exchange_weak(cur, packRange(lo, mid),
+                                             std::memory_order_acq_rel)) {
+                queues[id].range.store(packRange(mid, hi),
+                                       std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,66 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Pool running "fn(chunk)" for every chunk of a job, with work stealing:
+ * each thread owns a contiguous range of chunks, takes them from the bottom,
+ * and once empty, steals the upper half of another thread's range.
+ * The calling thread takes part in the job, so a pool of 1 runs inline. */
+class ThreadPool {
+
+public:
+    /* threads: total, calling thread included */
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    size_t size() const { return nQueues; }
+
+    /* Blocks until fn() returned for every chunk of [0;chunks[
+     * Jobs from several threads are serialized */
+    void run(size_t chunks, const std::function<void(size_t)> &fn);
+
+    /* Process wide pool, one thread per core */
+    static ThreadPool& global();
+
+private:
+    /* Range of chunks [lo;hi[ packed as lo | hi << 32, so owner's pop &
+     * thieves' steal are single CAS. Padded to its own cache line. */
+    struct alignas(64) Queue {
+        std::atomic<uint64_t> range { 0 };
+    };
+
+    void workerLoop(size_t id);
+    void execute(size_t id);
+    bool pop(size_t id, uint32_t &chunk);
+    bool steal(size_t id);
+
+    size_t nQueues;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex jobMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::condition_variable idle;
+    uint64_t generation = 0;
+    size_t   active     = 0;    /* Workers in execute()                   */
+    bool     stopping   = false;
+
+    std::atomic<const std::function<void(size_t)> *> job { nullptr };
+    std::atomic<size_t> remaining { 0 };
+};
+
+#endif // __THREADPOOL_H__
@@ -0,0 +1,263 @@
+#include "timeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+#include "colorkernels.h"
+#include "../structure/json.hpp"
+
+static const char *INTERP_NAMES[] = { "step", "rgb", "hsv" };
+
+void Timeline::setLayout(const struct LEDDisplay &display) {
+    nLeds        = display.leds.size();
+    designGroups = display.groups;
+
+    /* Full frames are padded with black/truncated, groups re-resolved */
+    for (auto &kf : keyframes) {
+        if (kf.groups.empty())
+            kf.colors.resize(nLeds, 0);
+    }
+    resolveFrom(0);
+}
+
+struct Timeline::Keyframe& Timeline::insert(double time, TimelineInterp interp) {
+    auto it = std::lower_bound(keyframes.begin(), keyframes.end(), time,
+                               [](const struct Keyframe &kf, double t) {
+                                   return kf.time < t;
+                               });
+
+    if (it == keyframes.end() || it->time != time)
+        it = keyframes.insert(it, Keyframe());
+
+    it->time   = time;
+    it->interp = interp;
+    it->groups.clear();
+    it->h.clear();
+    it->s.clear();
+    it->v.clear();
+    return *it;
+}
+
+void Timeline::addFrame(double time, const uint32_t *colors, size_t n,
+                        TimelineInterp interp) {
+    struct Keyframe &kf = insert(time, interp);
+
+    kf.colors.assign(colors, colors + std::min(n, nLeds));
+    kf.colors.resize(nLeds, 0);
+
+    /* Following group keyframes were based on the previous colors */
+    resolveFrom(&kf - keyframes.data());
+}
+
+void Timeline::addGroups(double time, const GroupColors &groups,
+                         TimelineInterp interp) {
+    struct Keyframe &kf = insert(time, interp);
+
+    kf.groups = groups;
+    resolveFrom(&kf - keyframes.data());
+}
+
+bool Timeline::removeNear(double time, double tolerance) {
+    auto best = keyframes.end();
+
+    for (auto it = keyframes.begin(); it != keyframes.end(); it++) {
+        if (std::fabs(it->time - time) <= tolerance &&
+            (best == keyframes.end() ||
+             std::fabs(it->time - time) < std::fabs(best->time - time)))
+            best = it;
+    }
+
+    if (best == keyframes.end())
+        return false;
+
+    size_t idx = best - keyframes.begin();
+    keyframes.erase(best);
+    resolveFrom(idx);
+    return true;
+}
+
+void Timeline::clear() {
+    keyframes.clear();
+}
+
+double Timeline::getDuration() const {
+    return keyframes.empty() ? 0.0 : keyframes.back().time;
+}
+
+/* Group keyframes depend on the previous one: resolve them in order */
+void Timeline::resolveFrom(size_t idx) {
+    for (size_t i = idx; i < keyframes.size(); i++) {
+        struct Keyframe &kf = keyframes[i];
+
+        if (kf.groups.empty())
+            continue;
+
+        if (i)
+            kf.colors = keyframes[i-1].colors;
+        else
+            kf.colors.assign(nLeds, 0);
+
+        for (const auto &entry : kf.groups) {
+            auto group = std::find_if(designGroups.begin(), designGroups.end(),
+                                      [&](const struct LEDGroup &g) {
+                                          return g.name == entry.first;
+                                      });
+            /* Unknown in this design: ignored, kept for saving */
+            if (group == designGroups.end())
+                continue;
+
+            for (const auto &range : group->ranges) {
+                if (range.start >= nLeds || range.start > range.end)
+                    continue;
+                std::fill(kf.colors.begin() + range.start,
+                          kf.colors.begin() + std::min<size_t>(range.end + 1, nLeds),
+                          entry.second);
+            }
+        }
+
+        kf.h.clear();
+        kf.s.clear();
+        kf.v.clear();
+        kf.w.clear();
+    }
+
+    refreshHsv();
+}
+
+/* HSV planes only for the keyframes on either side of an HSV transition */
+void Timeline::refreshHsv() {
+    for (size_t i = 0; i < keyframes.size(); i++) {
+        struct Keyframe &kf = keyframes[i];
+        bool needed = kf.interp == INTERP_HSV ||
+                      (i + 1 < keyframes.size() &&
+                       keyframes[i+1].interp == INTERP_HSV);
+
+        if ( ! needed ) {
+            kf.h.clear();
+            kf.s.clear();
+            kf.v.clear();
+            kf.w.clear();
+        } else if (kf.h.size() != kf.colors.size()) {
+            kf.h.resize(kf.colors.size());
+            kf.s.resize(kf.colors.size());
+            kf.v.resize(kf.colors.size());
+            kf.w.resize(kf.colors.size());
+            colorsToHsv(kf.colors.data(), kf.h.data(), kf.s.data(),
+                        kf.v.data(), kf.w.data(), kf.colors.size());
+        }
+    }
+}
+
+void Timeline::render(double time, uint32_t *out) const {
+    if (keyframes.empty()) {
+        std::fill(out, out + nLeds, 0);
+        return;
+    }
+
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+                                 [](double t, const struct Keyframe &kf) {
+                                     return t < kf.time;
+                                 });
+
+    /* Before the 1st/after the last keyframe, or holding until the next */
+    if (next == keyframes.begin() || next == keyframes.end() ||
+        next->interp == INTERP_STEP) {
+        const auto &kf = next == keyframes.begin() ? *next : *(next - 1);
+        std::copy(kf.colors.begin(), kf.colors.end(), out);
+        return;
+    }
+
+    const struct Keyframe &a = *(next - 1), &b = *next;
+    const float k = (time - a.time) / (b.time - a.time);
+
+    pipeline.parallelFor(0, nLeds, [&](size_t first, size_t last) {
+        if (b.interp == INTERP_HSV)
+            lerpHsvColors(a.h.data() + first, a.s.data() + first,
+                          a.v.data() + first, a.w.data() + first,
+                          b.h.data() + first, b.s.data() + first,
+                          b.v.data() + first, b.w.data() + first,
+                          out + first, last - first, k);
+        else
+            lerpColors(a.colors.data() + first, b.colors.data() + first,
+                       out + first, last - first, k);
+    });
+}
+
+bool Timeline::save(const std::string &path, std::string &error) const {
+    nlohmann::json json;
+    json["keyframes"] = nlohmann::json::array();
+
+    for (const auto &kf : keyframes) {
+        nlohmann::json jkf;
+
+        jkf["time"]   = kf.time;
+        jkf["interp"] = INTERP_NAMES[kf.interp];
+        if (kf.groups.empty()) {
+            jkf["colors"] = std::vector<uint32_t>(kf.colors.begin(),
+                                                  kf.colors.end());
+        } else {
+            for (const auto &entry : kf.groups)
+                jkf["groups"][entry.first] = entry.second;
+        }
+        json["keyframes"].push_back(jkf);
+    }
+
+    std::ofstream file(path);
+    if ( ! (file && file.is_open()) ) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    file << std::setw(4) << json << std::endl;
+    return true;
+}
+
+bool Timeline::load(const std::string &path, std::string &error) {
+    std::ifstream file(path);
+    nlohmann::json json;
+
+    if ( ! (file && file.is_open()) ) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::vector<struct Keyframe> loaded;
+    try {
+        file >> json;
+
+        for (const auto &jkf : json.at("keyframes")) {
+            struct Keyframe kf;
+            std::string interp = jkf.value("interp", "rgb");
+
+            kf.time   = jkf.at("time").get<double>();
+            kf.interp = INTERP_RGB;
+            for (int i = 0; i < 3; i++)
+                if (interp == INTERP_NAMES[i])
+                    kf.interp = (TimelineInterp)i;
+
+            if (jkf.contains("groups")) {
+                for (const auto &entry : jkf.at("groups").items())
+                    kf.groups.emplace_back(entry.key(),
+                                           entry.value().get<uint32_t>());
+            } else {
+                auto colors = jkf.at("colors").get<std::vector<uint32_t>>();
+                kf.colors.assign(colors.begin(), colors.end());
+                kf.colors.resize(nLeds, 0);
+            }
+            loaded.push_back(std::move(kf));
+        }
+    } catch (nlohmann::detail::exception &e) {
+        error = e.what();
+        return false;
+    }
+
+    std::stable_sort(loaded.begin(), loaded.end(),
+                     [](const struct Keyframe &a, const struct Keyframe &b) {
+                         return a.time < b.time;
+                     });
+    keyframes = std::move(loaded);
+    resolveFrom(0);
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef __TIMELINE_H__
+#define __TIMELINE_H__
+
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pipeline.h"
+#include "../structure/display.h"   /* struct LEDDisplay */
+
+/* How a keyframe is reached from the previous one */
+enum TimelineInterp {
+    INTERP_STEP = 0,
+    INTERP_RGB  = 1,
+    INTERP_HSV  = 2,
+};
+
+/* Keyframes (full frames or groups' colors) at timestamps, interpolated per
+ * LED. Group keyframes only set their groups, the other LEDs keep the
+ * previous keyframe's colors (black for the 1st). Saved as JSON (.timeline) */
+class Timeline {
+
+public:
+    typedef std::vector<std::pair<std::string, uint32_t>> GroupColors;
+
+    /* Number of LEDs & groups to resolve the keyframes with,
+     * to call each time the design changes */
+    void setLayout(const struct LEDDisplay &display);
+    size_t getNumberOfLeds() const { return nLeds; }
+
+    /* Replace any keyframe at the same time [s] */
+    void addFrame(double time, const uint32_t *colors, size_t n,
+                  TimelineInterp interp);
+    void addGroups(double time, const GroupColors &groups,
+                   TimelineInterp interp);
+    /* Remove the keyframe the closest to time, within tolerance [s] */
+    bool removeNear(double time, double tolerance);
+    void clear();
+
+    size_t getNumberOfKeyframes() const { return keyframes.size(); }
+    /* Time of the last keyframe [s] */
+    double getDuration() const;
+
+    /* Colors at time [s] into out[0;getNumberOfLeds()[,
+     * clamped to the 1st/last keyframe */
+    void render(double time, uint32_t *out) const;
+
+    /* @return false on error, with a message in error */
+    bool save(const std::string &path, std::string &error) const;
+    bool load(const std::string &path, std::string &error);
+
+private:
+    struct Keyframe {
+        double         time;
+        TimelineInterp interp;
+        /* Source, group keyframes only */
+        GroupColors    groups;
+        /* Resolved colors & their HSV + W planes (INTERP_HSV) */
+        ColorBuffer        colors;
+        std::vector<float> h, s, v, w;
+    };
+
+    struct Keyframe& insert(double time, TimelineInterp interp);
+    void resolveFrom(size_t idx);
+    void refreshHsv();
+
+    size_t nLeds = 0;
+    std::vector<struct LEDGroup> designGroups;
+    /* Sorted by time */
+    std::vector<struct Keyframe> keyframes;
+
+    FramePipeline pipeline;
+};
+
+#endif // __TIMELINE_H__
@@ -0,0 +1,126 @@
+#include "trace.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "latency.h"
+
+Tracer& Tracer::global() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::start() {
+    started = LatencyStats::clock();
+    /* Rings emptied by their own thread, on their next event */
+    session.fetch_add(1, std::memory_order_relaxed);
+    recording.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() {
+    recording.store(false, std::memory_order_release);
+}
+
+Tracer::Ring& Tracer::ring() {
+    thread_local Ring *mine = nullptr;
+
+    if ( ! mine ) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.push_back(std::make_unique<Ring>());
+        mine = rings.back().get();
+        mine->tid = rings.size();
+    }
+    return *mine;
+}
+
+void Tracer::setThreadName(const std::string &name) {
+    Ring &r = ring();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    r.name = name;
+}
+
+void Tracer::record(char phase, const char *name, uint64_t id) {
+    if ( ! recording.load(std::memory_order_relaxed) )
+        return;
+
+    Ring &r = ring();
+    const uint64_t current = session.load(std::memory_order_relaxed);
+
+    if (r.session.load(std::memory_order_relaxed) != current) {
+        /* Allocated by the threads traced only */
+        if (r.events.empty())
+            r.events.resize(RING_EVENTS);
+        r.head.store(0, std::memory_order_relaxed);
+        r.session.store(current, std::memory_order_release);
+    }
+
+    const uint64_t head = r.head.load(std::memory_order_relaxed);
+    r.events[head & (RING_EVENTS - 1)] = { LatencyStats::clock(), name, id,
+                                           phase };
+    r.head.store(head + 1, std::memory_order_release);
+}
+
+/** **************************************************************************
+ * @brief Every ring of the last recording, oldest events first. Streamed
+ *        rather than built as a JSON document: traces reach millions of
+ *        events. Ends whose begin was overwritten are skipped
+ *************************************************************************** */
+bool Tracer::dump(const std::string &path, std::string &error) const {
+    std::FILE *file = std::fopen(path.c_str(), "w");
+    if ( ! file ) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    const uint64_t current = session.load(std::memory_order_relaxed);
+    const char *sep = "\n";
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &r : rings) {
+        if ( ! r->name.empty() ) {
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\","
+                         "\"pid\":1,\"tid\":%" PRIu32 ",\"args\":"
+                         "{\"name\":\"%s\"}}", sep, r->tid, r->name.c_str());
+            sep = ",\n";
+        }
+
+        if (r->session.load(std::memory_order_acquire) != current)
+            continue;
+
+        const uint64_t head  = r->head.load(std::memory_order_acquire);
+        const uint64_t first = head > RING_EVENTS ? head - RING_EVENTS : 0;
+        size_t depth = 0;
+
+        for (uint64_t i = first; i < head; i++) {
+            const struct TraceEvent &e = r->events[i & (RING_EVENTS - 1)];
+
+            if (e.phase == 'E') {
+                if ( ! depth )
+                    continue;
+                depth--;
+            } else {
+                depth++;
+            }
+
+            std::fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"leds\","
+                         "\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%"
+                         PRIu32, sep, e.name, e.phase,
+                         (e.t > started ? e.t - started : 0) / 1e3, r->tid);
+            if (e.id != NO_ID)
+                std::fprintf(file, ",\"args\":{\"id\":%" PRIu64 "}", e.id);
+            std::fputc('}', file);
+            sep = ",\n";
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+
+    const bool ok = ! std::ferror(file);
+    if (std::fclose(file) != 0 || ! ok) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
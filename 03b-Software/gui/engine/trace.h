@@ -0,0 +1,120 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <atomic>
+#include <cstddef>  /* size_t */
+#include <cstdint>  /* uint[8|16|..]_t */
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Begin/end events of the pipeline's stages (network, parse, apply, effects,
+ * render, ...), written as Chrome's Trace Event JSON: opened as is by
+ * chrome://tracing or ui.perfetto.dev. Each thread records into its own
+ * ring, without any lock: once full, its oldest events are overwritten.
+ *
+ * Trace points (TRACE_* below) compile to nothing unless built with
+ * LEDS_TRACE (cmake -DLEDS_TRACE=ON). Tracer itself is always there, the
+ * tools telling when it has nothing to record (isCompiled()). */
+
+struct TraceEvent {
+    uint64_t    t;              /* LatencyStats::clock() [ns]             */
+    const char *name;           /* String literal, kept as a pointer      */
+    uint64_t    id;             /* Frame's, message's, ... or NO_ID       */
+    char        phase;          /* 'B'egin or 'E'nd                       */
+};
+
+class Tracer {
+
+public:
+    static constexpr size_t   RING_EVENTS = 1u << 16;     /* Per thread   */
+    static constexpr uint64_t NO_ID       = UINT64_MAX;
+
+    /* Process wide, like ThreadPool::global() */
+    static Tracer& global();
+
+    static constexpr bool isCompiled() {
+#if defined(LEDS_TRACE)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    Tracer(const Tracer &) = delete;
+    Tracer& operator=(const Tracer &) = delete;
+
+    /* Events of an earlier recording are discarded */
+    void start();
+    void stop();
+    bool isRecording() const {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    void begin(const char *name, uint64_t id = NO_ID) { record('B', name, id); }
+    void end(const char *name, uint64_t id = NO_ID) { record('E', name, id); }
+    /* Calling thread's name in the trace (copied) */
+    void setThreadName(const std::string &name);
+
+    /* Events of the last recording, once stop()ped
+     * @return false on error, with a message in error */
+    bool dump(const std::string &path, std::string &error) const;
+
+private:
+    /* Written by its thread only: head published once the event is */
+    struct Ring {
+        uint32_t    tid;
+        std::string name;
+        std::atomic<uint64_t> session { 0 };
+        std::atomic<uint64_t> head { 0 };
+        std::vector<struct TraceEvent> events;
+    };
+
+    Tracer() = default;
+
+    void record(char phase, const char *name, uint64_t id);
+    /* Calling thread's, created on its 1st event */
+    Ring& ring();
+
+    std::atomic<bool>     recording { false };
+    std::atomic<uint64_t> session { 0 };
+    uint64_t              started = 0;
+
+    mutable std::mutex mutex;   /* Rings' list                            */
+    std::vector<std::unique_ptr<Ring>> rings;
+};
+
+/* Begin & end of the enclosing block */
+class TraceScope {
+
+public:
+    TraceScope(const char *name, uint64_t id = Tracer::NO_ID)
+        : name(name), id(id) { Tracer::global().begin(name, id); }
+    ~TraceScope() { Tracer::global().end(name, id); }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope& operator=(const TraceScope &) = delete;
+
+private:
+    const char *name;
+    uint64_t    id;
+};
+
+#if defined(LEDS_TRACE)
+#define TRACE_CONCAT_(a, b)     a##b
+#define TRACE_CONCAT(a, b)      TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name, id)   \
+    TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, id)
+#define TRACE_BEGIN(name, id)   Tracer::global().begin(name, id)
+#define TRACE_END(name, id)     Tracer::global().end(name, id)
+#define TRACE_THREAD(name)      Tracer::global().setThreadName(name)
+#else
+/* Arguments not even evaluated */
+#define TRACE_SCOPE(name, id)   do {} while (0)
+#define TRACE_BEGIN(name, id)   do {} while (0)
+#define TRACE_END(name, id)     do {} while (0)
+#define TRACE_THREAD(name)      do {} while (0)
+#endif
+
+#endif // __TRACE_H__
@@ -0,0 +1,463 @@
+/* ************************************************************************** *
+ * ***             HEADLESS DISPLAY SERVER, NO WINDOW NEEDED              *** *
+ * ************************************************************************** *
+ * usage: ledserver [options] <design.disp|design.dispb>
+ *
+ * Same protocol as the GUI's server (see 01-Doc/protocol/protocol.md), for
+ * soak tests & machines without a display: every client's command is applied
+ * to the design like the GUI does, minus the widgets. Several clients can be
+ * connected at once. Optionally renders the LEDs offscreen at an interval.
+ *
+ * The stats counters are printed as "key=value" lines: every -s seconds, on
+ * SIGUSR1 & when leaving (SIGINT/SIGTERM or -d elapsed). -c captures every
+ * message received, timestamped when read from its socket (see
+ * engine/capture.h), without ever waiting for the disk. Every frame is timed
+ * from its 1st byte read to its render (see engine/latency.h): percentiles
+ * are part of the stats, -l writes the whole histograms. -T traces every
+ * stage, on every thread, until leaving (see engine/trace.h).                */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../engine/capture.h"
+#include "../engine/protocol.h"
+#include "../engine/raster.h"
+#include "../engine/server.h"
+#include "../engine/trace.h"
+
+/* Like the GUI's defaults */
+#define DEFAULT_PORT        "5000"
+#define EFFECTS_FPS         60
+#define RX_CHUNK            (64 * 1024)
+/* Answers kept for a client not reading them, dropped past it */
+#define TX_MAX              (4 * 1024 * 1024)
+
+typedef std::chrono::steady_clock Clock;
+
+struct Client {
+    int fd;
+    uint32_t id;                /* Accepted # of the connection           */
+    MessageReader reader;
+    /* When the message not complete yet started to arrive */
+    uint64_t partialSince;
+    /* Answers not written yet, the socket being full */
+    std::vector<uint8_t> tx;
+};
+
+static volatile sig_atomic_t running   = 1;
+static volatile sig_atomic_t dumpStats = 0;
+
+static void onSignal(int sig) {
+    if (sig == SIGUSR1)
+        dumpStats = 1;
+    else
+        running = 0;
+}
+
+static void usage(const char *name) {
+    std::fprintf(stderr,
+        "usage: %s [options] <design.disp|design.dispb>\n"
+        "\t-a ADDR : Listening address (default: any)\n"
+        "\t-p PORT : Listening port (default: " DEFAULT_PORT ")\n"
+        "\t-t TYPE : LED type of chains without one (default: %s)\n"
+        "\t-b MA   : Power supply's budget [mA], 0 = no limit (default)\n"
+        "\t-f MODE : Frames faster than the chains: none, flag or throttle "
+        "(default: none)\n"
+        "\t-r MS   : Render offscreen every MS ms (default: never)\n"
+        "\t-w PX   : Offscreen image's width (default: 800)\n"
+        "\t-o FILE : Write each offscreen render as a PPM image\n"
+        "\t-s SEC  : Print the stats every SEC s (default: never)\n"
+        "\t-d SEC  : Leave after SEC s (default: never)\n"
+        "\t-c FILE : Capture the clients' streams (.ledc)\n"
+        "\t-m MODE : Capture's frames, raw or decoded (default: raw)\n"
+        "\t-l FILE : Write the frames' latency histograms (JSON) with the "
+        "stats\n"
+        "\t-T FILE : Trace the stages until leaving (Chrome's JSON), built "
+        "with LEDS_TRACE\n",
+        name, LED_TYPES[0].name);
+    std::exit(EXIT_FAILURE);
+}
+
+/** **************************************************************************
+ * @brief Listening socket on addr:port (addr nullptr: any, IPv4 & IPv6)
+ * @return The socket, -1 on failure (message printed)
+ *************************************************************************** */
+static int listenOn(const char *addr, const char *port) {
+    struct addrinfo hints = {}, *res, *ai;
+    int fd = -1, one = 1, rc;
+
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
+
+    if ((rc = getaddrinfo(addr, port, &hints, &res))) {
+        std::fprintf(stderr, "SVR: %s:%s: %s\n", addr ? addr : "*", port,
+                     gai_strerror(rc));
+        return -1;
+    }
+
+    /* IPv6 1st: also accepts IPv4 where dual stack */
+    for (int pass = 0; pass < 2 && fd < 0; pass++) {
+        for (ai = res; ai && fd < 0; ai = ai->ai_next) {
+            if ((ai->ai_family == AF_INET6) != ( ! pass ))
+                continue;
+
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0)
+                continue;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ai->ai_addr, ai->ai_addrlen) < 0 ||
+                listen(fd, SOMAXCONN) < 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    freeaddrinfo(res);
+
+    if (fd < 0)
+        std::perror("SVR: Cannot listen");
+    else
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/* Write what the socket takes, keep the rest for POLLOUT
+ * @return false if the connection is broken */
+static bool flushClient(struct Client &clt) {
+    TRACE_SCOPE("send", clt.id);
+
+    while ( ! clt.tx.empty() ) {
+        ssize_t n = send(clt.fd, clt.tx.data(), clt.tx.size(), MSG_NOSIGNAL);
+
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        clt.tx.erase(clt.tx.begin(), clt.tx.begin() + n);
+    }
+    return true;
+}
+
+/* Answers left past TX_MAX once flushed: the client doesn't read them
+ * @return true if the client is to be dropped */
+static bool overflowed(const struct Client &clt) {
+    if (clt.tx.size() <= TX_MAX)
+        return false;
+
+    std::fprintf(stderr, "SVR: Client %" PRIu32 " dropped, %zu bytes of "
+                 "answers not read\n", clt.id, clt.tx.size());
+    return true;
+}
+
+static void printStats(const DisplayServer &server,
+                       const CaptureWriter &capture, size_t clients,
+                       uint64_t accepted, uint64_t renders,
+                       double renderMs, double now, const char *latencyPath) {
+    std::printf("SVR: t=%.3f clients=%zu accepted=%" PRIu64 " %s"
+                " renders=%" PRIu64 " render_ms=%.3f %s", now, clients,
+                accepted, server.describeStats().c_str(), renders,
+                renders ? renderMs / renders : 0.0,
+                server.getLatency().describeStats().c_str());
+
+    if (capture.isOpen()) {
+        const struct CaptureStats stats = capture.getStats();
+        std::printf(" capture_records=%" PRIu64 " capture_bytes=%" PRIu64
+                    " capture_dropped=%" PRIu64 " capture_blocks=%" PRIu64,
+                    stats.records, stats.bytes, stats.dropped,
+                    stats.blocksWritten);
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+
+    std::string error;
+    if (latencyPath && ! server.getLatency().dump(latencyPath, error))
+        std::fprintf(stderr, "SVR: %s\n", error.c_str());
+}
+
+/** **************************************************************************
+ * @brief Main application function
+ *************************************************************************** */
+int main(int argc, char **argv) {
+    const char *addr = nullptr, *port = DEFAULT_PORT, *imagePath = nullptr;
+    const char *capturePath = nullptr, *latencyPath = nullptr;
+    const char *tracePath = nullptr;
+    enum CaptureMode captureMode = CAPTURE_RAW;
+    enum RefreshPolicy policy = REFRESH_NO_LIMIT;
+    std::string ledType = LED_TYPES[0].name;
+    double budgetMa = 0.0, statsPeriod = 0.0, duration = 0.0;
+    int renderMs = 0, opt;
+    size_t imageWidth = 800;
+
+    while ((opt = getopt(argc, argv, "a:p:t:b:f:r:w:o:s:d:c:m:l:T:")) != -1) {
+        switch (opt) {
+        case 'a': addr        = optarg;                         break;
+        case 'p': port        = optarg;                         break;
+        case 't': ledType     = optarg;                         break;
+        case 'b': budgetMa    = std::atof(optarg);              break;
+        case 'r': renderMs    = std::atoi(optarg);              break;
+        case 'w': imageWidth  = std::strtoul(optarg, nullptr, 0); break;
+        case 'o': imagePath   = optarg;                         break;
+        case 's': statsPeriod = std::atof(optarg);              break;
+        case 'd': duration    = std::atof(optarg);              break;
+        case 'c': capturePath = optarg;                         break;
+        case 'l': latencyPath = optarg;                         break;
+        case 'T': tracePath   = optarg;                         break;
+        case 'm':
+            if (std::string(optarg) == "decoded")
+                captureMode = CAPTURE_DECODED;
+            else if (std::string(optarg) != "raw")
+                usage(argv[0]);
+            break;
+        case 'f':
+            if (std::string(optarg) == "flag")
+                policy = REFRESH_FLAG;
+            else if (std::string(optarg) == "throttle")
+                policy = REFRESH_THROTTLE;
+            else if (std::string(optarg) != "none")
+                usage(argv[0]);
+            break;
+        default:  usage(argv[0]);
+        }
+    }
+    if (argc - optind != 1 || renderMs < 0 || ! imageWidth)
+        usage(argv[0]);
+    if (tracePath && ! Tracer::isCompiled()) {
+        std::fprintf(stderr, "SVR: built without tracing, see LEDS_TRACE\n");
+        return EXIT_FAILURE;
+    }
+
+    struct LEDDisplay display;
+    std::string error;
+    if ( ! loadDisplay(display, argv[optind], error) ) {
+        std::fprintf(stderr, "SVR: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    DisplayServer server;
+    server.setDisplay(display, findLedType(ledType));
+    server.setPowerBudget(budgetMa);
+    server.setRefreshPolicy(policy, 0.0);
+
+    Rasterizer raster;
+    if (renderMs)
+        raster.setLayout(display, imageWidth);
+
+    CaptureWriter capture;
+    if (capturePath && ! capture.open(capturePath, captureMode,
+                                      display.leds.size(), error) ) {
+        std::fprintf(stderr, "SVR: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    int listenFd = listenOn(addr, port);
+    if (listenFd < 0)
+        return EXIT_FAILURE;
+
+    std::signal(SIGINT,  onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGUSR1, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    TRACE_THREAD("server");
+    if (tracePath)
+        Tracer::global().start();
+
+    std::printf("SVR: %s, %zu LEDs, listening on %s:%s\n", argv[optind],
+                server.getNumberOfLeds(), addr ? addr : "*", port);
+    std::fflush(stdout);
+
+    const auto start = Clock::now();
+    auto elapsed = [&start]() {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    std::vector<struct Client> clients;
+    std::vector<struct pollfd> fds;
+    std::vector<uint8_t> rx(RX_CHUNK);
+    uint64_t accepted = 0, renders = 0;
+    double renderTotalMs = 0.0;
+    double nextEffects = 0.0, nextRender = 0.0, nextStats = statsPeriod;
+
+    while (running && ( ! duration || elapsed() < duration )) {
+        double now = elapsed();
+
+        /* Timers: frame held back, effects, offscreen render, stats, end */
+        double wake = duration ? duration : now + 1.0;
+        if (server.hasPendingFrame())
+            wake = std::min(wake, server.getRefresh().getNextSlot());
+        if (server.effectsRunning())
+            wake = std::min(wake, nextEffects);
+        if (renderMs)
+            wake = std::min(wake, nextRender);
+        if (statsPeriod > 0.0)
+            wake = std::min(wake, nextStats);
+
+        fds.clear();
+        fds.push_back({ listenFd, POLLIN, 0 });
+        for (const auto &clt : clients)
+            fds.push_back({ clt.fd, short(POLLIN |
+                                          (clt.tx.empty() ? 0 : POLLOUT)), 0 });
+
+        int timeoutMs = std::max(0.0, std::ceil((wake - now) * 1000));
+        if (poll(fds.data(), fds.size(), timeoutMs) < 0 && errno != EINTR) {
+            std::perror("SVR: poll");
+            break;
+        }
+        now = elapsed();
+
+        /* New clients, acknowledged right away, polled from next loop */
+        const size_t polled = clients.size();
+        if (fds[0].revents & POLLIN) {
+            int fd, one = 1;
+            while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+                struct Client clt = { fd, (uint32_t)accepted, {}, 0, {} };
+                capture.connected(CaptureWriter::clock(), clt.id);
+                server.greet(clt.tx);
+                flushClient(clt);
+                clients.push_back(std::move(clt));
+                accepted++;
+            }
+        }
+
+        /* Requests, answers written once all of them are handled */
+        for (size_t i = 0; i < clients.size(); i++) {
+            struct Client &clt = clients[i];
+            short revents = i < polled ? fds[i + 1].revents : 0;
+            bool alive = true;
+
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t n;
+                for (;;) {
+                    {
+                        TRACE_SCOPE("recv", clt.id);
+                        n = recv(clt.fd, rx.data(), rx.size(), 0);
+                    }
+                    if (n <= 0)
+                        break;
+
+                    const uint64_t received = CaptureWriter::clock();
+                    /* The 1st message may have started in earlier reads */
+                    uint64_t read = clt.reader.hasPartial() ? clt.partialSince
+                                                            : received;
+                    clt.reader.feed(rx.data(), n);
+
+                    const uint8_t *msg;
+                    size_t len;
+                    while (alive && clt.reader.next(msg, len)) {
+                        capture.message(received, clt.id, msg, len);
+                        alive = server.handle(msg, len, now, clt.tx, read);
+                        read  = received;
+
+                        /* Nothing rendered: shown once applied */
+                        if ( ! renderMs && server.getLatency().hasPending() ) {
+                            const uint64_t t = LatencyStats::clock();
+                            server.getLatency().presented(t, t);
+                        }
+                    }
+                    clt.partialSince = read;
+                    /* Written as they come once past the cap */
+                    if (alive && clt.tx.size() > TX_MAX)
+                        alive = flushClient(clt) && ! overflowed(clt);
+                    if ( ! alive || clt.reader.isBroken() )
+                        break;
+                }
+                if (n == 0 || (n < 0 && errno != EAGAIN &&
+                               errno != EWOULDBLOCK && errno != EINTR) ||
+                    clt.reader.isBroken())
+                    alive = false;
+            }
+
+            if (alive)
+                alive = flushClient(clt) && ! overflowed(clt);
+            if ( ! alive ) {
+                capture.disconnected(CaptureWriter::clock(), clt.id);
+                close(clt.fd);
+                clt.fd = -1;
+            }
+        }
+        clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                     [](const struct Client &clt) {
+                                         return clt.fd < 0;
+                                     }), clients.end());
+
+        /* Nothing rendered: shown once applied */
+        if (server.hasPendingFrame() && server.flushPendingFrame(now) &&
+            ! renderMs && server.getLatency().hasPending()) {
+            const uint64_t t = LatencyStats::clock();
+            server.getLatency().presented(t, t);
+        }
+
+        if (server.effectsRunning() && now >= nextEffects) {
+            server.renderEffects(now);
+            nextEffects = now + 1.0 / EFFECTS_FPS;
+        }
+
+        if (renderMs && now >= nextRender) {
+            const uint64_t t0 = LatencyStats::clock();
+            TRACE_BEGIN("render", renders + 1);
+            raster.render(server.getFrame().data(), server.getBrightness());
+            TRACE_END("render", renders + 1);
+            const uint64_t t1 = LatencyStats::clock();
+            server.getLatency().presented(t0, t1);
+            renderTotalMs += (t1 - t0) / 1e6;
+            renders++;
+            nextRender = now + renderMs / 1000.0;
+
+            if (imagePath && ! raster.savePpm(imagePath, error)) {
+                std::fprintf(stderr, "SVR: %s\n", error.c_str());
+                imagePath = nullptr;
+            }
+        }
+
+        capture.tick(CaptureWriter::clock());
+
+        if ((statsPeriod > 0.0 && now >= nextStats) || dumpStats) {
+            printStats(server, capture, clients.size(), accepted, renders,
+                       renderTotalMs, now, latencyPath);
+            if (statsPeriod > 0.0 && now >= nextStats)
+                nextStats += statsPeriod;
+            dumpStats = 0;
+        }
+    }
+
+    /* Clients told, like the GUI's "Stop server" */
+    for (auto &clt : clients) {
+        encodeLeaveShutdown(clt.tx);
+        flushClient(clt);
+        capture.disconnected(CaptureWriter::clock(), clt.id);
+        close(clt.fd);
+    }
+    close(listenFd);
+
+    printStats(server, capture, 0, accepted, renders, renderTotalMs,
+               elapsed(), latencyPath);
+
+    Tracer::global().stop();
+    if (tracePath && ! Tracer::global().dump(tracePath, error)) {
+        std::fprintf(stderr, "SVR: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if ( ! capture.close() ) {
+        std::fprintf(stderr, "SVR: cannot write %s\n", capturePath);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
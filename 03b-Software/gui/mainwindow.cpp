@@ -1,9 +1,15 @@
 #include "mainwindow.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QCheckBox>
+#include <QColorDialog>
 #include <QComboBox>
+#include <QFileDialog>
+#include <QInputDialog>
 #include <QLabel>
 #include <QLineEdit>
 #include <QMenuBar>
@@ -14,17 +20,29 @@
 #include <QSpacerItem>
 #include <QTextEdit>
 
-#include "structure/display.h"
+#include "displaydialog.h"
+#include "engine/color.h"      /* packColor() */
 
-#include "../protocol_src/protocol_routing_variables.h"
+#define EFFECTS_FPS         60
+#define TIMELINE_FPS        60
+/* Timeline's slider resolution & minimal length */
+#define TIMELINE_STEP_MS    10
+#define TIMELINE_MIN_LEN_S  10
+/* Period of the refresh's label update [ms] */
+#define REFRESH_INFO_MS     250
+#define MM_PER_INCH         25.4
 
-#define HEXA_16BITS_NDIGITS  2*sizeof(uint16_t)
-#define HEXA_32BITS_NDIGITS  2*sizeof(uint32_t)
-#define NUMERICAL_BASE_16   16
-#define TO_UINT8(DIGIT) (DIGIT) - '0'
+/* Frame rate of the animations exported to the firmware */
+#define RECORD_FPS          30
+/* Period of the capture's flush of records waiting, idle streams included */
+#define CAPTURE_TICK_MS     250
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
+    TRACE_THREAD("gui");
+
     display = new DynamicDisplay;
+    display->setLatency(&server.getLatency());
+    display->setStreamStats(&streamStats);
 
     display->setSceneRect(0, 0, 5000, 5000);
     display->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
@@ -34,6 +52,40 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     createMenus();
     createLayouts();
 
+    serverClock.start();
+    effectsTimer = new QTimer(this);
+    effectsTimer->setTimerType(Qt::PreciseTimer);
+    effectsTimer->setInterval(1000 / EFFECTS_FPS);
+    connect(effectsTimer, &QTimer::timeout, this, &MainWindow::renderEffects);
+
+    /* Position is read from timelineClock, the timer only paces frames */
+    timelineTimer = new QTimer(this);
+    timelineTimer->setTimerType(Qt::PreciseTimer);
+    timelineTimer->setInterval(1000 / TIMELINE_FPS);
+    connect(timelineTimer, &QTimer::timeout,
+            this, &MainWindow::renderTimeline);
+
+    /* Whatever is shown (stream, effects, timeline) is sampled */
+    recordTimer = new QTimer(this);
+    recordTimer->setTimerType(Qt::PreciseTimer);
+    recordTimer->setInterval(1000 / RECORD_FPS);
+    connect(recordTimer, &QTimer::timeout, this, &MainWindow::recordFrame);
+
+    captureTimer = new QTimer(this);
+    captureTimer->setInterval(CAPTURE_TICK_MS);
+    connect(captureTimer, &QTimer::timeout, this, [this]() {
+        capture.tick(CaptureWriter::clock());
+    });
+
+    refreshInfoClock.start();
+    powerInfoClock.start();
+    refreshTimer = new QTimer(this);
+    refreshTimer->setTimerType(Qt::PreciseTimer);
+    refreshTimer->setSingleShot(true);
+    connect(refreshTimer, &QTimer::timeout,
+            this, &MainWindow::flushPendingFrame);
+    configureRefresh();
+
     QWidget *widget = new QWidget();
     widget->setLayout(mainVLayout);
     setCentralWidget(widget);
@@ -65,6 +117,9 @@ void MainWindow::loadDesign() {
 
     display->setDisplay(tmp);
     display->updateScene();
+
+    layoutTimeline();
+    configureRefresh();
 }
 
 /* *** Design actions ****************************************************** */
@@ -74,6 +129,8 @@ void MainWindow::undoAction() {
 
 void MainWindow::emptyDesign() {
     display->clearScene();
+    layoutTimeline();
+    configureRefresh();
 
     setWindowTitle(QString("LEDs Display Creator"));
 }
@@ -85,11 +142,579 @@ void MainWindow::infoLedsCount() {
             QString("# of LEDs: %1").arg(display->getNumberOfLeds()) );
 }
 
+/* Package's side [mm], from its name: "5050" is 5.0 x 5.0 mm */
+static double packageFootprintMm(const QString &package) {
+    return package.left(2).toDouble() / 10.0;
+}
+
 void MainWindow::infoSizeIrl() {
-    /* TODO */
+    const bool   inch = ledPkgUnitDrpDn->currentIndex() == 1;
+    const double unit = inch ? MM_PER_INCH : 1.0;
+    const char  *name = inch ? "inch" : "mm";
+    const struct PhysicalSize size =
+        physicalSize(display->getExtent(),
+                     packageFootprintMm(ledPkgDrpDn->currentText()));
+
+    if ( ! display->getNumberOfLeds() ) {
+        if (logsTxtBox->isEnabled())
+            logsTxtBox->append("Size IRL: no LEDs");
+        return;
+    }
+
+    QString text = QString("Size IRL (%1 packages): %2 x %3 %4\n"
+                           "Density: %5 LEDs/m², strip of %6 %4 in index order\n")
+                       .arg(ledPkgDrpDn->currentText())
+                       .arg(size.width / unit, 0, 'f', 1)
+                       .arg(size.height / unit, 0, 'f', 1)
+                       .arg(name)
+                       .arg(size.density, 0, 'f', 0)
+                       .arg(size.stripLength / unit, 0, 'f', 1);
+
+    /* Read from the extent: the refresh & power stats aren't reset */
+    const DesignExtent &extent = display->getExtent();
+    for (size_t c = 0; c < extent.getNumberOfChains(); c++) {
+        const struct ChainExtent &chain = extent.getChain(c);
+        double length = chain.stripLength * size.scale;
+
+        text += QString("Chain \"%1\": %2 %3, %4 LEDs/m\n")
+                    .arg(QString::fromStdString(chain.name))
+                    .arg(length / unit, 0, 'f', 1).arg(name)
+                    .arg(length > 0.0 ? chain.leds / (length / 1000) : 0.0,
+                         0, 'f', 1);
+    }
+
+    if (logsTxtBox->isEnabled())
+        logsTxtBox->append(text);
+    QMessageBox::information(this, tr("Size IRL"), text);
+}
+
+void MainWindow::infoChains() {
+    bool ok = false;
+    double fps = QInputDialog::getDouble(this, tr("Chains"), tr("Target FPS:"),
+                                         EFFECTS_FPS, 1, 1000, 1, &ok);
+    if ( ! ok )
+        return;
+
+    QString text = QString::fromStdString(server.getChains().describe(fps));
+    if (logsTxtBox->isEnabled())
+        logsTxtBox->append(text);
+    QMessageBox::information(this, tr("Chains"), text);
+}
+
+void MainWindow::exportChains() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export chains"),
+                                                    QDir::currentPath(),
+                                                    tr("C header (*.h)"));
+    std::string error;
+
+    if ( filename.isNull() ) {
+        return;
+    }
+
+    /* Whatever is shown, stream or local effects, on the current design */
+    layoutServer();
+
+    if ( ! server.getChains().exportHeader(filename.toStdString(), error) )
+        QMessageBox::warning(this, tr("Export chains"),
+                             QString::fromStdString(error));
+}
+
+/* *** Effects actions ***************************************************** */
+void MainWindow::loadShader() {
+    QString filename = QFileDialog::getOpenFileName(this, tr("Open shader"),
+                                                    QDir::currentPath()+"/../../shaders/",
+                                                    tr("Shader file (*.shader)"));
+    if ( filename.isNull() ) {
+        return;
+    }
+
+    QFile file(filename);
+    if ( ! file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
+        return;
+    }
+
+    std::string error;
+    layoutServer();
+
+    /* Local shaders always run in the 1st slot, on the whole design */
+    EffectsEngine &effects = server.getEffects();
+    if ( ! effects.loadShader(0, file.readAll().toStdString(), error) ) {
+        QMessageBox::warning(this, tr("Shader"),
+                             tr("Compilation failed at %1")
+                                 .arg(QString::fromStdString(error)));
+        return;
+    }
+
+    struct protocol_effect cmd = {};
+    cmd.slot   = 0;
+    cmd.effect = EFFECT_SHADER;
+    cmd.group  = EFFECT_ALL_LEDS;
+    effects.apply(cmd, serverClock.nsecsElapsed() / 1e9);
+
+    if ( ! effectsTimer->isActive() )
+        effectsTimer->start();
+}
+
+void MainWindow::stopEffects() {
+    server.getEffects().stopAll();
+}
+
+/* *** Timeline ************************************************************ */
+void MainWindow::playTimeline() {
+    if (timelineTimer->isActive()) {
+        timelineTimer->stop();
+        timelinePlayBtn->setText("Play");
+        return;
+    }
+
+    if ( ! timeline.getNumberOfKeyframes() )
+        return;
+
+    /* Restart from the beginning once the end has been reached */
+    if (timelinePos >= timeline.getDuration())
+        timelinePos = 0.0;
+
+    timelineStartPos = timelinePos;
+    timelineClock.start();
+    timelineTimer->start();
+    timelinePlayBtn->setText("Pause");
+}
+
+/* Keyframes are kept, full frames padded/truncated & groups re-resolved */
+void MainWindow::layoutTimeline(void) {
+    if (timelineGeneration == display->getGeneration())
+        return;
+
+    timeline.setLayout(display->getDisplay());
+    timelineGeneration = display->getGeneration();
+}
+
+void MainWindow::renderTimeline() {
+    const size_t n = display->getNumberOfLeds();
+
+    layoutTimeline();
+
+    /* Position from the clock, not from the # of ticks: no drift */
+    if (timelineTimer->isActive()) {
+        timelinePos = timelineStartPos + timelineClock.nsecsElapsed() / 1e9;
+
+        /* Loop */
+        if (timelinePos > timeline.getDuration()) {
+            timelinePos      = 0.0;
+            timelineStartPos = 0.0;
+            timelineClock.restart();
+        }
+    }
+
+    {
+        /* Don't scrub back when following the playback */
+        QSignalBlocker blocker(timelineSlider);
+        timelineSlider->setValue(timelinePos * 1000 / TIMELINE_STEP_MS);
+    }
+    timelineLbl->setText(QString("%1 s | %2 keys").arg(timelinePos, 7, 'f', 2)
+                             .arg(timeline.getNumberOfKeyframes()));
+
+    if ( ! n || ! timeline.getNumberOfKeyframes() )
+        return;
+
+    timelineFrame.resize(n);
+    timeline.render(timelinePos, timelineFrame.data());
+    layoutServer();
+    server.setColors(timelineFrame.data(), n);
+    showFrame();
+}
+
+void MainWindow::scrubTimeline(int value) {
+    timelinePos = value * TIMELINE_STEP_MS / 1000.0;
+
+    /* Keep playing from the new position */
+    if (timelineTimer->isActive()) {
+        timelineStartPos = timelinePos;
+        timelineClock.restart();
+    }
+
+    renderTimeline();
+}
+
+/* Keep room after the last keyframe to add the next ones */
+static void resizeTimelineSlider(QSlider *slider, double duration) {
+    double length = std::max<double>(duration * 1.5, TIMELINE_MIN_LEN_S);
+    slider->setMaximum(length * 1000 / TIMELINE_STEP_MS);
+}
+
+void MainWindow::addKeyframe() {
+    const size_t n = display->getNumberOfLeds();
+    std::vector<uint32_t> colors(n);
+
+    layoutTimeline();
+
+    display->getLedsColor(colors.data());
+    timeline.addFrame(timelinePos, colors.data(), n,
+                      (TimelineInterp)timelineInterpDrpDn->currentData().toInt());
+    resizeTimelineSlider(timelineSlider, timeline.getDuration());
+
+    if (logsTxtBox->isEnabled())
+        logsTxtBox->append(QString("Keyframe added at %1 s (%2)")
+                               .arg(timelinePos).arg(timelineInterpDrpDn->currentText()));
+    renderTimeline();
+}
+
+/* A single group set to a color, the other LEDs keep the previous
+ * keyframe's colors */
+void MainWindow::addGroupKeyframe() {
+    const auto &groups = display->getDisplay().groups;
+    QStringList names;
+    bool ok = false;
+
+    if (groups.empty()) {
+        QMessageBox::information(this, tr("Group keyframe"),
+                                 tr("The design has no group"));
+        return;
+    }
+
+    for (const auto &group : groups)
+        names << QString::fromStdString(group.name);
+    QString name = QInputDialog::getItem(this, tr("Group keyframe"),
+                                         tr("Group:"), names, 0, false, &ok);
+    if ( ! ok )
+        return;
+
+    QColor color = QColorDialog::getColor(Qt::white, this,
+                                          tr("Group keyframe"));
+    if ( ! color.isValid() )
+        return;
+
+    layoutTimeline();
+
+    timeline.addGroups(timelinePos, { { name.toStdString(),
+                                        packColor(color.red(), color.green(),
+                                                  color.blue()) } },
+                       (TimelineInterp)timelineInterpDrpDn->currentData().toInt());
+    resizeTimelineSlider(timelineSlider, timeline.getDuration());
+
+    if (logsTxtBox->isEnabled())
+        logsTxtBox->append(QString("Keyframe of group %1 added at %2 s (%3)")
+                               .arg(name).arg(timelinePos)
+                               .arg(timelineInterpDrpDn->currentText()));
+    renderTimeline();
+}
+
+void MainWindow::removeKeyframe() {
+    /* Within a few slider's steps, as the cursor is hardly exactly on it */
+    if (timeline.removeNear(timelinePos, 5 * TIMELINE_STEP_MS / 1000.0))
+        renderTimeline();
+}
+
+void MainWindow::saveTimeline() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save timeline"),
+                                                    QDir::currentPath(),
+                                                    tr("Timeline file (*.timeline)"));
+    std::string error;
+
+    if ( filename.isNull() ) {
+        return;
+    }
+
+    if ( ! timeline.save(filename.toStdString(), error) )
+        QMessageBox::warning(this, tr("Timeline"),
+                             QString::fromStdString(error));
+}
+
+void MainWindow::loadTimeline() {
+    QString filename = QFileDialog::getOpenFileName(this, tr("Open timeline"),
+                                                    QDir::currentPath(),
+                                                    tr("Timeline file (*.timeline)"));
+    std::string error;
+
+    if ( filename.isNull() ) {
+        return;
+    }
+
+    layoutTimeline();
+    if ( ! timeline.load(filename.toStdString(), error) ) {
+        QMessageBox::warning(this, tr("Timeline"),
+                             QString::fromStdString(error));
+        return;
+    }
+
+    timelinePos = 0.0;
+    resizeTimelineSlider(timelineSlider, timeline.getDuration());
+    renderTimeline();
+}
+
+/* *** Hardware's refresh rate ********************************************* */
+/** **************************************************************************
+ * @brief Lay the server out on the design, its colors kept: chains refreshed
+ *        in parallel, the whole design being 1 chain of the selected LED
+ *        type when it has none
+ *        While throttling, local effects & timeline are capped as well
+ *************************************************************************** */
+void MainWindow::configureRefresh() {
+    const size_t n = display->getNumberOfLeds();
+    std::vector<uint32_t> colors(n);
+
+    display->getLedsColor(colors.data());
+    server.setDisplay(display->getDisplay(),
+                      findLedType(ledTypeDrpDn->currentText().toStdString()));
+    server.setColors(colors.data(), n);
+    serverGeneration = display->getGeneration();
+
+    /* Not throttling anymore: the frame held back is shown by the server */
+    server.setRefreshPolicy((enum RefreshPolicy)refreshDrpDn->currentIndex(),
+                            serverClock.nsecsElapsed() / 1e9);
+
+    int minPeriodMs = 0;
+    if (server.getRefreshPolicy() == REFRESH_THROTTLE)
+        minPeriodMs = std::ceil(server.getRefresh().getFrameTime() * 1000);
+    else
+        refreshTimer->stop();
+    effectsTimer->setInterval(std::max(1000 / EFFECTS_FPS, minPeriodMs));
+    timelineTimer->setInterval(std::max(1000 / TIMELINE_FPS, minPeriodMs));
+
+    configurePower();
+    updateRefreshInfo(true);
+}
+
+/** **************************************************************************
+ * @brief Lay the server out again once the design changed: a LED removed
+ *        then another added keeps the count, not the geometry
+ *************************************************************************** */
+void MainWindow::layoutServer() {
+    if (serverGeneration != display->getGeneration())
+        configureRefresh();
+}
+
+void MainWindow::updateRefreshInfo(bool force) {
+    /* Not on every frame, text layout is costly */
+    if ( ! force && refreshInfoClock.elapsed() < REFRESH_INFO_MS )
+        return;
+    refreshInfoClock.restart();
+
+    const RefreshModel &refresh = server.getRefresh();
+    QString text = QString("Max %1 FPS").arg(refresh.getMaxFps(), 0, 'f', 1);
+    bool tooFast = refresh.getIncomingFps() > refresh.getMaxFps();
+
+    if (refresh.getNumberOfFrames() > 1)
+        text += QString(" | In %1 FPS, %2 too fast")
+                    .arg(refresh.getIncomingFps(), 0, 'f', 1)
+                    .arg(refresh.getNumberOfTooFast());
+
+    refreshLbl->setText(text);
+    refreshLbl->setStyleSheet(tooFast && server.getRefreshPolicy() !=
+                              REFRESH_NO_LIMIT ? "color: red" : "");
+}
+
+/* *** Power budget ******************************************************** */
+/** **************************************************************************
+ * @brief Current drawn by the selected LED type, the chains' own types being
+ *        mixed on a single supply is not modeled
+ *************************************************************************** */
+void MainWindow::configurePower() {
+    layoutServer();
+    server.setPowerBudget(psuBudgetLineEdit->text().toDouble() * 1000);
+
+    showFrame();
+    updatePowerInfo(true);
+}
+
+void MainWindow::updatePowerInfo(bool force) {
+    /* Not on every frame, text layout is costly */
+    if ( ! force && powerInfoClock.elapsed() < REFRESH_INFO_MS )
+        return;
+    powerInfoClock.restart();
+
+    const PowerModel &power = server.getPower();
+    bool limited = power.getRequested() > power.getCurrent();
+    QString text = QString("%1 A (peak %2, avg %3)")
+                       .arg(power.getCurrent() / 1000, 0, 'f', 2)
+                       .arg(power.getPeak() / 1000, 0, 'f', 2)
+                       .arg(power.getAverage() / 1000, 0, 'f', 2);
+
+    if (limited)
+        text += QString(" | limited from %1 A")
+                    .arg(power.getRequested() / 1000, 0, 'f', 2);
+
+    powerLbl->setText(text);
+    powerLbl->setStyleSheet(limited ? "color: red" : "");
+}
+
+/** **************************************************************************
+ * @brief Show the server's frame as the hardware would: its colors, scaled
+ *        down to the supply's budget when painted
+ *        A client's frame is timed up to painted with the scene
+ *************************************************************************** */
+void MainWindow::showFrame() {
+    TRACE_SCOPE("show", Tracer::NO_ID);
+    const ColorBuffer &frame = server.getFrame();
+
+    if ( ! frame.empty() )
+        display->setLedsColor(0, frame.size() - 1, frame.data());
+    display->setBrightness(server.getBrightness());
+
+    updatePowerInfo();
+    display->updateScene();
+}
+
+void MainWindow::flushPendingFrame() {
+    const double now = serverClock.nsecsElapsed() / 1e9;
+
+    layoutServer();
+    if (server.flushPendingFrame(now)) {
+        showFrame();
+        return;
+    }
+
+    /* Timer's precision: may fire a bit early */
+    if (server.hasPendingFrame())
+        refreshTimer->start(std::ceil((server.getRefresh().getNextSlot() - now)
+                                      * 1000));
+}
+
+/* *** Firmware export ***************************************************** */
+void MainWindow::recordAnimation(bool checked) {
+    if (checked) {
+        recorder.start(display->getNumberOfLeds());
+        recordClock.start();
+        recordFrame();
+        recordTimer->start();
+
+        if (logsTxtBox->isEnabled())
+            logsTxtBox->append("Recording animation...");
+        return;
+    }
+
+    recordTimer->stop();
+    recorder.stop(recordClock.elapsed());
+
+    if ( ! recorder.getNumberOfFrames() )
+        return;
+
+    QString cArrayFilter = tr("C array (*.h)");
+    QString selectedFilter;
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export animation"),
+                                                    QDir::currentPath(),
+                                                    cArrayFilter + ";;" +
+                                                    tr("Binary blob (*.leda)"),
+                                                    &selectedFilter);
+    struct AnimationReport report;
+    std::string error;
+
+    if ( filename.isNull() ) {
+        return;
+    }
+
+    AnimationFormat format = selectedFilter == cArrayFilter ?
+                             ANIM_FORMAT_C_ARRAY : ANIM_FORMAT_BLOB;
+    if ( ! recorder.save(filename.toStdString(), format, report, error) ) {
+        QMessageBox::warning(this, tr("Export animation"),
+                             QString::fromStdString(error));
+        return;
+    }
+
+    QString summary = QString::fromStdString(describeReport(report));
+    if (logsTxtBox->isEnabled())
+        logsTxtBox->append(summary);
+    QMessageBox::information(this, tr("Export animation"), summary);
+}
+
+void MainWindow::recordFrame() {
+    /* Frames of different sizes can't be encoded together:
+     * export what has been recorded so far */
+    if (display->getNumberOfLeds() != recorder.getNumberOfLeds()) {
+        if (logsTxtBox->isEnabled())
+            logsTxtBox->append("Design changed, recording stopped");
+        recordAnimAct->setChecked(false);
+        return;
+    }
+
+    recordFrameBuf.resize(recorder.getNumberOfLeds());
+    display->getLedsColor(recordFrameBuf.data());
+    recorder.addFrame(recordClock.elapsed(), recordFrameBuf.data());
 }
 
 /* *** TCP Socket actions ************************************************** */
+void MainWindow::captureStream(bool checked) {
+    std::string error;
+
+    if ( ! checked ) {
+        if ( ! capture.isOpen() )
+            return;
+
+        captureTimer->stop();
+        struct CaptureStats stats = capture.getStats();
+        bool ok = capture.close();
+        if (logsTxtBox->isEnabled())
+            logsTxtBox->append(QString("Capture: %1 records, %2 dropped%3")
+                                   .arg(stats.records).arg(stats.dropped)
+                                   .arg(ok ? "" : ", write errors"));
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Capture stream"),
+                                                    QDir::currentPath(),
+                                                    tr("Stream capture (*.ledc)"));
+    if ( filename.isNull() ) {
+        captureAct->setChecked(false);
+        return;
+    }
+
+    if ( ! capture.open(filename.toStdString(), CAPTURE_RAW,
+                        display->getNumberOfLeds(), error) ) {
+        QMessageBox::warning(this, tr("Capture stream"),
+                             QString::fromStdString(error));
+        captureAct->setChecked(false);
+        return;
+    }
+    captureTimer->start();
+
+    if (logsTxtBox->isEnabled())
+        logsTxtBox->append("Capturing stream...");
+}
+
+void MainWindow::infoLatency() {
+    QString text = QString::fromStdString(server.getLatency().describe());
+
+    if (logsTxtBox->isEnabled())
+        logsTxtBox->append(text);
+    QMessageBox::information(this, tr("Latency"), text);
+}
+
+void MainWindow::exportLatency() {
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export latency"),
+                                                    QDir::currentPath(),
+                                                    tr("JSON (*.json)"));
+    std::string error;
+
+    if ( filename.isNull() ) {
+        return;
+    }
+
+    if ( ! server.getLatency().dump(filename.toStdString(), error) )
+        QMessageBox::warning(this, tr("Export latency"),
+                             QString::fromStdString(error));
+}
+
+void MainWindow::traceStages(bool checked) {
+    std::string error;
+
+    if (checked) {
+        Tracer::global().start();
+        return;
+    }
+    Tracer::global().stop();
+
+    QString filename = QFileDialog::getSaveFileName(this, tr("Trace stages"),
+                                                    QDir::currentPath(),
+                                                    tr("Chrome trace (*.json)"));
+    if ( filename.isNull() ) {
+        return;
+    }
+
+    if ( ! Tracer::global().dump(filename.toStdString(), error) )
+        QMessageBox::warning(this, tr("Trace stages"),
+                             QString::fromStdString(error));
+}
+
 void MainWindow::cfgSocketInfos() {
     /* TODO */
 }
@@ -106,6 +731,8 @@ void MainWindow::startServer() {
 
     startSvrAct->setEnabled(false);
     scktStatus = true;
+    server.resetStats();
+    streamStats = {};
     scktLbl->setText(QString("Socket status : %1").arg("On", 15));
     stopSvrAct->setEnabled( ! startSvrAct->isEnabled() );
 
@@ -118,15 +745,9 @@ void MainWindow::stopServer() {
         /* Send a leaving message to inform the client and
              * allow it to reset its state as
              * QTcpSocket::disconnectFromHost() is used below */
-        QByteArray block;
-        QDataStream out(&block, QIODevice::WriteOnly);
-        out.setByteOrder(QDataStream::LittleEndian);
-
-        char tmp = PROTOCOL_COMMON_ACTION::LEAVE_SHUTDOWN;
-        out.writeBytes(&tmp, sizeof(tmp));
-
-        cltConnection->write(block);
-        cltConnection->flush();
+        std::vector<uint8_t> block;
+        encodeLeaveShutdown(block);
+        sendToClient(block);
 
         cltConnection->disconnectFromHost();
         cltConnection = nullptr;
@@ -198,6 +819,22 @@ void MainWindow::createActions() {
     connect(infoSizeIrlAct, &QAction::triggered,
             this, &MainWindow::infoSizeIrl);
 
+    /** Chains ****** */
+    infoChainsAct = new QAction(QIcon::fromTheme(
+                                    QIcon::ThemeIcon::DocumentNew),
+                                tr("Chains & refresh rate"), this);
+    infoChainsAct->setStatusTip(tr("Get data outputs' bandwidth & limits"));
+    connect(infoChainsAct, &QAction::triggered,
+            this, &MainWindow::infoChains);
+
+    exportChainsAct = new QAction(QIcon::fromTheme(
+                                      QIcon::ThemeIcon::DocumentSaveAs),
+                                  tr("E&xport chains"), this);
+    exportChainsAct->setStatusTip(tr("Export chains' order & current frame "
+                                     "as C header"));
+    connect(exportChainsAct, &QAction::triggered,
+            this, &MainWindow::exportChains);
+
     /* TCP Socket actions ********************************************* */
     tcpServer = new QTcpServer(this);
     connect(tcpServer, &QTcpServer::newConnection,
@@ -225,6 +862,76 @@ void MainWindow::createActions() {
     cfgSocketAct->setStatusTip(tr("Configure socket's IP & Port"));
     connect(cfgSocketAct, &QAction::triggered,
             this, &MainWindow::cfgSocketInfos);
+
+    /** Capture clients' streams ****** */
+    captureAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::MediaRecord),
+                             tr("Ca&pture stream"), this);
+    captureAct->setStatusTip(tr("Record every message received, to analyse "
+                                "or replay them later"));
+    captureAct->setCheckable(true);
+    connect(captureAct, &QAction::toggled, this, &MainWindow::captureStream);
+
+    /** Frames' latency ****** */
+    latencyAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::DocumentNew),
+                             tr("&Latency"), this);
+    latencyAct->setStatusTip(tr("Time from a frame's 1st byte received to "
+                                "painted, stage by stage"));
+    connect(latencyAct, &QAction::triggered, this, &MainWindow::infoLatency);
+
+    exportLatencyAct = new QAction(QIcon::fromTheme(
+                                       QIcon::ThemeIcon::DocumentNew),
+                                   tr("E&xport latency"), this);
+    exportLatencyAct->setStatusTip(tr("Export the latency's histograms as "
+                                      "JSON"));
+    connect(exportLatencyAct, &QAction::triggered,
+            this, &MainWindow::exportLatency);
+
+    /** Pipeline's trace ****** */
+    traceAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::MediaRecord),
+                           tr("&Trace stages"), this);
+    traceAct->setStatusTip(tr("Record every stage's begin & end, saved as a "
+                              "Chrome trace once unchecked (LEDS_TRACE "
+                              "builds)"));
+    traceAct->setCheckable(true);
+    traceAct->setEnabled(Tracer::isCompiled());
+    connect(traceAct, &QAction::toggled, this, &MainWindow::traceStages);
+
+    /* Effects actions ************************************************ */
+    /** Load shader ****** */
+    loadShaderAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::DocumentNew),
+                                tr("Load &shader"), this);
+    loadShaderAct->setStatusTip(tr("Run a shader file on the whole design"));
+    connect(loadShaderAct, &QAction::triggered, this, &MainWindow::loadShader);
+
+    /** Stop effects ****** */
+    stopEffectsAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::DocumentNew),
+                                 tr("S&top effects"), this);
+    stopEffectsAct->setStatusTip(tr("Stop all effects rendered locally"));
+    connect(stopEffectsAct, &QAction::triggered,
+            this, &MainWindow::stopEffects);
+
+    /** Save timeline ****** */
+    saveTimelineAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::DocumentNew),
+                                  tr("Save &timeline"), this);
+    saveTimelineAct->setStatusTip(tr("Save timeline's keyframes"));
+    connect(saveTimelineAct, &QAction::triggered,
+            this, &MainWindow::saveTimeline);
+
+    /** Load timeline ****** */
+    loadTimelineAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::DocumentNew),
+                                  tr("Load t&imeline"), this);
+    loadTimelineAct->setStatusTip(tr("Load timeline's keyframes"));
+    connect(loadTimelineAct, &QAction::triggered,
+            this, &MainWindow::loadTimeline);
+
+    /** Record animation ****** */
+    recordAnimAct = new QAction(QIcon::fromTheme(QIcon::ThemeIcon::MediaRecord),
+                                tr("&Record animation"), this);
+    recordAnimAct->setStatusTip(tr("Record the frames shown, then export them "
+                                   "for the firmware"));
+    recordAnimAct->setCheckable(true);
+    connect(recordAnimAct, &QAction::toggled,
+            this, &MainWindow::recordAnimation);
 }
 
 void MainWindow::createMenus() {
@@ -243,12 +950,28 @@ void MainWindow::createMenus() {
     infosSubMenu = designMenu->addMenu(tr("&Infos"));
     infosSubMenu->addAction(infoLedCountAct);
     infosSubMenu->addAction(infoSizeIrlAct);
+    infosSubMenu->addAction(infoChainsAct);
+    designMenu->addAction(exportChainsAct);
 
     tcpSocketMenu = menuBar()->addMenu(tr("&TCP Socket"));
     tcpSocketMenu->addAction(startSvrAct);
     tcpSocketMenu->addAction(stopSvrAct);
     tcpSocketMenu->addSeparator();
     tcpSocketMenu->addAction(cfgSocketAct);
+    tcpSocketMenu->addAction(captureAct);
+    tcpSocketMenu->addSeparator();
+    tcpSocketMenu->addAction(latencyAct);
+    tcpSocketMenu->addAction(exportLatencyAct);
+    tcpSocketMenu->addAction(traceAct);
+
+    effectsMenu = menuBar()->addMenu(tr("&Effects"));
+    effectsMenu->addAction(loadShaderAct);
+    effectsMenu->addAction(stopEffectsAct);
+    effectsMenu->addSeparator();
+    effectsMenu->addAction(saveTimelineAct);
+    effectsMenu->addAction(loadTimelineAct);
+    effectsMenu->addSeparator();
+    effectsMenu->addAction(recordAnimAct);
 }
 
 void MainWindow::createLabels() {
@@ -278,6 +1001,12 @@ void MainWindow::createLabels() {
     createQMovies();
     replaceSocketMovieWith(scktMovDisconn);
 
+    refreshLbl = new QLabel;
+    refreshLbl->setFont({ "Source Code Pro" });
+
+    powerLbl = new QLabel;
+    powerLbl->setFont({ "Source Code Pro" });
+
     zoomPlusLbl = new QPushButton("+");
     zoomPlusLbl->setFont({ "Source Code Pro" });
     zoomPlusLbl->setFixedSize(20, 20);
@@ -299,8 +1028,8 @@ void MainWindow::createLabels() {
 
 void MainWindow::createDropDownMenus() {
     ledTypeDrpDn = new QComboBox;
-    ledTypeDrpDn->addItem("WS2812");
-    ledTypeDrpDn->addItem("SK6812");
+    for (size_t i = 0; i < LED_TYPES_COUNT; i++)
+        ledTypeDrpDn->addItem(LED_TYPES[i].name);
     ledTypeDrpDn->setFixedSize(ledTypeDrpDn->sizeHint().width(),
                                ledTypeDrpDn->sizeHint().height());
     connect(ledTypeDrpDn, &QComboBox::currentIndexChanged,
@@ -311,6 +1040,7 @@ void MainWindow::createDropDownMenus() {
                                 ledTypeDrpDn->currentIndex()).arg(
                                 ledTypeDrpDn->currentText())
                     );
+                configureRefresh();
             } );
 
     ledPkgDrpDn = new QComboBox;
@@ -372,6 +1102,39 @@ void MainWindow::createDropDownMenus() {
                                 ledPlacementDrpDn->currentText())
                     );
             } );
+
+    refreshDrpDn = new QComboBox;
+    refreshDrpDn->addItem("No FPS limit");
+    refreshDrpDn->addItem("Flag FPS");
+    refreshDrpDn->addItem("Throttle FPS");
+    refreshDrpDn->setToolTip(tr("Frames faster than the LEDs' data line"));
+    refreshDrpDn->setFixedSize(refreshDrpDn->sizeHint().width(),
+                               refreshDrpDn->sizeHint().height());
+    connect(refreshDrpDn, &QComboBox::currentIndexChanged,
+            [=](int index) {
+                if (logsTxtBox->isEnabled())
+                    logsTxtBox->append(
+                        QString("Drop-down \"Refresh\": [%1] %2").arg(
+                                refreshDrpDn->currentIndex()).arg(
+                                refreshDrpDn->currentText())
+                    );
+                configureRefresh();
+            } );
+
+    psuBudgetLineEdit = new QLineEdit;
+    psuBudgetLineEdit->setText(QString("0"));
+    psuBudgetLineEdit->setMaxLength(6);
+    psuBudgetLineEdit->setFixedSize(50, ledTypeDrpDn->sizeHint().height());
+    psuBudgetLineEdit->setToolTip(tr("Power supply's budget [A], 0: no limit"));
+    connect(psuBudgetLineEdit, &QLineEdit::editingFinished,
+            [=]() {
+                if (logsTxtBox->isEnabled())
+                    logsTxtBox->append(
+                        QString("PSU budget: %1 A").arg(
+                                psuBudgetLineEdit->text())
+                    );
+                configurePower();
+            } );
 }
 
 void MainWindow::createInteractives() {
@@ -389,6 +1152,14 @@ void MainWindow::createInteractives() {
                 display->updateScene();
             } );
 
+    perfCheckBox = new QCheckBox(QString("Performance"));
+    perfCheckBox->setCheckState(Qt::Unchecked);
+    perfCheckBox->setFixedSize(100, 25);
+    connect(perfCheckBox, &QCheckBox::checkStateChanged,
+            [=](Qt::CheckState checked) {
+                display->toggleOverlay();
+            } );
+
     logsCheckBox = new QCheckBox(QString("Show logs"));
     logsCheckBox->setCheckState(Qt::Unchecked);
     logsCheckBox->setFixedSize(100, 25);
@@ -458,12 +1229,58 @@ void MainWindow::createInteractives() {
         oldValue = zoomSlider->value();
     });
 
+    /* Timeline: Play/Pause, scrubbing slider & keyframes edition */
+    timelinePlayBtn = new QPushButton("Play");
+    timelinePlayBtn->setFixedSize(60, 25);
+    connect(timelinePlayBtn, &QPushButton::clicked,
+            this, &MainWindow::playTimeline);
+
+    timelineSlider = new QSlider(Qt::Orientation::Horizontal);
+    timelineSlider->setRange(0, TIMELINE_MIN_LEN_S * 1000 / TIMELINE_STEP_MS);
+    timelineSlider->setStyleSheet(zoomSlider->styleSheet());
+    timelineSlider->setFixedSize(display->size().width()/2, 50);
+    connect(timelineSlider, &QSlider::valueChanged,
+            this, &MainWindow::scrubTimeline);
+
+    timelineLbl = new QLabel;
+    timelineLbl->setFont({ "Source Code Pro" });
+    timelineLbl->setText(QString("%1 s | %2 keys").arg(0.0, 7, 'f', 2).arg(0));
+
+    timelineInterpDrpDn = new QComboBox;
+    timelineInterpDrpDn->addItem("Step", INTERP_STEP);
+    timelineInterpDrpDn->addItem("RGB",  INTERP_RGB);
+    timelineInterpDrpDn->addItem("HSV",  INTERP_HSV);
+    timelineInterpDrpDn->setCurrentIndex(INTERP_RGB);
+    timelineInterpDrpDn->setFixedSize(timelineInterpDrpDn->sizeHint().width(),
+                                      timelineInterpDrpDn->sizeHint().height());
+
+    timelineKeyBtn = new QPushButton("+ Key");
+    timelineKeyBtn->setFixedSize(60, 25);
+    timelineKeyBtn->setToolTip(tr("Add the current colors as keyframe"));
+    connect(timelineKeyBtn, &QPushButton::clicked,
+            this, &MainWindow::addKeyframe);
+
+    timelineGroupKeyBtn = new QPushButton("+ Group");
+    timelineGroupKeyBtn->setFixedSize(60, 25);
+    timelineGroupKeyBtn->setToolTip(tr("Add a keyframe setting a group's "
+                                       "color"));
+    connect(timelineGroupKeyBtn, &QPushButton::clicked,
+            this, &MainWindow::addGroupKeyframe);
+
+    timelineDelBtn = new QPushButton("- Key");
+    timelineDelBtn->setFixedSize(60, 25);
+    timelineDelBtn->setToolTip(tr("Remove the keyframe under the cursor"));
+    connect(timelineDelBtn, &QPushButton::clicked,
+            this, &MainWindow::removeKeyframe);
+
     rightJustifSpacers[0] = new QSpacerItem(50, 0, QSizePolicy::Expanding,
                                             QSizePolicy::Minimum);
     rightJustifSpacers[1] = new QSpacerItem(50, 0, QSizePolicy::Expanding,
                                             QSizePolicy::Minimum);
     rightJustifSpacers[2] = new QSpacerItem(50, 0, QSizePolicy::Expanding,
                                             QSizePolicy::Minimum);
+    rightJustifSpacers[3] = new QSpacerItem(50, 0, QSizePolicy::Expanding,
+                                            QSizePolicy::Minimum);
     logsAlignSpacer       = new QSpacerItem(ipLbl->size().width()        -
                                             logsCheckBox->size().width() -
                                             logsClearBtn->size().width() - 6, 0,
@@ -487,6 +1304,7 @@ void MainWindow::createLayouts() {
     logsHLayout     = new QHBoxLayout;
     ledHLayout      = new QHBoxLayout;
     zoomHLayout     = new QHBoxLayout;
+    timelineHLayout = new QHBoxLayout;
     mainVLayout     = new QVBoxLayout;
 
     /* *** Layouts filling *** */
@@ -496,6 +1314,10 @@ void MainWindow::createLayouts() {
     toolsHLayout->addWidget(ledPkgGapLineEdit);
     toolsHLayout->addWidget(ledPkgUnitDrpDn);
     toolsHLayout->addWidget(ledPlacementDrpDn);
+    toolsHLayout->addWidget(refreshDrpDn);
+    toolsHLayout->addWidget(refreshLbl);
+    toolsHLayout->addWidget(psuBudgetLineEdit);
+    toolsHLayout->addWidget(powerLbl);
     toolsHLayout->addItem(rightJustifSpacers[0]);
 
     /** Socket infos + Logs ****** */
@@ -522,12 +1344,24 @@ void MainWindow::createLayouts() {
     zoomHLayout->addWidget(zoomSlider);
     zoomHLayout->addWidget(zoomPlusLbl);
     zoomHLayout->addWidget(xRayCheckBox);
+    zoomHLayout->addWidget(perfCheckBox);
     zoomHLayout->addItem(rightJustifSpacers[2]);
 
+    /** Timeline layout ****** */
+    timelineHLayout->addWidget(timelinePlayBtn);
+    timelineHLayout->addWidget(timelineSlider);
+    timelineHLayout->addWidget(timelineLbl);
+    timelineHLayout->addWidget(timelineInterpDrpDn);
+    timelineHLayout->addWidget(timelineKeyBtn);
+    timelineHLayout->addWidget(timelineGroupKeyBtn);
+    timelineHLayout->addWidget(timelineDelBtn);
+    timelineHLayout->addItem(rightJustifSpacers[3]);
+
     /** Main Layout ****** */
     mainVLayout->addLayout(toolsHLayout);
     mainVLayout->addLayout(ledHLayout);
     mainVLayout->addLayout(zoomHLayout);
+    mainVLayout->addLayout(timelineHLayout);
     mainVLayout->addStretch();
 }
 
@@ -576,130 +1410,151 @@ void MainWindow::replaceSocketMovieWith(QMovie *movie) {
  * @brief Client's request reader
  *************************************************************************** */
 void MainWindow::readCltRequest(void) {
-    inStream.startTransaction();
-
+    TRACE_SCOPE("recv", cltId);
     static QByteArray streamAsBytes;
-    inStream >> streamAsBytes;
+    const uint64_t received = CaptureWriter::clock();
+
+    /* Every complete request: several may arrive at once, each one being
+     * acknowledged. Stops once the client left */
+    while (cltConnection) {
+        inStream.startTransaction();
+        inStream >> streamAsBytes;
+
+        if ( ! inStream.commitTransaction() ) {
+            /* Rest of the request in later reads */
+            if ( ! partialSince && cltConnection->bytesAvailable() )
+                partialSince = received;
+            return;
+        }
 
-    if ( ! inStream.commitTransaction() )   return;
+        const uint64_t read = partialSince ? partialSince : received;
+        partialSince = 0;
+        streamStats.bytes += sizeof(uint32_t) + streamAsBytes.size();
+
+        capture.message(received, cltId,
+                        (const uint8_t *)streamAsBytes.constData(),
+                        streamAsBytes.size());
+        handleCltRequest(streamAsBytes, read);
+    }
+}
+
+/** **************************************************************************
+ * @brief Handled by the server (see engine/server.h), the widgets showing
+ *        what changed
+ *************************************************************************** */
+void MainWindow::handleCltRequest(const QByteArray &streamAsBytes,
+                                  uint64_t read) {
+    const double now = serverClock.nsecsElapsed() / 1e9;
+    const uint64_t presented = server.getStats().presented;
+    std::vector<uint8_t> answers;
 
     if (logsTxtBox->isEnabled()) {
         logsTxtBox->append(QString("Input           : %1").arg(streamAsBytes));
     }
 
-    if ( cltConnection->bytesAvailable() ) {
-        return;
-    }
+    /* Design may have been edited with the mouse since last request */
+    layoutServer();
 
-    /** Detect client's leave
-     *  + toLower() Hypothesis:
-     *  Upper -> Lower is optimized because UpperCase + offset = LowerCase
-     *  instead of a substraction LowerCase - offset = UpperCase */
-    if (streamAsBytes.toLower() == QByteArray("leaving")) {
+    /* Detect client's leave */
+    if ( ! server.handle((const uint8_t *)streamAsBytes.constData(),
+                         streamAsBytes.size(), now, answers, read) ) {
         cltConnection = nullptr;
         return;
     }
+    sendToClient(answers, false);
 
-    if (logsTxtBox->isEnabled()) {
-        logsTxtBox->append(QString("bytesAvailable(): %1").arg(cltConnection->bytesAvailable()));
-        logsTxtBox->append(QString("Input           : %1").arg(streamAsBytes));
-    }
+    if ( ! server.getLastError().empty() && logsTxtBox->isEnabled() )
+        logsTxtBox->append(QString("readCltRequest: %1")
+                               .arg(QString::fromStdString(
+                                        server.getLastError())));
 
-    /* REGEX part: ^\!
-     *             C[3-4]
-     *             N(([A-F]|[a-f]|[0-9]){4}),
-     *             .{4})+
-     *             \$$
-     * Accept data, like:  1data  - !C3N0001,<uint32_val>$
-                          10datas - !C3N000A,<uint32_val1>...<uint32_valN>$ */
-    static QRegularExpression re("^\\!C[3-4]N(([A-F]|[a-f]|[0-9]){4}),"
-                                 "(.{4})+\\$$");
-    if (re.match(streamAsBytes).hasMatch()) {
-        /* Remove starting "!C" & terminating '$' sequences */
-        streamAsBytes.remove(0, 2);
-        streamAsBytes.removeLast();
-
-        uint16_t n;
-        uint8_t  comp;
-        uint8_t  r, g, b, w;
-
-        /* Extract composants & # of data (16bits <=> 4 hexa digits) */
-        bool okDbg = true;
-        comp = TO_UINT8(streamAsBytes.at(0));   /* -'0': From char to uint8 */
-        streamAsBytes.remove(0, 2);             /* Remove digit + 'N' */
-        /* ISSUE: Below not working?!?!
-         * Hypothesis: Not isolated, so doesn't work with suffix */
-        //n = streamAsBytes.toUShort(&okDbg, NUMERICAL_BASE_16);
-        n = streamAsBytes.first(HEXA_16BITS_NDIGITS)
-                .toUShort(&okDbg, NUMERICAL_BASE_16);
-        /* Remove digits + ',' before datas */
-        streamAsBytes.remove(0, HEXA_16BITS_NDIGITS+1);
-
-        /* Check MAX limit & overwrite value if needed */
-        if (n > display->getNumberOfLeds())
-            n = display->getNumberOfLeds();
-
-        if (comp == 3) {
-            for (uint16_t i = 0; i < n; i++) {
-                r = streamAsBytes.at(0);
-                g = streamAsBytes.at(1);
-                b = streamAsBytes.at(2);
-                display->setLedColor(i, QColor(r, g, b));
-
-                streamAsBytes.remove(0, sizeof(uint32_t));
-            }
-        } else if (comp == 4) {
-            /* Treat 4 components as one WHITE channel
-             * and, for now, set all channels to this value */
-            for (uint32_t i = 0; i < n; i++) {
-                w = streamAsBytes.at(3);
-                display->setLedColor(i, QColor(w, w, w));
-
-                streamAsBytes.remove(0, sizeof(uint32_t));
-            }
-        } else  return; /* Do nothing and end function */
-
-        display->updateScene();
-        //display->update();
-    } else {
-        if (logsTxtBox->isEnabled()) {
-            logsTxtBox->append(QString("readCltRequest: RegEx failed to pass"));
-            logsTxtBox->append(QString("Input: %1").arg(streamAsBytes));
-        }
+    streamStats.frames  = server.getStats().frames;
+    streamStats.dropped = server.getStats().dropped;
+
+    if (server.effectsRunning() && ! effectsTimer->isActive())
+        effectsTimer->start();
+
+    /* Held back while throttling: shown once the data line is free */
+    if ( ! server.hasPendingFrame() )
+        refreshTimer->stop();
+    else if ( ! refreshTimer->isActive() )
+        refreshTimer->start(std::ceil((server.getRefresh().getNextSlot() - now)
+                                      * 1000));
+    updateRefreshInfo();
+
+    if (server.getStats().presented != presented)
+        showFrame();
+}
+
+/** **************************************************************************
+ * @brief Write answers encoded by engine/protocol.h to the client
+ *        Unflushed, they leave with the event loop: answers of requests
+ *        arrived together are written at once
+ *************************************************************************** */
+void MainWindow::sendToClient(const std::vector<uint8_t> &block, bool flush) {
+    if ( ! cltConnection )
+        return;
+
+    cltConnection->write((const char *)block.data(), block.size());
+    if (flush)
+        cltConnection->flush();
+}
+
+/** **************************************************************************
+ * @brief Render running effects, at EFFECTS_FPS
+ *************************************************************************** */
+void MainWindow::renderEffects(void) {
+    /* LEDs may have been added/removed with the mouse since last tick */
+    layoutServer();
+
+    if ( ! server.renderEffects(serverClock.nsecsElapsed() / 1e9) ) {
+        effectsTimer->stop();
+        return;
     }
+
+    showFrame();
 }
 
 /** **************************************************************************
  * @brief Client's connection approval
+ *        A single client is served: the others are refused, without an ack,
+ *        loads from several connections being for ledserver
  *************************************************************************** */
 void MainWindow::connectionSucessToClient(void) {
-    QByteArray block;
-    QDataStream out(&block, QIODevice::WriteOnly);
-    out.setByteOrder(QDataStream::LittleEndian);
-
-    /* Prepare response */
-    /* Note: Prefere
-     *       - out.writeBytes()
-     *       over
-     *       - out << (uint8_t)(PROTOCOL_SERVER_RESPONSE::*)
-     *       - block.append(PROTOCOL_SERVER_RESPONSE::*);
-     *       Because the 1st version adds a header with the number of data
-     *       after the header, where the 2nd doesn't.
-     *       I found it safer to send the number of data to the receiver,
-     *       so he can manage length variabilty */
-    char tmp = PROTOCOL_SERVER_RESPONSE::CLIENT_CONNECTION_ACK_AND_WAITING_DATA;
-    out.writeBytes(&tmp, sizeof(tmp));
-
-    if ( ! cltConnection ) {
-        cltConnection = tcpServer->nextPendingConnection();
+    /* Prepare response, with the number of data ahead like every answer:
+     * safer for the receiver, so he can manage length variabilty */
+    std::vector<uint8_t> block;
+    server.greet(block);
+
+    while (tcpServer->hasPendingConnections()) {
+        QTcpSocket *socket = tcpServer->nextPendingConnection();
+
+        if (cltConnection) {
+            if (logsTxtBox->isEnabled())
+                logsTxtBox->append("Client refused: one is already served");
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        cltConnection = socket;
+        cltId++;
         connect(cltConnection, &QAbstractSocket::disconnected,
                 cltConnection, &QObject::deleteLater);
+        connect(cltConnection, &QAbstractSocket::disconnected, this,
+                [this, socket, id = cltId]() {
+            capture.disconnected(CaptureWriter::clock(), id);
+            /* Left without a leaving message: the next one is served */
+            if (cltConnection == socket)
+                cltConnection = nullptr;
+        });
 
         inStream.setDevice(cltConnection);
+        partialSince = 0;
         connect(cltConnection, &QIODevice::readyRead,
                 this, &MainWindow::readCltRequest);
-    }
 
-    cltConnection->write(block);
-    cltConnection->flush();
+        capture.connected(CaptureWriter::clock(), cltId);
+        sendToClient(block);
+    }
 }
@@ -16,8 +16,18 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QTextEdit>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include "dynamicdisplay.h"
+#include "engine/animexport.h"
+#include "engine/capture.h"
+#include "engine/latency.h"
+#include "engine/ledtypes.h"
+#include "engine/protocol.h"
+#include "engine/server.h"
+#include "engine/timeline.h"
+#include "engine/trace.h"
 
 class MainWindow : public QMainWindow
 {
@@ -39,6 +49,8 @@ private slots:
     void emptyDesign();
     void infoLedsCount();
     void infoSizeIrl();
+    void infoChains();
+    void exportChains();
     /* TCP Socket actions */
     void startServer();
     void stopServer();
@@ -46,6 +58,32 @@ private slots:
 
     void connectionSucessToClient(void);
     void readCltRequest(void);
+    void captureStream(bool checked);
+    void infoLatency(void);
+    void exportLatency(void);
+    void traceStages(bool checked);
+
+    /* Effects */
+    void renderEffects(void);
+    void loadShader(void);
+    void stopEffects(void);
+
+    /* Timeline */
+    void playTimeline(void);
+    void renderTimeline(void);
+    void scrubTimeline(int value);
+    void addKeyframe(void);
+    void addGroupKeyframe(void);
+    void removeKeyframe(void);
+    void saveTimeline(void);
+    void loadTimeline(void);
+
+    /* Hardware's refresh rate */
+    void flushPendingFrame(void);
+
+    /* Firmware export */
+    void recordAnimation(bool checked);
+    void recordFrame(void);
 
 private:
     void createActions();
@@ -57,11 +95,24 @@ private:
     void createQMovies(void);
     void replaceSocketMovieWith(QMovie *movie);
 
+    void configureRefresh(void);
+    void layoutServer(void);
+    void updateRefreshInfo(bool force = false);
+    void configurePower(void);
+    void updatePowerInfo(bool force = false);
+    void showFrame(void);
+    void layoutTimeline(void);
+
+    /* Protocol's commands */
+    void handleCltRequest(const QByteArray &streamAsBytes, uint64_t read = 0);
+    void sendToClient(const std::vector<uint8_t> &block, bool flush = true);
+
     /* Menus */
     QMenu *fileMenu = nullptr;
     QMenu *designMenu = nullptr;
     QMenu *infosSubMenu = nullptr;
     QMenu *tcpSocketMenu = nullptr;
+    QMenu *effectsMenu   = nullptr;
 
     /* Actions */
     /** File actions */
@@ -73,10 +124,22 @@ private:
     QAction *emptyDesignAct  = nullptr;
     QAction *infoLedCountAct = nullptr;
     QAction *infoSizeIrlAct  = nullptr;
+    QAction *infoChainsAct   = nullptr;
+    QAction *exportChainsAct = nullptr;
     /** TCP Socket actions */
     QAction *startSvrAct  = nullptr;
     QAction *stopSvrAct   = nullptr;
     QAction *cfgSocketAct = nullptr;
+    QAction *captureAct   = nullptr;
+    QAction *latencyAct       = nullptr;
+    QAction *exportLatencyAct = nullptr;
+    QAction *traceAct         = nullptr;
+    /** Effects actions */
+    QAction *loadShaderAct  = nullptr;
+    QAction *stopEffectsAct = nullptr;
+    QAction *saveTimelineAct = nullptr;
+    QAction *loadTimelineAct = nullptr;
+    QAction *recordAnimAct   = nullptr;
 
     /* Layouts */
     QVBoxLayout *mainVLayout     = nullptr;
@@ -85,10 +148,12 @@ private:
     QVBoxLayout *scktLogsVLayout = nullptr;
     QHBoxLayout *logsHLayout     = nullptr;
     QHBoxLayout *zoomHLayout     = nullptr;
+    QHBoxLayout *timelineHLayout = nullptr;
 
     /* Interactives */
     QCheckBox   *logsCheckBox = nullptr;
     QCheckBox   *xRayCheckBox = nullptr;
+    QCheckBox   *perfCheckBox = nullptr;
     QPushButton *logsClearBtn = nullptr;
 
     QComboBox *ledTypeDrpDn      = nullptr;
@@ -96,6 +161,16 @@ private:
     QLineEdit *ledPkgGapLineEdit = nullptr;
     QComboBox *ledPkgUnitDrpDn   = nullptr;
     QComboBox *ledPlacementDrpDn = nullptr;
+    QComboBox *refreshDrpDn      = nullptr;
+    QLineEdit *psuBudgetLineEdit = nullptr;
+
+    QPushButton *timelinePlayBtn     = nullptr;
+    QSlider     *timelineSlider      = nullptr;
+    QLabel      *timelineLbl         = nullptr;
+    QPushButton *timelineKeyBtn      = nullptr;
+    QPushButton *timelineGroupKeyBtn = nullptr;
+    QPushButton *timelineDelBtn      = nullptr;
+    QComboBox   *timelineInterpDrpDn = nullptr;
 
     /* Labels, Datas & Stuffs */
     QLabel *ipLbl = nullptr;
@@ -113,13 +188,16 @@ private:
 
     QTextEdit *logsTxtBox  = nullptr;
 
+    QLabel *refreshLbl = nullptr;
+    QLabel *powerLbl   = nullptr;
+
     QSlider *zoomSlider       = nullptr;;
     /* Clickable Label implemented as QPushButton for the clicked event */
     QPushButton *zoomPlusLbl  = nullptr;
     QPushButton *zoomMinusLbl = nullptr;
 
     /* Spacers */
-    QSpacerItem *rightJustifSpacers[3];
+    QSpacerItem *rightJustifSpacers[4];
     QSpacerItem *logsAlignSpacer;
     QSpacerItem *socketMovieSpacer;
 
@@ -132,5 +210,49 @@ private:
     QTcpServer  *tcpServer = nullptr;
     QDataStream inStream;
     QTcpSocket  *cltConnection = nullptr;
+
+    /* Clients' commands, effects & timeline applied to the design as the
+     * hardware would show them, laid out from the design's generation: the
+     * widgets only show its frame. serverClock: its time */
+    DisplayServer server;
+    uint64_t      serverGeneration = 0;
+    QElapsedTimer serverClock;
+
+    /* Running effects rendered at EFFECTS_FPS */
+    QTimer        *effectsTimer = nullptr;
+
+    /* Keyframes' timeline, position in [s], laid out from the design's
+     * generation */
+    Timeline      timeline;
+    uint64_t      timelineGeneration = 0;
+    QTimer        *timelineTimer = nullptr;
+    QElapsedTimer timelineClock;
+    double        timelinePos      = 0.0;
+    double        timelineStartPos = 0.0;
+    ColorBuffer   timelineFrame;
+
+    /* Power & refresh labels' updates, frame held back while throttling */
+    QElapsedTimer powerInfoClock;
+    QElapsedTimer refreshInfoClock;
+    QTimer        *refreshTimer = nullptr;
+
+    /* Clients' messages recorded as received, see engine/capture.h
+     * cltId: # of the connection, in the records
+     * captureTimer: flushes the records of a slow stream while capturing */
+    CaptureWriter capture;
+    QTimer        *captureTimer = nullptr;
+    uint32_t      cltId = 0;
+
+    /* When the request not complete yet started to arrive, for the frames'
+     * latency (see server.getLatency()) */
+    uint64_t          partialSince = 0;
+    /* Counters of the performance overlay */
+    struct StreamStats streamStats  = {};
+
+    /* Frames shown, sampled for the firmware export */
+    AnimationRecorder recorder;
+    QTimer            *recordTimer = nullptr;
+    QElapsedTimer     recordClock;
+    ColorBuffer       recordFrameBuf;
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,6 @@
+# Rainbow turning around the design's center, 1 turn every 4s
+h = fract(angle / (2 * pi) + time * 0.25);
+
+r = clamp(abs(h * 6 - 3) - 1, 0, 1);
+g = clamp(2 - abs(h * 6 - 2), 0, 1);
+b = clamp(2 - abs(h * 6 - 4), 0, 1);
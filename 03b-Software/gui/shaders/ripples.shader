@@ -0,0 +1,7 @@
+# Cyan rings going out of the center, every other group darker
+wave = 0.5 + 0.5 * sin(radius * 20 - time * 6);
+dim  = mod(group, 2) == 1 ? 0.4 : 1;
+
+r = 0;
+g = wave * 0.53 * dim;
+b = wave * 0.8 * dim;
@@ -0,0 +1,23 @@
+#ifndef __CHAIN_H__
+#define __CHAIN_H__
+
+#include "json.hpp"
+#include "group.h"  /* struct LEDRange */
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* LEDs driven by one data pin, in the order they are wired: ranges follow
+ * each other on the line, a range with start > end being wired backwards */
+struct LEDChain {
+    std::string name;
+    uint32_t pin = 0;
+    /* LED type of the whole chain, see engine/ledtypes.h
+     * Optional, the one selected in the tools otherwise */
+    std::string type;
+    std::vector<LEDRange> ranges;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(LEDChain, name, pin, type, ranges)
+};
+
+#endif // __CHAIN_H__
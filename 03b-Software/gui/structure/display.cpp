@@ -1,95 +1,344 @@
-
 #include "display.h"
 
 #include "json.hpp"
+#include <cstring>
 #include <fstream>
+#include <map>
+#include <sstream>
+
+/* .dispb, see display.h */
+static const char     BINARY_MAGIC[]    = "LEDB";
+static const uint8_t  BINARY_VERSION    = 1;
+static const size_t   BINARY_HEADER_LEN = 20;
+static const size_t   BINARY_LED_LEN    = 4 * sizeof(double) + sizeof(float) +
+                                          sizeof(uint16_t);
+
+static bool endsWith(const std::string &text, const std::string &suffix) {
+    return text.size() >= suffix.size() &&
+           ! text.compare(text.size() - suffix.size(), suffix.size(), suffix);
+}
+
+/* Groups' names are sent in "?G$" answers: no protocol's separator (see
+ * group.h). Their ranges go from start to end, only chains may be wired
+ * backwards */
+static bool checkGroups(const struct LEDDisplay &display,
+                        const std::string &path, std::string &error) {
+    for (const auto &group : display.groups) {
+        if (group.name.find_first_of("=;,+") != std::string::npos) {
+            error = path + ": group \"" + group.name +
+                    "\" has one of '=', ';', ',', '+' in its name";
+            return false;
+        }
+        for (const auto &range : group.ranges) {
+            if (range.start > range.end) {
+                error = path + ": group \"" + group.name +
+                        "\" has a range ending before its start";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* *** Binary encoding ***************************************************** */
+static void putU16(std::string &out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+static void putU32(std::string &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(value >> shift);
+}
+
+static void putU64(std::string &out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8)
+        out.push_back(value >> shift);
+}
+
+static void putF64(std::string &out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+static void putF32(std::string &out, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putU32(out, bits);
+}
+
+static bool putString(std::string &out, const std::string &text) {
+    if (text.size() > UINT16_MAX)
+        return false;
+    putU16(out, text.size());
+    out += text;
+    return true;
+}
+
+static void putRanges(std::string &out, const std::vector<LEDRange> &ranges) {
+    putU32(out, ranges.size());
+    for (const auto &range : ranges) {
+        putU32(out, range.start);
+        putU32(out, range.end);
+    }
+}
+
+static bool encodeBinary(const LEDDisplay &display, std::string &out,
+                         std::string &error) {
+    /* LEDs share a handful of types: each one stored once */
+    std::map<std::string, uint16_t> typeIndex;
+    std::vector<const std::string *> types;
+    for (const auto &led : display.leds) {
+        if (typeIndex.count(led.type))
+            continue;
+        if (types.size() > UINT16_MAX) {
+            error = "too many LED types";
+            return false;
+        }
+        typeIndex[led.type] = types.size();
+        types.push_back(&led.type);
+    }
+
+    out.clear();
+    out.reserve(BINARY_HEADER_LEN + display.leds.size() * BINARY_LED_LEN);
+
+    out.append(BINARY_MAGIC, 4);
+    out.push_back(BINARY_VERSION);
+    out.push_back(0);
+    putU16(out, types.size());
+    putU32(out, display.leds.size());
+    putU32(out, display.groups.size());
+    putU32(out, display.chains.size());
+
+    bool ok = true;
+    for (const std::string *type : types)
+        ok &= putString(out, *type);
+
+    for (const auto &led : display.leds) {
+        putF64(out, led.position.x);
+        putF64(out, led.position.y);
+        putF64(out, led.radius);
+        putF64(out, led.angle);
+        putF32(out, led.pitch);
+        putU16(out, typeIndex[led.type]);
+    }
+
+    for (const auto &group : display.groups) {
+        ok &= putString(out, group.name);
+        putRanges(out, group.ranges);
+    }
+
+    for (const auto &chain : display.chains) {
+        ok &= putString(out, chain.name);
+        putU32(out, chain.pin);
+        ok &= putString(out, chain.type);
+        putRanges(out, chain.ranges);
+    }
+
+    if ( ! ok )
+        error = "name longer than 65535 bytes";
+    return ok;
+}
+
+/* *** Binary decoding ***************************************************** */
+/* Reads in place, every read past the end leaving ok false */
+struct BinaryReader {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok;
 
-#include <QFileDialog>
-#include <QCoreApplication>
+    bool has(size_t n) {
+        ok = ok && (size_t)(end - p) >= n;
+        return ok;
+    }
+    uint16_t u16() {
+        if ( ! has(2) )
+            return 0;
+        uint16_t value = p[0] | p[1] << 8;
+        p += 2;
+        return value;
+    }
+    uint32_t u32() {
+        if ( ! has(4) )
+            return 0;
+        uint32_t value = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+        p += 4;
+        return value;
+    }
+    uint64_t u64() {
+        uint64_t low = u32();
+        return low | (uint64_t)u32() << 32;
+    }
+    double f64() {
+        uint64_t bits = u64();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    float f32() {
+        uint32_t bits = u32();
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    std::string string() {
+        size_t n = u16();
+        if ( ! has(n) )
+            return {};
+        std::string text((const char *)p, n);
+        p += n;
+        return text;
+    }
+    void ranges(std::vector<LEDRange> &ranges) {
+        uint32_t n = u32();
+        /* Checked 1st: a corrupted count mustn't allocate gigabytes */
+        if ( ! has((size_t)n * 2 * sizeof(uint32_t)) )
+            return;
+        ranges.resize(n);
+        for (auto &range : ranges) {
+            range.start = u32();
+            range.end   = u32();
+        }
+    }
+};
 
-bool openDisplay(struct LEDDisplay& display, std::string &fname) {
-    QString filename = QFileDialog::getOpenFileName(nullptr, QFileDialog::tr("Open display"),
-                                                    QDir::currentPath()+"/../../displays/",
-                                                    QFileDialog::tr("Display file (*.disp *.display)"/*;;All files (*)"*/));
-    if ( filename.isNull() ) {
+static bool decodeBinary(struct LEDDisplay &display, const std::string &content,
+                         const std::string &path, std::string &error) {
+    struct BinaryReader in = { (const uint8_t *)content.data(),
+                               (const uint8_t *)content.data() + content.size(),
+                               true };
+    struct LEDDisplay decoded;
+
+    /* Magic already checked, flags unused yet */
+    in.p += 4;
+    if ( ! in.has(2) || in.p[0] != BINARY_VERSION ) {
+        error = path + ": unsupported version";
         return false;
     }
+    in.p += 2;
+
+    std::vector<std::string> types(in.u16());
+    uint32_t nLeds   = in.u32();
+    uint32_t nGroups = in.u32();
+    uint32_t nChains = in.u32();
+
+    for (auto &type : types)
+        type = in.string();
 
-    QFile file(filename);   // PATH Checked from getOpenFileName()
-    QFileInfo infos(filename);
-    fname = infos.fileName().toStdString();
+    if (in.has((size_t)nLeds * BINARY_LED_LEN)) {
+        decoded.leds.resize(nLeds);
+        for (auto &led : decoded.leds) {
+            led.position.x = in.f64();
+            led.position.y = in.f64();
+            led.radius     = in.f64();
+            led.angle      = in.f64();
+            led.pitch      = in.f32();
+
+            uint16_t type = in.u16();
+            if (type >= types.size()) {
+                error = path + ": unknown LED type";
+                return false;
+            }
+            led.type  = types[type];
+            led.color = {};
+        }
+    }
+
+    for (uint32_t i = 0; i < nGroups && in.ok; i++) {
+        struct LEDGroup group;
+        group.name = in.string();
+        in.ranges(group.ranges);
+        decoded.groups.push_back(std::move(group));
+    }
+
+    for (uint32_t i = 0; i < nChains && in.ok; i++) {
+        struct LEDChain chain;
+        chain.name = in.string();
+        chain.pin  = in.u32();
+        chain.type = in.string();
+        in.ranges(chain.ranges);
+        decoded.chains.push_back(std::move(chain));
+    }
 
-    /* If one of the supported suffix is present, .compare() will return 0 as success.
-       With the AND op., we simply "overwrite" the other's result. */
-    if (infos.suffix().compare("disp") & infos.suffix().compare("display")) {
+    if ( ! in.ok ) {
+        error = path + ": truncated";
         return false;
     }
+    if ( ! checkGroups(decoded, path, error) )
+        return false;
 
-    file.open(QIODevice::ReadOnly | QIODevice::Text);
-    QString fileContent = file.readAll();
-    file.close();
+    // Update the display ONLY if file is completely valid
+    display = std::move(decoded);
+    return true;
+}
 
-    if ( fileContent.isEmpty() ) {
+/* *** Files *************************************************************** */
+bool loadDisplay(struct LEDDisplay &display, const std::string &path,
+                 std::string &error) {
+    std::ifstream file(path, std::ios::binary);
+    if ( ! (file && file.is_open()) ) {
+        error = "cannot open " + path;
         return false;
     }
 
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string fileContent = content.str();
+
+    if ( fileContent.empty() ) {
+        error = path + " is empty";
+        return false;
+    }
+
+    if ( ! fileContent.compare(0, 4, BINARY_MAGIC) )
+        return decodeBinary(display, fileContent, path, error);
+
     nlohmann::json generic_json;
+    struct LEDDisplay decoded;
     try {
         // If exported with time, just erase the first line
         if (fileContent[0] == '#' || fileContent[0] == '/')
-            fileContent.remove(0, fileContent.indexOf(QChar('\n')));
-        std::stringstream(fileContent.toStdString()) >> generic_json;
+            fileContent.erase(0, fileContent.find('\n'));
+        std::stringstream(fileContent) >> generic_json;
+        decoded = generic_json.get<struct LEDDisplay>();
     } catch (nlohmann::detail::exception& e) {
+        error = path + ": " + e.what();
         return false;
     }
+    if ( ! checkGroups(decoded, path, error) )
+        return false;
 
-    // Update Window's Title & variables ONLY if file:
-    //  -> Exists
-    //  -> Is completely valid
-    //ui->setWindowTitle(infos.fileName());
-    display = generic_json.get<struct LEDDisplay>();
+    // Update the display ONLY if file is completely valid
+    display = std::move(decoded);
 
     return true;
 }
 
-// TODO(KBP): CLI approach
-/* bool saveDisplay(const LEDDisplay& display, const std::string& path) {
-    nlohmann::json jsonDisplay = display;
-    std::ofstream file(path);
-
-    QString filename = QFileDialog::getSaveFileName(nullptr, QFileDialog::tr("Save display"),
-                                                    QDir::currentPath(),
-                                                    QFileDialog::tr("Display file (*.disp)"));
+bool saveDisplay(const LEDDisplay& display, const std::string& path,
+                 std::string &error) {
+    std::string binary;
+    const bool isBinary = endsWith(path, ".dispb");
 
-    if ( ! (file && file.is_open()) ) {
-        file.close();
+    if (isBinary && ! encodeBinary(display, binary, error) ) {
+        error = path + ": " + error;
         return false;
     }
 
-    file << std::setw(4) << jsonDisplay << std::endl;
-    file.close();
-    return true;
-}*/
-
-// TODO(KBP): GUI Approach
-bool saveDisplay(const LEDDisplay& display) {
-    nlohmann::json jsonDisplay = display;
-
-    QString filename = QFileDialog::getSaveFileName(nullptr, QFileDialog::tr("Save display"),
-                                                    QDir::currentPath(),
-                                                    QFileDialog::tr("Display file (*.disp)"));
-    if ( filename.isNull() ) {
+    std::ofstream file(path, std::ios::binary);
+    if ( ! (file && file.is_open()) ) {
+        error = "cannot open " + path;
         return false;
     }
 
-    std::ofstream file(filename.toStdString());
+    if (isBinary)
+        file.write(binary.data(), binary.size());
+    else
+        file << std::setw(4) << nlohmann::json(display) << std::endl;
 
-    if ( ! (file && file.is_open()) ) {
-        file.close();
+    if ( ! file ) {
+        error = "cannot write " + path;
         return false;
     }
-
-    file << std::setw(4) << jsonDisplay << std::endl;
-    file.close();
     return true;
 }
@@ -2,6 +2,8 @@
 #define __DISPLAY_H__
 
 #include "json.hpp"
+#include "chain.h"
+#include "group.h"
 #include "led.h"
 #include <vector>
 #include <string>
@@ -9,13 +11,32 @@
 /* Can't simply name it Display, sa it conflicts with Qt's */
 struct LEDDisplay {
     std::vector<LED> leds;
+    /* Optional in file, designs saved before groups existed don't have it */
+    std::vector<LEDGroup> groups;
+    /* Optional as well, none: the whole design is 1 chain */
+    std::vector<LEDChain> chains;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(LEDDisplay, leds)
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(LEDDisplay, leds, groups, chains)
 };
 
-bool openDisplay(struct LEDDisplay &display, std::string &fname);
-
-bool saveDisplay(const LEDDisplay& display, const std::string& path);
-bool saveDisplay(const LEDDisplay& display);
+/* Design files, without any UI: see displaydialog.h for the GUI's
+ *  - .disp : JSON, the LEDs' fields by name
+ *  - .dispb: same content in binary, to load designs of millions of LEDs
+ *            without parsing text. Chosen by the extension when saving, by
+ *            the magic when loading. All fields in Little Endian:
+ *     Header : "LEDB" <u8 version> <u8 flags (0)> <u16 # of LED types>
+ *              <u32 # of LEDs> <u32 # of groups> <u32 # of chains>
+ *     Types  : <string>[# of LED types]
+ *     LEDs   : <f64 x> <f64 y> <f64 radius> <f64 angle> <f32 pitch>
+ *              <u16 type's index>
+ *     Groups : <string name> <u32 # of ranges> (<u32 start> <u32 end>)*
+ *     Chains : <string name> <u32 pin> <string type> <u32 # of ranges>
+ *              (<u32 start> <u32 end>)*
+ *   Strings being <u16 length> followed by their bytes
+ * @return false on error, with a message in error */
+bool loadDisplay(struct LEDDisplay &display, const std::string &path,
+                 std::string &error);
+bool saveDisplay(const LEDDisplay& display, const std::string& path,
+                 std::string &error);
 
 #endif // __DISPLAY_H__
@@ -0,0 +1,27 @@
+#ifndef __GROUP_H__
+#define __GROUP_H__
+
+#include "json.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Inclusive range of LED indexes, like the "branches" of the CLI samples */
+struct LEDRange {
+    uint32_t start;
+    uint32_t end;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(LEDRange, start, end)
+};
+
+/* Named set of LEDs (segment, branch, ...) addressable as a whole.
+ * Name must not contain any of the protocol's separators:
+ * '=', ';', ',', '+' */
+struct LEDGroup {
+    std::string name;
+    std::vector<LEDRange> ranges;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(LEDGroup, name, ranges)
+};
+
+#endif // __GROUP_H__
@@ -0,0 +1,633 @@
+/* ************************************************************************** *
+ * ***          REPLAY OF A CAPTURED SESSION, AT ANY SPEED                *** *
+ * ************************************************************************** *
+ * usage: ledreplay [options] <capture.ledc>
+ *
+ * Replays a capture (see engine/capture.h, ledserver -c or the GUI's
+ * "Capture stream"), so an incident seen during a show becomes a performance
+ * test anyone can run again:
+ *  - over the protocol to a server (GUI, ledserver), each client captured
+ *    having its own connection,
+ *  - or straight into ledcore's DisplayServer (-d), without any socket.
+ * At the original timing, N times faster (-x N) or flat out (-x 0). The
+ * capture is mapped, not loaded: replaying several GB starts right away.
+ *
+ * Direct replays are deterministic: the server is given the records' times
+ * rather than the clock, so the final frame (hash printed) is the same at any
+ * speed. The time spent in each stage is printed as "key=value" lines, -o
+ * writes it as JSON:
+ *  read    : record taken from the capture (page faults included)
+ *  encode  : decoded frame (-m decoded captures) turned back into a message
+ *  handle  : direct, message parsed & applied (power budget, chains)
+ *  effects : direct, effects rendered at 60 fps of the capture's time
+ *  render  : direct, offscreen render every -r ms of the capture's time
+ *  send    : over the protocol, message written to the socket
+ *  answer  : over the protocol, until the server's answer (frames, "?G",
+ *            "!S"); connect: until the connection's ack
+ *  lag     : how late records are sent compared to their schedule
+ * -T writes every stage's begin & end, thread by thread, as a Chrome trace
+ * (see engine/trace.h, built with LEDS_TRACE).                              */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "../engine/capture.h"
+#include "../engine/latency.h"
+#include "../engine/ledtypes.h"
+#include "../engine/protocol.h"
+#include "../engine/raster.h"
+#include "../engine/server.h"
+#include "../engine/trace.h"
+#include "../structure/json.hpp"
+
+#include "../../protocol_src/ledclient.h"
+
+/* Like ledserver's */
+#define DEFAULT_ADDR        "127.0.0.1"
+#define DEFAULT_PORT        5000
+#define EFFECTS_FPS         60
+#define CONNECT_TIMEOUT     5000
+/* Answers still awaited once everything is sent [ms] */
+#define DRAIN_TIMEOUT       2000
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile sig_atomic_t running = 1;
+
+static void onSignal(int) {
+    running = 0;
+}
+
+enum Stage {
+    STAGE_READ, STAGE_ENCODE, STAGE_HANDLE, STAGE_EFFECTS, STAGE_RENDER,
+    STAGE_SEND, STAGE_CONNECT, STAGE_ANSWER, STAGE_LAG, STAGES
+};
+
+static const char *STAGE_NAMES[STAGES] = {
+    "read", "encode", "handle", "effects", "render",
+    "send", "connect", "answer", "lag"
+};
+
+static LatencyHistogram stages[STAGES];
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Clock::now().time_since_epoch()).count();
+}
+
+/* A captured client, replayed over its own connection */
+struct Connection {
+    struct ledclient clt;
+    /* Sending times of the messages the server answers, in order */
+    std::deque<std::pair<uint64_t, enum Stage>> pending;
+    bool alive;
+};
+
+static void onAnswer(void *user, const uint8_t *msg, size_t len) {
+    struct Connection *conn = (struct Connection *)user;
+
+    if ( ! len || msg[0] == LEAVE_SHUTDOWN || conn->pending.empty() )
+        return;
+    stages[conn->pending.front().second].record(nowNs() -
+                                               conn->pending.front().first);
+    conn->pending.pop_front();
+}
+
+/* The server answers well formed frames & groups' requests, every shader */
+static bool isAnswered(const uint8_t *msg, size_t len) {
+    struct ClientRequest req;
+    bool ok = parseRequest(msg, len, req);
+
+    return req.cmd == CMD_SHADER ||
+           (ok && (req.cmd == CMD_FRAME || req.cmd == CMD_GROUPS_REQUEST));
+}
+
+struct Replay {
+    /* Direct */
+    DisplayServer server;
+    Rasterizer raster;
+    int renderMs = 0;
+    double nextEffects = 0.0;
+    double nextRender  = 0.0;
+    std::vector<uint8_t> answers;
+
+    /* Over the protocol */
+    const char *addr = nullptr;
+    int port = 0;
+    std::map<uint32_t, struct Connection> connections;
+    uint64_t connectErrors = 0;
+    uint64_t sendErrors    = 0;
+    /* Answers not received before the connection was closed */
+    uint64_t abandoned     = 0;
+
+    /* Re-encoded decoded frames */
+    std::vector<uint8_t> encoded;
+
+    uint64_t records  = 0;
+    uint64_t messages = 0;
+    uint64_t frames   = 0;
+    uint64_t bytes    = 0;
+};
+
+/** **************************************************************************
+ * @brief Server's answers, until deadline [ns of nowNs()] (0: those already
+ *        there), the connections lost being closed
+ *************************************************************************** */
+static void pumpAnswers(struct Replay &replay, uint64_t deadline) {
+    std::vector<struct pollfd> fds;
+    std::vector<struct Connection *> conns;
+
+    do {
+        fds.clear();
+        conns.clear();
+        for (auto &entry : replay.connections) {
+            if ( ! entry.second.alive )
+                continue;
+            fds.push_back({ entry.second.clt.fd, POLLIN, 0 });
+            conns.push_back(&entry.second);
+        }
+
+        const uint64_t now = nowNs();
+        /* poll() counts in ms & wakes up late: the last ms is slept */
+        int timeoutMs = deadline > now + 2000000
+                        ? (deadline - now) / 1000000 - 1 : 0;
+        if (fds.empty() && timeoutMs) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            continue;
+        }
+        if (poll(fds.data(), fds.size(), timeoutMs) <= 0)
+            continue;
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if ( ! fds[i].revents )
+                continue;
+            if (ledclient_process(&conns[i]->clt, 0) < 0) {
+                ledclient_close(&conns[i]->clt);
+                conns[i]->alive = false;
+            }
+        }
+    } while (running && deadline && nowNs() + 2000000 < deadline);
+}
+
+static struct Connection* connectionOf(struct Replay &replay,
+                                       uint32_t client) {
+    auto found = replay.connections.find(client);
+    if (found != replay.connections.end())
+        return found->second.alive ? &found->second : nullptr;
+
+    struct Connection &conn = replay.connections[client];
+    conn.clt   = {};
+    conn.alive = false;
+
+    const uint64_t start = nowNs();
+    if (ledclient_connect(&conn.clt, replay.addr, replay.port,
+                          CONNECT_TIMEOUT) < 0) {
+        std::fprintf(stderr, "RPL: client %" PRIu32 ": cannot connect to "
+                     "%s:%d: %s\n", client, replay.addr, replay.port,
+                     std::strerror(errno));
+        replay.connectErrors++;
+        return nullptr;
+    }
+    conn.clt.onMessage = onAnswer;
+    conn.clt.user      = &conn;
+    conn.alive         = true;
+    conn.pending.push_back({ start, STAGE_CONNECT });
+    return &conn;
+}
+
+/* conn's answers still awaited, until deadline [ns of nowNs()]
+ * @return # of answers not received */
+static size_t drainAnswers(struct Connection &conn, uint64_t deadline) {
+    uint64_t now;
+
+    while (running && conn.alive && ! conn.pending.empty() &&
+           (now = nowNs()) < deadline) {
+        if (ledclient_process(&conn.clt, (deadline - now) / 1000000 + 1) < 0) {
+            ledclient_close(&conn.clt);
+            conn.alive = false;
+        }
+    }
+    return conn.pending.size();
+}
+
+static void disconnect(struct Replay &replay, uint32_t client) {
+    auto found = replay.connections.find(client);
+
+    if (found == replay.connections.end())
+        return;
+    /* Its answers would be lost with the connection */
+    replay.abandoned += drainAnswers(found->second,
+                                     nowNs() + DRAIN_TIMEOUT * 1000000ull);
+    /* A client captured again later gets a new connection */
+    ledclient_close(&found->second.clt);
+    replay.connections.erase(found);
+}
+
+/* Timers of the capture's time up to "now" [s], like ledserver's loop */
+static void runTimers(struct Replay &replay, double now) {
+    /* Frame held back while throttling, shown at its slot */
+    const double slot = replay.server.getRefresh().getNextSlot();
+    if (replay.server.hasPendingFrame() && slot <= now)
+        replay.server.flushPendingFrame(slot);
+
+    while (replay.server.effectsRunning() && replay.nextEffects <= now) {
+        const uint64_t t0 = nowNs();
+        replay.server.renderEffects(replay.nextEffects);
+        stages[STAGE_EFFECTS].record(nowNs() - t0);
+        replay.nextEffects += 1.0 / EFFECTS_FPS;
+    }
+
+    while (replay.renderMs && replay.nextRender <= now) {
+        const uint64_t t0 = nowNs();
+        TRACE_BEGIN("render", Tracer::NO_ID);
+        replay.raster.render(replay.server.getFrame().data(),
+                             replay.server.getBrightness());
+        TRACE_END("render", Tracer::NO_ID);
+        stages[STAGE_RENDER].record(nowNs() - t0);
+        replay.nextRender += replay.renderMs / 1000.0;
+    }
+}
+
+static void replayRecord(struct Replay &replay,
+                         const struct CaptureRecord &rec) {
+    const bool direct = ! replay.addr;
+    const double now = rec.t / 1e9;
+    const uint8_t *msg = rec.data;
+    size_t len = rec.len;
+
+    if (direct)
+        runTimers(replay, now);
+
+    switch (rec.kind) {
+    case CAPTURE_CONNECT:
+        if (direct) {
+            replay.answers.clear();
+            replay.server.greet(replay.answers);
+        } else {
+            connectionOf(replay, rec.client);
+        }
+        return;
+    case CAPTURE_DISCONNECT:
+        if ( ! direct )
+            disconnect(replay, rec.client);
+        return;
+    case CAPTURE_FRAME: {
+        const uint64_t t0 = nowNs();
+        replay.encoded.clear();
+        encodeFrame(replay.encoded, rec.data, rec.len / sizeof(uint32_t),
+                    rec.count);
+        stages[STAGE_ENCODE].record(nowNs() - t0);
+
+        msg = replay.encoded.data() + PROTOCOL_LEN_SIZE;
+        len = replay.encoded.size() - PROTOCOL_LEN_SIZE;
+        replay.frames++;
+        break;
+    }
+    case CAPTURE_MESSAGE:
+        if (len > 1 && msg[0] == '!' && msg[1] == 'C')
+            replay.frames++;
+        break;
+    default:
+        return;
+    }
+
+    replay.messages++;
+    replay.bytes += PROTOCOL_LEN_SIZE + len;
+
+    if (direct) {
+        const uint64_t t0 = nowNs();
+        replay.answers.clear();
+        replay.server.handle(msg, len, now, replay.answers);
+        stages[STAGE_HANDLE].record(nowNs() - t0);
+
+        /* Effects just started: 1st render right away, like ledserver */
+        if (replay.server.effectsRunning() && replay.nextEffects < now)
+            replay.nextEffects = now;
+        return;
+    }
+
+    struct Connection *conn = connectionOf(replay, rec.client);
+    if ( ! conn )
+        return;
+
+    /* The server closes on "leaving", with the answers it didn't write yet:
+     * like the client captured, wait for them first */
+    struct ClientRequest req;
+    if (parseRequest(msg, len, req) && req.cmd == CMD_LEAVING)
+        drainAnswers(*conn, nowNs() + DRAIN_TIMEOUT * 1000000ull);
+
+    const uint64_t t0 = nowNs();
+    TRACE_SCOPE("send", rec.client);
+    if (ledclient_send_raw(&conn->clt, msg, len) < 0) {
+        replay.sendErrors++;
+        ledclient_close(&conn->clt);
+        conn->alive = false;
+        return;
+    }
+    const uint64_t t1 = nowNs();
+    stages[STAGE_SEND].record(t1 - t0);
+    if (isAnswered(msg, len))
+        conn->pending.push_back({ t1, STAGE_ANSWER });
+}
+
+/* FNV-1a of the colors shown, to compare replays */
+static uint64_t frameHash(const ColorBuffer &frame) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (uint32_t color : frame) {
+        for (int b = 0; b < 4; b++) {
+            hash ^= (color >> (8 * b)) & 0xFF;
+            hash *= 0x100000001B3ull;
+        }
+    }
+    return hash;
+}
+
+static std::string timestamp() {
+    char text[32];
+    std::time_t now = std::time(nullptr);
+
+    std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return text;
+}
+
+static void usage(const char *name) {
+    std::fprintf(stderr,
+        "usage: %s [options] <capture.ledc>\n"
+        "\t-a ADDR : Server's IP address (default: " DEFAULT_ADDR ")\n"
+        "\t-p PORT : Server's port (default: %d)\n"
+        "\t-d FILE : Direct, into this design's server: no socket\n"
+        "\t-t TYPE : Direct, LED type of chains without one (default: %s)\n"
+        "\t-b MA   : Direct, power supply's budget [mA] (default: no limit)\n"
+        "\t-f MODE : Direct, frames faster than the chains: none, flag or "
+        "throttle (default: none)\n"
+        "\t-r MS   : Direct, render offscreen every MS ms (default: never)\n"
+        "\t-w PX   : Direct, offscreen image's width (default: 800)\n"
+        "\t-x N    : Speed, N times the original, 0 = flat out (default: 1)\n"
+        "\t-s SEC  : Start SEC s into the capture (default: 0)\n"
+        "\t-e SEC  : Stop SEC s into the capture (default: its end)\n"
+        "\t-o FILE : Write the report as JSON, - for stdout\n"
+        "\t-T FILE : Trace the stages (Chrome's JSON), built with "
+        "LEDS_TRACE\n",
+        name, DEFAULT_PORT, LED_TYPES[0].name);
+    std::exit(EXIT_FAILURE);
+}
+
+/** **************************************************************************
+ * @brief Main application function
+ *************************************************************************** */
+int main(int argc, char **argv) {
+    const char *designPath = nullptr, *reportPath = nullptr;
+    const char *tracePath = nullptr;
+    const char *addr = DEFAULT_ADDR;
+    std::string ledType = LED_TYPES[0].name;
+    enum RefreshPolicy policy = REFRESH_NO_LIMIT;
+    double budgetMa = 0.0, speed = 1.0, from = 0.0, to = 0.0;
+    int port = DEFAULT_PORT, renderMs = 0, opt;
+    size_t imageWidth = 800;
+
+    while ((opt = getopt(argc, argv, "a:p:d:t:b:f:r:w:x:s:e:o:T:")) != -1) {
+        switch (opt) {
+        case 'a': addr       = optarg;                            break;
+        case 'p': port       = std::atoi(optarg);                 break;
+        case 'd': designPath = optarg;                            break;
+        case 't': ledType    = optarg;                            break;
+        case 'b': budgetMa   = std::atof(optarg);                 break;
+        case 'r': renderMs   = std::atoi(optarg);                 break;
+        case 'w': imageWidth = std::strtoul(optarg, nullptr, 0);  break;
+        case 'x': speed      = std::atof(optarg);                 break;
+        case 's': from       = std::atof(optarg);                 break;
+        case 'e': to         = std::atof(optarg);                 break;
+        case 'o': reportPath = optarg;                            break;
+        case 'T': tracePath  = optarg;                            break;
+        case 'f':
+            if (std::string(optarg) == "flag")
+                policy = REFRESH_FLAG;
+            else if (std::string(optarg) == "throttle")
+                policy = REFRESH_THROTTLE;
+            else if (std::string(optarg) != "none")
+                usage(argv[0]);
+            break;
+        default:  usage(argv[0]);
+        }
+    }
+    if (argc - optind != 1 || speed < 0.0 || from < 0.0 || to < 0.0 ||
+        renderMs < 0 || ! imageWidth)
+        usage(argv[0]);
+    if (tracePath && ! Tracer::isCompiled()) {
+        std::fprintf(stderr, "RPL: built without tracing, see LEDS_TRACE\n");
+        return EXIT_FAILURE;
+    }
+
+    CaptureReader capture;
+    std::string error;
+    if ( ! capture.open(argv[optind], error) ) {
+        std::fprintf(stderr, "RPL: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    struct Replay replay;
+    if (designPath) {
+        struct LEDDisplay display;
+        if ( ! loadDisplay(display, designPath, error) ) {
+            std::fprintf(stderr, "RPL: %s\n", error.c_str());
+            return EXIT_FAILURE;
+        }
+        if (capture.getNumberOfLeds() &&
+            capture.getNumberOfLeds() != display.leds.size())
+            std::fprintf(stderr, "RPL: captured with %zu LEDs, %s has %zu\n",
+                         capture.getNumberOfLeds(), designPath,
+                         display.leds.size());
+
+        replay.server.setDisplay(display, findLedType(ledType));
+        replay.server.setPowerBudget(budgetMa);
+        replay.server.setRefreshPolicy(policy, 0.0);
+        replay.renderMs = renderMs;
+        if (renderMs)
+            replay.raster.setLayout(display, imageWidth);
+    } else {
+        replay.addr = addr;
+        replay.port = port;
+    }
+
+    std::signal(SIGINT,  onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    TRACE_THREAD("replay");
+    if (tracePath)
+        Tracer::global().start();
+
+    std::printf("RPL: %s, %s, %zu MB, %" PRIu64 " records over %.3f s%s\n",
+                argv[optind],
+                capture.getMode() == CAPTURE_DECODED ? "decoded" : "raw",
+                capture.getSize() >> 20, capture.getNumberOfRecords(),
+                capture.getDuration() / 1e9,
+                capture.isIndexed() ? "" : " (not indexed)");
+    std::fflush(stdout);
+
+    const uint64_t fromNs = from * 1e9, toNs = to * 1e9;
+    if (fromNs)
+        capture.seek(fromNs);
+
+    struct CaptureRecord rec;
+    uint64_t first = 0, last = 0, start = 0, t0 = nowNs();
+
+    while (running && capture.next(rec)) {
+        stages[STAGE_READ].record(nowNs() - t0);
+        if (toNs && rec.t > toNs)
+            break;
+
+        if ( ! replay.records++ ) {
+            first = rec.t;
+            start = nowNs();
+        }
+        last = rec.t;
+
+        /* At the original pace, speed times faster */
+        if (speed > 0.0) {
+            const uint64_t due = start + (rec.t - first) / speed;
+            if (replay.addr)
+                pumpAnswers(replay, due);
+            std::this_thread::sleep_until(Clock::time_point(
+                std::chrono::nanoseconds(due)));
+            const uint64_t now = nowNs();
+            stages[STAGE_LAG].record(now > due ? now - due : 0);
+        } else if (replay.addr) {
+            pumpAnswers(replay, 0);
+        }
+
+        replayRecord(replay, rec);
+        t0 = nowNs();
+    }
+    const double wall = replay.records ? (nowNs() - start) / 1e9 : 0.0;
+    const double span = (last - first) / 1e9;
+
+    /* Answers still on their way */
+    if (replay.addr) {
+        const uint64_t deadline = nowNs() + DRAIN_TIMEOUT * 1000000ull;
+        auto waiting = [&replay]() {
+            for (const auto &entry : replay.connections)
+                if (entry.second.alive && ! entry.second.pending.empty())
+                    return true;
+            return false;
+        };
+        while (running && waiting() && nowNs() < deadline)
+            pumpAnswers(replay, std::min(deadline, nowNs() + 10000000));
+        for (auto &entry : replay.connections) {
+            replay.abandoned += entry.second.pending.size();
+            ledclient_close(&entry.second.clt);
+        }
+    } else {
+        runTimers(replay, last / 1e9);
+        /* Still held back: the LEDs end up showing it at its slot */
+        if (replay.server.hasPendingFrame())
+            replay.server.flushPendingFrame(
+                replay.server.getRefresh().getNextSlot());
+    }
+
+    if (capture.isTruncated())
+        std::fprintf(stderr, "RPL: %s is truncated, replayed up to there\n",
+                     argv[optind]);
+
+    std::printf("RPL: records=%" PRIu64 " messages=%" PRIu64 " frames=%" PRIu64
+                " bytes=%" PRIu64 " capture_s=%.3f wall_s=%.3f speed=%.2f"
+                " mb_per_s=%.1f", replay.records, replay.messages,
+                replay.frames, replay.bytes, span, wall,
+                wall > 0.0 ? span / wall : 0.0,
+                wall > 0.0 ? replay.bytes / wall / 1e6 : 0.0);
+    if (replay.addr)
+        std::printf(" connect_errors=%" PRIu64 " send_errors=%" PRIu64
+                    " abandoned=%" PRIu64 "\n", replay.connectErrors,
+                    replay.sendErrors, replay.abandoned);
+    else
+        std::printf(" frame_hash=%016" PRIx64 "\n",
+                    frameHash(replay.server.getOutputFrame()));
+
+    for (int s = 0; s < STAGES; s++) {
+        const LatencyHistogram &st = stages[s];
+        if ( ! st.getCount() )
+            continue;
+        std::printf("RPL: stage=%s count=%" PRIu64 " mean_us=%.2f p50_us=%.2f"
+                    " p99_us=%.2f max_us=%.2f\n", STAGE_NAMES[s], st.getCount(),
+                    st.getTotal() / 1e3 / st.getCount(), st.getPercentile(0.50) / 1e3,
+                    st.getPercentile(0.99) / 1e3, st.getMax() / 1e3);
+    }
+    if ( ! replay.addr )
+        std::printf("RPL: %s\n", replay.server.describeStats().c_str());
+    std::fflush(stdout);
+
+    Tracer::global().stop();
+    if (tracePath && ! Tracer::global().dump(tracePath, error)) {
+        std::fprintf(stderr, "RPL: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if ( ! reportPath )
+        return EXIT_SUCCESS;
+
+    nlohmann::ordered_json doc;
+    doc["replay"]    = argv[optind];
+    doc["timestamp"] = timestamp();
+    doc["target"]    = designPath ? designPath
+                       : std::string(addr) + ":" + std::to_string(port);
+    doc["direct"]    = designPath != nullptr;
+    doc["speed"]     = speed;
+    doc["records"]   = replay.records;
+    doc["messages"]  = replay.messages;
+    doc["frames"]    = replay.frames;
+    doc["bytes"]     = replay.bytes;
+    doc["capture_s"] = span;
+    doc["wall_s"]    = wall;
+    doc["truncated"] = capture.isTruncated();
+    if (replay.addr)
+        doc["abandoned"] = replay.abandoned;
+    if (designPath) {
+        char hash[20];
+        std::snprintf(hash, sizeof(hash), "%016" PRIx64,
+                      frameHash(replay.server.getOutputFrame()));
+        doc["frame_hash"] = hash;
+    }
+
+    doc["stages"] = nlohmann::ordered_json::array();
+    for (int s = 0; s < STAGES; s++) {
+        const LatencyHistogram &st = stages[s];
+        if ( ! st.getCount() )
+            continue;
+        doc["stages"].push_back({
+            { "name", STAGE_NAMES[s] }, { "count", st.getCount() },
+            { "total_ms", st.getTotal() / 1e6 },
+            { "mean_us", st.getTotal() / 1e3 / st.getCount() },
+            { "p50_us", st.getPercentile(0.50) / 1e3 },
+            { "p99_us", st.getPercentile(0.99) / 1e3 },
+            { "max_us", st.getMax() / 1e3 },
+        });
+    }
+
+    if (std::string(reportPath) == "-") {
+        std::printf("%s\n", doc.dump(2).c_str());
+        return EXIT_SUCCESS;
+    }
+
+    std::ofstream file(reportPath);
+    file << doc.dump(2) << std::endl;
+    if ( ! file ) {
+        std::fprintf(stderr, "RPL: cannot write %s\n", reportPath);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
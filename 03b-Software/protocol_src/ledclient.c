@@ -0,0 +1,652 @@
+
+/* Include for .. */
+#include <errno.h>
+#include <fcntl.h>      /* .. fcntl() */
+#include <poll.h>       /* .. poll() */
+#include <stdio.h>      /* .. snprintf() */
+#include <stdlib.h>     /* .. malloc(), free() */
+#include <string.h>     /* .. strlen(), memmove() */
+#include <time.h>       /* .. clock_gettime() */
+#include <unistd.h>     /* .. close() */
+
+#include <arpa/inet.h>          /* .. inet_pton(), htons() */
+#include <netinet/in.h>         /* .. struct sockaddr_in[6] */
+#include <netinet/tcp.h>        /* .. TCP_NODELAY */
+#include <sys/socket.h>         /* .. socket(), connect(), recv(), sendmsg() */
+#include <sys/uio.h>            /* .. struct iovec */
+
+#include "ledclient.h"
+
+/* Words & the commands' entries are sent as they are in memory, the protocol
+ * being Little Endian */
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+        #error "ledclient: Little Endian host expected"
+#endif
+
+#define LEAVING_MSG     "Leaving"
+
+/* Free room in the receiving buffer before each recv() */
+#define RX_CHUNK        4096u
+
+/* poll() counts in [ms] & wakes up late: the server's messages are handled
+ * until this margin before a deadline, the rest is slept precisely */
+#define SLEEP_MARGIN_NS 1000000LL
+#define NS_PER_S        1000000000LL
+
+/** **************************************************************************
+ * @brief Send every iovec, resuming after partial writes
+ *        MSG_NOSIGNAL: a closed server is an EPIPE error, not a SIGPIPE
+ *************************************************************************** */
+static int sendAll(int fd, struct iovec *iov, int iovcnt) {
+        struct msghdr msg;
+        ssize_t n;
+
+        memset(&msg, 0, sizeof(msg));
+
+        while (iovcnt) {
+                msg.msg_iov    = iov;
+                msg.msg_iovlen = iovcnt;
+
+                n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return -1;
+                }
+
+                /* Skip what has been sent */
+                while (iovcnt && (size_t)n >= iov->iov_len) {
+                        n -= iov->iov_len;
+                        iov++;
+                        iovcnt--;
+                }
+                if (iovcnt) {
+                        iov->iov_base  = (char *)iov->iov_base + n;
+                        iov->iov_len  -= n;
+                }
+        }
+
+        return 0;
+}
+
+/** **************************************************************************
+ * @brief Length prefix, header, payload & optional '$', in 1 call
+ *************************************************************************** */
+static int sendCommand(struct ledclient *clt, const char *header,
+                       size_t headerLen, const void *payload,
+                       size_t payloadLen, int terminated) {
+        uint32_t streamLen = headerLen + payloadLen + (terminated ? 1 : 0);
+        struct iovec iov[4] = {
+                { &streamLen,              sizeof(streamLen) },
+                { (void *)header,          headerLen         },
+                { (void *)payload,         payloadLen        },
+                { (void *)"$",             terminated ? 1 : 0 },
+        };
+
+        if (clt->fd < 0) {
+                errno = ENOTCONN;
+                return -1;
+        }
+
+        return sendAll(clt->fd, iov, 4);
+}
+
+/* Wait for fd to be ready, 0 on timeout
+ * Not restarted on EINTR: a signal (SIGINT, ...) aborts the wait */
+static int waitFor(int fd, short events, int timeoutMs) {
+        struct pollfd pfd = { .fd = fd, .events = events };
+
+        return poll(&pfd, 1, timeoutMs);
+}
+
+int ledclient_connect(struct ledclient *clt, const char *ip, int port,
+                      int timeoutMs) {
+        struct sockaddr_storage addr;
+        struct sockaddr_in  *addr4 = (struct sockaddr_in *)&addr;
+        struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *)&addr;
+        socklen_t addrLen;
+        int flags, err = 0, one = 1;
+        socklen_t errLen = sizeof(err);
+
+        memset(clt, 0, sizeof(*clt));
+        memset(&addr, 0, sizeof(addr));
+        clt->fd = -1;
+
+        /* 10's base for IPv4, 16's base for IPv6 */
+        if (inet_pton(AF_INET, ip, &addr4->sin_addr) == 1) {
+                addr4->sin_family = AF_INET;
+                addr4->sin_port   = htons(port);
+                addrLen = sizeof(*addr4);
+        } else if (inet_pton(AF_INET6, ip, &addr6->sin6_addr) == 1) {
+                addr6->sin6_family = AF_INET6;
+                addr6->sin6_port   = htons(port);
+                addrLen = sizeof(*addr6);
+        } else {
+                errno = EINVAL;
+                return -1;
+        }
+
+        clt->fd = socket(addr.ss_family, SOCK_STREAM, 0);
+        if (clt->fd < 0)
+                return -1;
+
+        /* Non-blocking only while connecting, then sends block as usual */
+        flags = fcntl(clt->fd, F_GETFL);
+        if (flags < 0 || fcntl(clt->fd, F_SETFL, flags | O_NONBLOCK) < 0)
+                goto failure;
+
+        if (connect(clt->fd, (struct sockaddr *)&addr, addrLen) < 0) {
+                if (errno != EINPROGRESS)
+                        goto failure;
+
+                switch (waitFor(clt->fd, POLLOUT, timeoutMs)) {
+                case -1:
+                        goto failure;
+                case 0:
+                        errno = ETIMEDOUT;
+                        goto failure;
+                }
+
+                if (getsockopt(clt->fd, SOL_SOCKET, SO_ERROR, &err, &errLen) < 0)
+                        goto failure;
+                if (err) {
+                        errno = err;
+                        goto failure;
+                }
+        }
+
+        if (fcntl(clt->fd, F_SETFL, flags) < 0 ||
+            setsockopt(clt->fd, IPPROTO_TCP, TCP_NODELAY,
+                       &one, sizeof(one)) < 0)
+                goto failure;
+
+        return 0;
+
+failure:
+        err = errno;
+        close(clt->fd);
+        clt->fd = -1;
+        errno = err;
+        return -1;
+}
+
+/* Nanoseconds from now until deadline, negative once past */
+static long long nsUntil(const struct timespec *deadline) {
+        struct timespec now;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (deadline->tv_sec - now.tv_sec) * NS_PER_S +
+               (deadline->tv_nsec - now.tv_nsec);
+}
+
+/* Milliseconds left until deadline, rounded up: poll() doesn't return early */
+static int remainingMs(const struct timespec *deadline) {
+        long long ns = nsUntil(deadline);
+
+        return ns > 0 ? (ns + 999999) / 1000000 : 0;
+}
+
+static void addNs(struct timespec *ts, uint64_t ns) {
+        ts->tv_sec  += ns / NS_PER_S;
+        ts->tv_nsec += ns % NS_PER_S;
+        if (ts->tv_nsec >= NS_PER_S) {
+                ts->tv_sec++;
+                ts->tv_nsec -= NS_PER_S;
+        }
+}
+
+static void deadlineIn(struct timespec *deadline, unsigned delayMs) {
+        clock_gettime(CLOCK_MONOTONIC, deadline);
+        addNs(deadline, delayMs * 1000000ULL);
+}
+
+/* Client's own handling, then the user's */
+static void handleMessage(struct ledclient *clt, const uint8_t *msg,
+                          size_t len) {
+        if (len) {
+                switch (msg[0]) {
+                case CLIENT_CONNECTION_ACK_AND_WAITING_DATA:
+                        clt->connected = 1;
+                        break;
+                case DATA_RECEIVED_ACK:
+                        clt->framesAcked++;
+                        if (len > 1)
+                                clt->lastDataInfo = msg[1];
+                        break;
+                case LEAVE_SHUTDOWN:
+                        clt->serverLeft = 1;
+                        break;
+                }
+        }
+
+        if (clt->onMessage)
+                clt->onMessage(clt->user, msg, len);
+}
+
+/** **************************************************************************
+ * @brief Handle every complete message of the receiving buffer & keep the
+ *        incomplete one's bytes for next time
+ * @return # of messages, -1 if one is longer than LEDCLIENT_MSG_MAX
+ *************************************************************************** */
+static int parseMessages(struct ledclient *clt) {
+        size_t   ofst = 0;
+        uint32_t len;
+        int      handled = 0;
+
+        while (ofst + sizeof(len) <= clt->rxLen) {
+                memcpy(&len, clt->rx + ofst, sizeof(len));
+                if (len > LEDCLIENT_MSG_MAX) {
+                        errno = EMSGSIZE;
+                        return -1;
+                }
+                if (ofst + sizeof(len) + len > clt->rxLen)
+                        break;
+
+                handleMessage(clt, clt->rx + ofst + sizeof(len), len);
+                ofst += sizeof(len) + len;
+                handled++;
+        }
+
+        memmove(clt->rx, clt->rx + ofst, clt->rxLen - ofst);
+        clt->rxLen -= ofst;
+        return handled;
+}
+
+/** **************************************************************************
+ * @brief ledclient_process(), telling whether a signal interrupted the wait
+ *************************************************************************** */
+static int processMessages(struct ledclient *clt, int timeoutMs,
+                           int *interrupted) {
+        uint8_t *rx;
+        ssize_t  n;
+        int      rc, handled = 0;
+
+        *interrupted = 0;
+        if (clt->serverLeft) {
+                errno = ECONNRESET;
+                return -1;
+        }
+
+        switch (waitFor(clt->fd, POLLIN, timeoutMs)) {
+        case -1:
+                if (errno != EINTR)
+                        return -1;
+                *interrupted = 1;
+                return 0;
+        case 0:
+                return 0;
+        }
+
+        /* Everything available, parsed chunk by chunk so that the buffer
+         * only grows for long messages */
+        for (;;) {
+                if (clt->rxSize - clt->rxLen < RX_CHUNK) {
+                        rx = realloc(clt->rx, clt->rxLen + RX_CHUNK);
+                        if ( ! rx )
+                                return -1;
+                        clt->rx     = rx;
+                        clt->rxSize = clt->rxLen + RX_CHUNK;
+                }
+
+                n = recv(clt->fd, clt->rx + clt->rxLen,
+                         clt->rxSize - clt->rxLen, MSG_DONTWAIT);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        if (errno == EAGAIN || errno == EWOULDBLOCK)
+                                return handled;
+                        return -1;
+                }
+                if (n == 0) {
+                        clt->serverLeft = 1;
+                        errno = ECONNRESET;
+                        return -1;
+                }
+
+                clt->rxLen += n;
+                rc = parseMessages(clt);
+                if (rc < 0)
+                        return -1;
+                handled += rc;
+        }
+}
+
+int ledclient_process(struct ledclient *clt, int timeoutMs) {
+        int interrupted;
+
+        return processMessages(clt, timeoutMs, &interrupted);
+}
+
+int ledclient_wait(struct ledclient *clt, unsigned delayMs) {
+        struct timespec deadline;
+
+        deadlineIn(&deadline, delayMs);
+        return ledclient_wait_until(clt, &deadline);
+}
+
+int ledclient_wait_until(struct ledclient *clt,
+                         const struct timespec *deadline) {
+        long long ns;
+        int interrupted;
+
+        /* Server's messages as they come, while there's time */
+        while ((ns = nsUntil(deadline)) >= SLEEP_MARGIN_NS + 1000000) {
+                if (processMessages(clt, (ns - SLEEP_MARGIN_NS) / 1000000,
+                                    &interrupted) < 0)
+                        return -1;
+                if (interrupted)
+                        return 0;
+        }
+
+        /* Then the deadline itself, to the timer's precision */
+        if (ns > 0 &&
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL))
+                return 0;
+
+        /* Arrived while sleeping */
+        return processMessages(clt, 0, &interrupted) < 0 ? -1 : 0;
+}
+
+void ledclient_sched_start(struct ledclient_sched *sch, double fps) {
+        memset(sch, 0, sizeof(*sch));
+        sch->periodNs = fps > 0.0 ? NS_PER_S / fps : 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &sch->start);
+        sch->next = sch->start;
+}
+
+int ledclient_sched_wait(struct ledclient *clt, struct ledclient_sched *sch,
+                         uint64_t durationNs) {
+        long long late;
+
+        if ( ! durationNs )
+                durationNs = sch->periodNs;
+        sch->frames++;
+
+        /* From the previous deadline, not from now: no drift */
+        addNs(&sch->next, durationNs);
+
+        /* Too late for this one: next deadline on the same grid */
+        late = -nsUntil(&sch->next);
+        if (late > 0 && durationNs) {
+                uint64_t skipped = late / durationNs + 1;
+
+                addNs(&sch->next, skipped * durationNs);
+                sch->missed += skipped;
+        }
+
+        if (ledclient_wait_until(clt, &sch->next) < 0)
+                return -1;
+
+        late = -nsUntil(&sch->next);
+        if (late > 0 && (uint64_t)late > sch->maxLateNs)
+                sch->maxLateNs = late;
+        return 0;
+}
+
+double ledclient_sched_fps(const struct ledclient_sched *sch) {
+        long long ns = -nsUntil(&sch->start);
+
+        return ns > 0 ? sch->frames * (double)NS_PER_S / ns : 0.0;
+}
+
+int ledclient_handshake(struct ledclient *clt, int timeoutMs) {
+        struct timespec deadline;
+        int ms = timeoutMs, interrupted;
+
+        deadlineIn(&deadline, timeoutMs < 0 ? 0 : timeoutMs);
+        while ( ! clt->connected ) {
+                if (timeoutMs >= 0 && (ms = remainingMs(&deadline)) == 0) {
+                        errno = ETIMEDOUT;
+                        return -1;
+                }
+                if (processMessages(clt, ms, &interrupted) < 0)
+                        return -1;
+                if (interrupted) {
+                        errno = EINTR;
+                        return -1;
+                }
+        }
+
+        return 0;
+}
+
+int ledclient_leave(struct ledclient *clt) {
+        /* Not terminated by '$', the server compares the whole message */
+        int rc = sendCommand(clt, LEAVING_MSG, strlen(LEAVING_MSG),
+                             NULL, 0, 0);
+
+        ledclient_close(clt);
+        return rc;
+}
+
+void ledclient_close(struct ledclient *clt) {
+        if (clt->fd >= 0)
+                close(clt->fd);
+        clt->fd = -1;
+
+        free(clt->frame);
+        clt->frame    = NULL;
+        clt->frameLen = 0;
+
+        free(clt->rx);
+        clt->rx     = NULL;
+        clt->rxLen  = 0;
+        clt->rxSize = 0;
+}
+
+uint32_t *ledclient_alloc_frame(struct ledclient *clt, size_t nLeds) {
+        uint32_t *frame;
+
+        if (nLeds > LEDCLIENT_MAX_ENTRIES) {
+                errno = EMSGSIZE;
+                return NULL;
+        }
+
+        frame = realloc(clt->frame, nLeds * sizeof(*frame));
+        if ( ! frame && nLeds )
+                return NULL;
+
+        clt->frame    = frame;
+        clt->frameLen = nLeds;
+        return frame;
+}
+
+int ledclient_send_frame(struct ledclient *clt, int comp) {
+        return ledclient_send_leds(clt, comp, clt->frame, clt->frameLen);
+}
+
+int ledclient_send_leds(struct ledclient *clt, int comp,
+                        const uint32_t *leds, size_t n) {
+        char header[LEDCLIENT_HEADER_LEN];
+
+        if ((comp != 3 && comp != 4) || ! n) {
+                errno = EINVAL;
+                return -1;
+        }
+        if (n > LEDCLIENT_MAX_ENTRIES) {
+                errno = EMSGSIZE;
+                return -1;
+        }
+
+        snprintf(header, sizeof(header), "!C%dN%04zx,", comp, n);
+        if (sendCommand(clt, header, strlen(header),
+                        leds, n * sizeof(*leds), 1) < 0)
+                return -1;
+
+        clt->framesSent++;
+        return 0;
+}
+
+int ledclient_frames_init(struct ledclient_frames *frames, int comp,
+                          size_t nLeds) {
+        char header[LEDCLIENT_HEADER_LEN];
+
+        memset(frames, 0, sizeof(*frames));
+        if ((comp != 3 && comp != 4) || ! nLeds) {
+                errno = EINVAL;
+                return -1;
+        }
+        if (nLeds > LEDCLIENT_MAX_ENTRIES) {
+                errno = EMSGSIZE;
+                return -1;
+        }
+
+        frames->scratch = malloc(nLeds * sizeof(*frames->scratch));
+        if ( ! frames->scratch )
+                return -1;
+
+        frames->comp   = comp;
+        frames->nLeds  = nLeds;
+        frames->msgLen = sizeof(uint32_t) +
+                         snprintf(header, sizeof(header), "!C%dN%04zx,",
+                                  comp, nLeds) +
+                         nLeds * sizeof(uint32_t) + 1;
+        return 0;
+}
+
+void ledclient_frames_free(struct ledclient_frames *frames) {
+        size_t i;
+
+        for (i = 0; i < frames->count; i++)
+                free(frames->msgs[i]);
+        free(frames->msgs);
+        free(frames->keys);
+        free(frames->scratch);
+        memset(frames, 0, sizeof(*frames));
+}
+
+/* Whole message of the frame in scratch */
+static uint8_t *encodeFrame(const struct ledclient_frames *frames) {
+        uint8_t *msg = malloc(frames->msgLen), *p = msg;
+        uint32_t streamLen = frames->msgLen - sizeof(streamLen);
+        char header[LEDCLIENT_HEADER_LEN];
+        int headerLen;
+
+        if ( ! msg )
+                return NULL;
+
+        headerLen = snprintf(header, sizeof(header), "!C%dN%04zx,",
+                             frames->comp, frames->nLeds);
+
+        memcpy(p, &streamLen, sizeof(streamLen));
+        p += sizeof(streamLen);
+        memcpy(p, header, headerLen);
+        p += headerLen;
+        memcpy(p, frames->scratch, frames->nLeds * sizeof(uint32_t));
+        p += frames->nLeds * sizeof(uint32_t);
+        *p = '$';
+
+        return msg;
+}
+
+const uint8_t *ledclient_frames_get(struct ledclient_frames *frames,
+                                    uint32_t key, ledclient_build_cb build,
+                                    void *user) {
+        uint32_t *keys;
+        uint8_t **msgs, *msg;
+        size_t i, size;
+
+        for (i = 0; i < frames->count; i++)
+                if (frames->keys[i] == key)
+                        return frames->msgs[i];
+
+        if (frames->count == frames->size) {
+                size = frames->size ? 2 * frames->size : 8;
+                keys = realloc(frames->keys, size * sizeof(*keys));
+                if ( ! keys )
+                        return NULL;
+                frames->keys = keys;
+                msgs = realloc(frames->msgs, size * sizeof(*msgs));
+                if ( ! msgs )
+                        return NULL;
+                frames->msgs = msgs;
+                frames->size = size;
+        }
+
+        build(user, key, frames->scratch);
+        msg = encodeFrame(frames);
+        if ( ! msg )
+                return NULL;
+
+        frames->keys[frames->count] = key;
+        frames->msgs[frames->count] = msg;
+        frames->count++;
+        return msg;
+}
+
+int ledclient_send_cached(struct ledclient *clt,
+                          struct ledclient_frames *frames, uint32_t key,
+                          ledclient_build_cb build, void *user) {
+        const uint8_t *msg = ledclient_frames_get(frames, key, build, user);
+        struct iovec iov = { (void *)msg, frames->msgLen };
+
+        if ( ! msg )
+                return -1;
+        if (clt->fd < 0) {
+                errno = ENOTCONN;
+                return -1;
+        }
+
+        if (sendAll(clt->fd, &iov, 1) < 0)
+                return -1;
+
+        clt->framesSent++;
+        return 0;
+}
+
+int ledclient_send_raw(struct ledclient *clt, const void *msg, size_t len) {
+        if (len > LEDCLIENT_MSG_MAX) {
+                errno = EMSGSIZE;
+                return -1;
+        }
+
+        return sendCommand(clt, (const char *)msg, len, NULL, 0, 0);
+}
+
+int ledclient_request_groups(struct ledclient *clt) {
+        return sendCommand(clt, "?G", 2, NULL, 0, 1);
+}
+
+int ledclient_send_groups(struct ledclient *clt,
+                          const struct ledclient_group_color *entries,
+                          size_t n) {
+        char header[LEDCLIENT_HEADER_LEN];
+
+        if (n > LEDCLIENT_MAX_ENTRIES) {
+                errno = EMSGSIZE;
+                return -1;
+        }
+
+        snprintf(header, sizeof(header), "!GN%04zx,", n);
+        return sendCommand(clt, header, strlen(header),
+                           entries, n * sizeof(*entries), 1);
+}
+
+int ledclient_send_effects(struct ledclient *clt,
+                           const struct protocol_effect *entries, size_t n) {
+        char header[LEDCLIENT_HEADER_LEN];
+
+        if (n > LEDCLIENT_MAX_ENTRIES) {
+                errno = EMSGSIZE;
+                return -1;
+        }
+
+        snprintf(header, sizeof(header), "!EN%04zx,", n);
+        return sendCommand(clt, header, strlen(header),
+                           entries, n * sizeof(*entries), 1);
+}
+
+int ledclient_send_shader(struct ledclient *clt, unsigned slot,
+                          const char *source) {
+        char header[LEDCLIENT_HEADER_LEN];
+
+        if (slot >= EFFECT_SLOTS) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        snprintf(header, sizeof(header), "!S%04x,", slot);
+        return sendCommand(clt, header, strlen(header),
+                           source, strlen(source), 1);
+}
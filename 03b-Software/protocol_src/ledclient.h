@@ -0,0 +1,184 @@
+
+#ifndef __LEDCLIENT_H__
+#define __LEDCLIENT_H__
+
+/* Client side of the GUI's protocol (see 01-Doc/protocol/protocol.md):
+ * connection, handshake & one encoder per command.
+ *
+ * Every message is a 4 bytes stream length (Little Endian) followed by the
+ * command. Commands are sent with writev(): length, header, payload & '$' go
+ * out from where they are, without being copied into a single buffer.
+ *
+ * Server's messages are read without any thread: ledclient_process() &
+ * ledclient_wait() sleep in poll() until bytes arrive, reassemble them into
+ * messages and handle the acknowledges as they come.
+ *
+ * Functions return 0 (or a length) on success, -1 on failure with errno set. */
+
+#include <stddef.h>     /* .. size_t */
+#include <stdint.h>     /* .. uint32_t */
+#include <time.h>       /* .. struct timespec */
+
+#include "protocol_routing_variables.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* "N<hhhh>,": 4 hexa digits, so at most 0xFFFF LEDs/entries per command */
+#define LEDCLIENT_MAX_ENTRIES   0xFFFFu
+/* Longest commands' header, '\0' included */
+#define LEDCLIENT_HEADER_LEN    16u
+/* Longest server's message accepted (groups' description of big designs) */
+#define LEDCLIENT_MSG_MAX       (1u << 20)
+
+/* Every message received, routing value first, once the client's own
+ * handling is done. msg is only valid during the call */
+typedef void (*ledclient_msg_cb)(void *user, const uint8_t *msg, size_t len);
+
+struct ledclient {
+        int       fd;
+        /* Preallocated frame, reused for every ledclient_send_frame() */
+        uint32_t *frame;
+        size_t    frameLen;
+
+        /* Received bytes, the last message may be incomplete */
+        uint8_t  *rx;
+        size_t    rxLen;
+        size_t    rxSize;
+
+        /* Optional, see ledclient_msg_cb */
+        ledclient_msg_cb onMessage;
+        void     *user;
+
+        /* State from the server's messages */
+        int       connected;    /* CLIENT_CONNECTION_ACK_AND_WAITING_DATA   */
+        int       serverLeft;   /* LEAVE_SHUTDOWN or connection closed      */
+        uint32_t  framesSent;
+        uint32_t  framesAcked;  /* DATA_RECEIVED_ACK                        */
+        uint8_t   lastDataInfo; /* enum PROTOCOL_DATA_RECEIVED_INFO         */
+};
+
+/* One entry of the "!G" command */
+struct ledclient_group_color {
+        uint32_t group;         /* Group's index, order of the "?G$" answer  */
+        uint32_t color;         /* <R><G><B><W>                              */
+};
+
+/** **************************************************************************
+ * @brief Connect without blocking more than timeoutMs (-1: system's timeout)
+ *        TCP_NODELAY is set: frames leave as soon as they are written
+ *************************************************************************** */
+int  ledclient_connect(struct ledclient *clt, const char *ip, int port,
+                       int timeoutMs);
+/* Wait for CLIENT_CONNECTION_ACK_AND_WAITING_DATA, up to timeoutMs */
+int  ledclient_handshake(struct ledclient *clt, int timeoutMs);
+/* Leave the server & free everything */
+int  ledclient_leave(struct ledclient *clt);
+void ledclient_close(struct ledclient *clt);
+
+/** **************************************************************************
+ * @brief Wait up to timeoutMs (0: don't, -1: forever) for the server's
+ *        messages, then handle every one received
+ *        A signal interrupting the wait isn't an error: 0 is returned
+ * @return # of messages handled, -1 on error or when the server is gone
+ *************************************************************************** */
+int  ledclient_process(struct ledclient *clt, int timeoutMs);
+/** **************************************************************************
+ * @brief Handle the server's messages for delayMs, sleeping in between
+ * @return 0 once elapsed or interrupted by a signal, -1 as above
+ *************************************************************************** */
+int  ledclient_wait(struct ledclient *clt, unsigned delayMs);
+/* Same, up to an absolute deadline of CLOCK_MONOTONIC */
+int  ledclient_wait_until(struct ledclient *clt,
+                          const struct timespec *deadline);
+
+/* Frames paced on absolute deadlines: building & sending a frame happen
+ * within its period, so the rate doesn't drift. A late frame skips the
+ * deadlines already past rather than sending a burst to catch up */
+struct ledclient_sched {
+        struct timespec start;
+        struct timespec next;           /* Next frame's deadline         */
+        uint64_t        periodNs;       /* Default frame's duration      */
+        uint64_t        frames;         /* Frames paced                  */
+        uint64_t        missed;         /* Deadlines skipped, being late */
+        uint64_t        maxLateNs;      /* Worst wake-up after deadline  */
+};
+
+/* 1st frame right away, then fps frames per second (0: durations given
+ * to each ledclient_sched_wait()) */
+void ledclient_sched_start(struct ledclient_sched *sch, double fps);
+/** **************************************************************************
+ * @brief Once a frame is sent, wait for the next one's deadline, durationNs
+ *        after this one's (0: the period), handling the server's messages
+ *        meanwhile
+ * @return 0, -1 as ledclient_process()
+ *************************************************************************** */
+int  ledclient_sched_wait(struct ledclient *clt, struct ledclient_sched *sch,
+                          uint64_t durationNs);
+/* Frames per second since ledclient_sched_start() */
+double ledclient_sched_fps(const struct ledclient_sched *sch);
+
+/** **************************************************************************
+ * @brief Frame buffer of nLeds words (<R><G><B><W>), allocated once
+ * @return The buffer, to fill before each ledclient_send_frame()
+ *************************************************************************** */
+uint32_t *ledclient_alloc_frame(struct ledclient *clt, size_t nLeds);
+/* "!C<comp>" with the frame buffer's LEDs, comp: 3 (RGB) or 4 (RGBW) */
+int  ledclient_send_frame(struct ledclient *clt, int comp);
+/* Same, from the caller's own buffer */
+int  ledclient_send_leds(struct ledclient *clt, int comp,
+                         const uint32_t *leds, size_t n);
+
+/* Frames encoded once, whole messages (length, header, LEDs & '$') sent as
+ * they are: for drivers cycling over a few states, building a frame then
+ * costs nothing. States are looked up linearly, there are few of them */
+struct ledclient_frames {
+        int       comp;
+        size_t    nLeds;
+        size_t    msgLen;       /* Every message's length, prefix included */
+        size_t    count;
+        size_t    size;
+        uint32_t *keys;
+        uint8_t **msgs;
+        uint32_t *scratch;      /* nLeds words, given to the build callback */
+};
+
+/* Fill leds[nLeds] with the frame of state key */
+typedef void (*ledclient_build_cb)(void *user, uint32_t key, uint32_t *leds);
+
+int  ledclient_frames_init(struct ledclient_frames *frames, int comp,
+                           size_t nLeds);
+void ledclient_frames_free(struct ledclient_frames *frames);
+/* Encoded frame of state key, built on 1st use (or ahead, to precompute)
+ * @return NULL on allocation failure */
+const uint8_t *ledclient_frames_get(struct ledclient_frames *frames,
+                                    uint32_t key, ledclient_build_cb build,
+                                    void *user);
+/* Send the frame of state key, built on 1st use */
+int  ledclient_send_cached(struct ledclient *clt,
+                           struct ledclient_frames *frames, uint32_t key,
+                           ledclient_build_cb build, void *user);
+
+/* A message already encoded, without its length prefix: streams replayed
+ * from a capture, commands of other clients */
+int  ledclient_send_raw(struct ledclient *clt, const void *msg, size_t len);
+
+/* "?G$": the answer is a GROUPS_DESCRIPTION message */
+int  ledclient_request_groups(struct ledclient *clt);
+/* "!G": Set groups' color */
+int  ledclient_send_groups(struct ledclient *clt,
+                           const struct ledclient_group_color *entries,
+                           size_t n);
+/* "!E": Start/update/stop effects rendered by the GUI */
+int  ledclient_send_effects(struct ledclient *clt,
+                            const struct protocol_effect *entries, size_t n);
+/* "!S": Upload a shader, the answer is a SHADER_STATUS message */
+int  ledclient_send_shader(struct ledclient *clt, unsigned slot,
+                           const char *source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LEDCLIENT_H__ */
@@ -2,9 +2,15 @@
 #ifndef __PROTOCOL_ROUTING_VARIABLES__
 #define __PROTOCOL_ROUTING_VARIABLES__
 
+#include <stdint.h>
+
 enum PROTOCOL_SERVER_RESPONSE {
         CLIENT_CONNECTION_ACK_AND_WAITING_DATA =   0,
         DATA_RECEIVED_ACK                      =   1,
+        /* Answer to "?G$", followed by the groups' description */
+        GROUPS_DESCRIPTION                     =   2,
+        /* Answer to "!S", followed by the compilation's error (none = OK) */
+        SHADER_STATUS                          =   3,
 };
 
 enum PROTOCOL_DATA_RECEIVED_INFO {
@@ -21,4 +27,35 @@ enum PROTOCOL_COMMON_ACTION {
         LEAVE_SHUTDOWN                         = 100,
 };
 
+/* Built-in effects rendered by the GUI itself, see "!E" command */
+enum PROTOCOL_EFFECT {
+        /* Stop the effect running in the slot */
+        EFFECT_NONE                            = 0,
+        EFFECT_FILL                            = 1,
+        EFFECT_CHASE                           = 2,
+        EFFECT_FADE                            = 3,
+        EFFECT_RAINBOW                         = 4,
+        EFFECT_TWINKLE                         = 5,
+        EFFECT_GRADIENT                        = 6,
+        /* Shader uploaded in the same slot with "!S" */
+        EFFECT_SHADER                          = 7,
+};
+
+/* Number of effects that can run at once, rendered in slot's order */
+#define EFFECT_SLOTS            8
+/* Effect's target when not restricted to a group */
+#define EFFECT_ALL_LEDS         0xFFFFFFFFu
+
+/* One entry of the "!E" command, all fields in Little Endian */
+struct protocol_effect {
+        uint32_t slot;          /* [0;EFFECT_SLOTS[                          */
+        uint32_t effect;        /* enum PROTOCOL_EFFECT                      */
+        uint32_t group;         /* Group's index or EFFECT_ALL_LEDS          */
+        uint32_t colorA;        /* <R><G><B><W>, like the LEDs' data         */
+        uint32_t colorB;        /* Background/2nd color                      */
+        uint32_t periodMs;      /* Duration of one cycle, 0 = still          */
+        uint32_t size;          /* Effect dependant, see protocol.md         */
+        uint32_t seed;          /* Randomness' seed (twinkle)                */
+};
+
 #endif /* __PROTOCOL_ROUTING_VARIABLES__ */